@@ -65,15 +65,41 @@ Application::Application(const std::string &filename) {
   LOG_TRACE << "Reading config from " << path;
   loadConfig(path);
 
-  /// Create HTTP server with parameters from the configuration file
+  /// Create HTTP server with parameters from the configuration file, every
+  /// IO thread accepting on its own socket if `sharded_accept`
   server_ = std::make_unique<HttpServer>(
       loop_,
       InetAddress(
           static_cast<uint16_t>(atoi(config_map_["server"]["port"].c_str()))),
-      config_map_["server"]["name"]);
+      config_map_["server"]["name"],
+      config_map_["server"]["sharded_accept"] == "true"
+          ? TcpServer::SHARDED_REUSE_PORT
+          : TcpServer::NO_REUSE_PORT);
 
   /// Set HTTP server parameters
   server_->setThreadNum(atoi(config_map_["server"]["threads"].c_str()));
+  /// Busy connections cost fewer epoll wakeups edge-triggered
+  if (config_map_["server"]["edge_triggered"] == "true") {
+    server_->setEdgeTriggered(true);
+  }
+  /// Where new connections go: round-robin unless `placement` names a policy
+  const std::string &placement = config_map_["server"]["placement"];
+  if (placement == "least_connections") {
+    server_->setPlacementPolicy(EventLoopThreadPool::leastConnections());
+  } else if (placement == "least_queued") {
+    server_->setPlacementPolicy(EventLoopThreadPool::leastQueued());
+  } else if (placement == "least_busy") {
+    server_->setPlacementPolicy(EventLoopThreadPool::leastBusy());
+  } else if (placement == "peer_hash") {
+    server_->setPlacementPolicy(EventLoopThreadPool::peerHash());
+  } else if (!placement.empty() && placement != "round_robin") {
+    LOG_WARN << "Unknown placement " << placement << ", using round_robin";
+  }
+  /// Keep-alive connections silent for `idle_timeout` seconds are closed
+  server_->setIdleTimeout(atof(config_map_["server"]["idle_timeout"].c_str()));
+  /// One IO loop per CPU of `cpu_affinity`, e.g. "0-7" or "physical_cores"
+  server_->setCpuAffinity(
+      CpuAffinity::parse(config_map_["server"]["cpu_affinity"]));
   server_->setHttpCallback([this](auto &&PH1, auto &&PH2) {
     onRequest(std::forward<decltype(PH1)>(PH1),
               std::forward<decltype(PH2)>(PH2));
@@ -93,6 +119,15 @@ Application::Application(const std::string &filename) {
         atoi(config_map_["db"]["max_idle_time"].c_str()) // Maximum idle time
     );
     pool_ = std::make_unique<ConnectionPool>(config, config_map_["db"]["name"]);
+    pool_->setCpuAffinity(
+        CpuAffinity::parse(config_map_["db"]["cpu_affinity"]));
+  }
+
+  /// Serve the directories of the "static" section, as `prefix: root`
+  if (config_map_.find("static") != config_map_.end()) {
+    for (auto &[prefix, root] : config_map_["static"]) {
+      addStatic(prefix, root);
+    }
   }
 }
 
@@ -130,6 +165,20 @@ void Application::addRoute(const std::string &method, const std::string &path,
   route_table_[std::make_pair(stringToHttpMethod(method), path)] = handler;
 }
 
+void Application::addStatic(const std::string &prefix,
+                            const std::string &root) {
+  auto handler = std::make_shared<StaticFileHandler>(root, prefix);
+  auto serve = [handler](const HttpRequest &req, HttpResponse *resp) {
+    (*handler)(req, resp);
+  };
+  /// The prefix is literal, escape what a regex would read otherwise
+  static const std::regex k_special(R"([.^$|()\[\]{}*+?\\])");
+  std::string pattern =
+      std::regex_replace(prefix, k_special, R"(\$&)") + "/.*";
+  addRoute("GET", pattern, serve);
+  addRoute("HEAD", pattern, serve);
+}
+
 void Application::printRouteTable() {
   std::cout << "Route Table:\n";
   for (auto &[pair, handler] : route_table_) {
@@ -150,6 +199,11 @@ void Application::loadConfig(const std::string &filePath) {
       config_map_["server"]["name"] = "WebServer";
       config_map_["server"]["port"] = "8000";
       config_map_["server"]["threads"] = "5";
+      config_map_["server"]["edge_triggered"] = "false";
+      config_map_["server"]["sharded_accept"] = "false";
+      config_map_["server"]["placement"] = "round_robin";
+      config_map_["server"]["cpu_affinity"] = "none";
+      config_map_["server"]["idle_timeout"] = "0";
     }
     /// Fill in default key-value pairs for the "db" section
     else if (section_name == "db") {
@@ -158,6 +212,7 @@ void Application::loadConfig(const std::string &filePath) {
       config_map_["db"]["max_size"] = "10";
       config_map_["db"]["timeout"] = "10";
       config_map_["db"]["max_idle_time"] = "5000";
+      config_map_["db"]["cpu_affinity"] = "none";
     }
 
     /// Store the key-value pairs for the current section
@@ -0,0 +1,136 @@
+#include "lynx/base/cpu_affinity.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sched.h>
+#include <stdexcept>
+
+namespace lynx {
+
+namespace {
+
+/// A CPU number, -1 unless `str` is all digits.
+int parseCpu(const std::string &str) {
+  if (str.empty() || str.size() > 6 ||
+      str.find_first_not_of("0123456789") != std::string::npos) {
+    return -1;
+  }
+  return std::stoi(str);
+}
+
+/// Parses a kernel style CPU list, "0-3,8" as in sysfs and cpuset(7).
+std::vector<int> parseList(const std::string &list) {
+  std::vector<int> cpus;
+  size_t pos = 0;
+  while (pos <= list.size()) {
+    size_t end = std::min(list.find(',', pos), list.size());
+    std::string item = list.substr(pos, end - pos);
+    size_t dash = item.find('-');
+    int first = parseCpu(item.substr(0, dash));
+    int last =
+        dash == std::string::npos ? first : parseCpu(item.substr(dash + 1));
+    if (first < 0 || last < first || last >= CPU_SETSIZE) {
+      throw std::invalid_argument("bad CPU list item '" + item + "'");
+    }
+    for (int cpu = first; cpu <= last; ++cpu) {
+      cpus.push_back(cpu);
+    }
+    pos = end + 1;
+  }
+  return cpus;
+}
+
+/// The CPUs the calling thread may run on.
+std::vector<int> allowedCpus() {
+  std::vector<int> cpus;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (::sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &set)) {
+        cpus.push_back(cpu);
+      }
+    }
+  }
+  return cpus;
+}
+
+} // namespace
+
+CpuAffinity::CpuAffinity(std::vector<int> cpus) : cpus_(std::move(cpus)) {
+  std::sort(cpus_.begin(), cpus_.end());
+  cpus_.erase(std::unique(cpus_.begin(), cpus_.end()), cpus_.end());
+}
+
+CpuAffinity CpuAffinity::parse(const std::string &spec) {
+  if (spec.empty() || spec == "none") {
+    return CpuAffinity();
+  }
+  if (spec == "physical_cores") {
+    return physicalCores();
+  }
+  std::string list;
+  for (char c : spec) {
+    if (c != ' ') {
+      list += c;
+    }
+  }
+  return CpuAffinity(parseList(list));
+}
+
+CpuAffinity CpuAffinity::physicalCores() {
+  std::vector<int> allowed = allowedCpus();
+  std::vector<int> cores;
+  for (int cpu : allowed) {
+    std::ifstream file("/sys/devices/system/cpu/cpu" + std::to_string(cpu) +
+                       "/topology/thread_siblings_list");
+    std::string line;
+    std::vector<int> siblings;
+    if (std::getline(file, line)) {
+      try {
+        siblings = parseList(line);
+      } catch (const std::invalid_argument &) {
+        siblings.clear();
+      }
+    }
+    /// Kept unless an allowed sibling comes first
+    bool first = std::none_of(
+        siblings.begin(), siblings.end(), [&allowed, cpu](int sibling) {
+          return sibling < cpu && std::binary_search(allowed.begin(),
+                                                     allowed.end(), sibling);
+        });
+    if (first) {
+      cores.push_back(cpu);
+    }
+  }
+  return CpuAffinity(std::move(cores));
+}
+
+CpuAffinity CpuAffinity::cpuFor(size_t index) const {
+  if (cpus_.empty()) {
+    return CpuAffinity();
+  }
+  return CpuAffinity({cpus_[index % cpus_.size()]});
+}
+
+bool CpuAffinity::applyToCurrentThread() const {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : cpus_) {
+    CPU_SET(cpu, &set);
+  }
+  return ::sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+std::string CpuAffinity::toString() const {
+  std::string str;
+  for (int cpu : cpus_) {
+    if (!str.empty()) {
+      str += ',';
+    }
+    str += std::to_string(cpu);
+  }
+  return str;
+}
+
+} // namespace lynx
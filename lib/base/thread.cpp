@@ -2,6 +2,7 @@
 #include "lynx/base/current_thread.h"
 
 #include <cassert>
+#include <cerrno>
 #include <sys/prctl.h>
 
 namespace lynx {
@@ -35,6 +36,12 @@ void Thread::start() {
           name_.empty() ? "lynxThread" : name_.c_str();
       /// Set the process name using prctl(2)
       ::prctl(PR_SET_NAME, lynx::current_thread::t_thread_name);
+      /// Pin the thread before it touches any of its own data
+      if (!affinity_.empty() && !affinity_.applyToCurrentThread()) {
+        fprintf(stderr, "failed to pin Thread %s to CPUs %s: %s\n",
+                name_.c_str(), affinity_.toString().c_str(),
+                current_thread::strError(errno));
+      }
 
       func_(); /// Run the provided function
     });
@@ -24,6 +24,7 @@ void ThreadPool::start(int numThreads) {
     snprintf(id, sizeof(id), "%d", i + 1);
     /// Create a new thread and add it to the vector
     threads_.emplace_back(new Thread([&] { runInThread(); }, name_ + id));
+    threads_[i]->setCpuAffinity(affinity_.cpuFor(i));
     threads_[i]->start();
   }
 
@@ -113,7 +114,7 @@ ThreadPool::Task ThreadPool::take() {
   Task task; /// The task to be returned.
   /// If there is at least one task in the queue, retrieve and remove it.
   if (!queue_.empty()) {
-    task = queue_.front();
+    task = std::move(queue_.front());
     queue_.pop_front();
     /// If the maximum queue size is set, notify the not_full condition
     /// variable.
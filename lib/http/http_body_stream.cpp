@@ -0,0 +1,148 @@
+#include "lynx/http/http_body_stream.h"
+#include "lynx/logger/logging.h"
+#include "lynx/net/byte_scan.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace lynx {
+
+HttpBodyStream::HttpBodyStream(size_t spillThreshold)
+    : spill_threshold_(spillThreshold), max_size_(K_MAX_SIZE), fd_(-1),
+      size_(0), error_(false) {}
+
+HttpBodyStream::~HttpBodyStream() {
+  if (fd_ >= 0) {
+    ::close(fd_);
+  }
+}
+
+void HttpBodyStream::append(std::string_view data) {
+  size_ += data.size();
+  if (chunk_callback_) {
+    chunk_callback_(data);
+    return;
+  }
+  if (fd_ < 0 && memory_.size() + data.size() > spill_threshold_ &&
+      !spill()) {
+    return;
+  }
+  if (fd_ >= 0) {
+    writeFile(data.data(), data.size());
+  } else {
+    memory_.append(data);
+  }
+}
+
+ssize_t HttpBodyStream::read(size_t offset, char *buf, size_t len) const {
+  if (fd_ >= 0) {
+    return ::pread(fd_, buf, len, static_cast<off_t>(offset));
+  }
+  if (offset >= memory_.size()) {
+    return 0;
+  }
+  size_t n = std::min(len, memory_.size() - offset);
+  memcpy(buf, memory_.data() + offset, n);
+  return static_cast<ssize_t>(n);
+}
+
+bool HttpBodyStream::spill() {
+  const char *dir = getenv("TMPDIR");
+  std::string path = std::string(dir ? dir : "/tmp") + "/lynx-body-XXXXXX";
+  fd_ = ::mkostemp(path.data(), O_CLOEXEC);
+  if (fd_ < 0) {
+    LOG_SYSERR << "HttpBodyStream::spill mkostemp " << path;
+    error_ = true;
+    return false;
+  }
+  /// Nobody else needs the name, the file goes away with the descriptor
+  ::unlink(path.c_str());
+  writeFile(memory_.data(), memory_.size());
+  std::string().swap(memory_);
+  return true;
+}
+
+void HttpBodyStream::writeFile(const char *data, size_t len) {
+  while (len > 0 && !error_) {
+    ssize_t n = ::write(fd_, data, len);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      LOG_SYSERR << "HttpBodyStream::writeFile";
+      error_ = true;
+      return;
+    }
+    data += n;
+    len -= n;
+  }
+}
+
+ssize_t
+HttpChunkedDecoder::decode(const char *data, size_t len,
+                           const std::function<void(std::string_view)> &sink) {
+  const char *p = data;
+  const char *end = data + len;
+  while (p < end && state_ != DONE) {
+    switch (state_) {
+    case SIZE: {
+      const char *crlf = findCRLF(p, end);
+      if (crlf == end) {
+        return end - p > static_cast<ssize_t>(K_MAX_LINE) ? -1 : p - data;
+      }
+      /// chunk-size [ ";" chunk-ext ] CRLF
+      const char *size_end = std::find(p, crlf, ';');
+      auto [ptr, ec] = std::from_chars(p, size_end, remaining_, 16);
+      if (ec != std::errc() || ptr == p ||
+          std::find_if(ptr, size_end, [](char c) {
+            return c != ' ' && c != '\t';
+          }) != size_end) {
+        return -1;
+      }
+      p = crlf + 2;
+      state_ = remaining_ == 0 ? TRAILER : DATA;
+      break;
+    }
+    case DATA: {
+      size_t n = std::min(remaining_, static_cast<size_t>(end - p));
+      sink(std::string_view(p, n));
+      p += n;
+      remaining_ -= n;
+      if (remaining_ == 0) {
+        state_ = DATA_CRLF;
+      }
+      break;
+    }
+    case DATA_CRLF:
+      if (end - p < 2) {
+        return p - data;
+      }
+      if (p[0] != '\r' || p[1] != '\n') {
+        return -1;
+      }
+      p += 2;
+      state_ = SIZE;
+      break;
+    case TRAILER: {
+      const char *crlf = findCRLF(p, end);
+      if (crlf == end) {
+        return end - p > static_cast<ssize_t>(K_MAX_LINE) ? -1 : p - data;
+      }
+      /// An empty line ends the trailer, trailer fields are skipped
+      state_ = crlf == p ? DONE : TRAILER;
+      p = crlf + 2;
+      break;
+    }
+    case DONE:
+      break;
+    }
+  }
+  return p - data;
+}
+
+} // namespace lynx
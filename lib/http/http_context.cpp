@@ -1,5 +1,10 @@
 #include "lynx/http/http_context.h"
 #include "lynx/logger/logging.h"
+#include "lynx/net/buffer.h"
+
+#include <algorithm>
+#include <charconv>
+#include <limits>
 
 namespace lynx {
 
@@ -12,8 +17,8 @@ void onRequestHttpField(void *data, const char *field, size_t flen,
     LOG_WARN << "invalid http request field length == 0";
     return;
   }
-  context->request().setHeader(std::string(field, flen),
-                               std::string(value, vlen));
+  context->addHeader(std::string_view(field, flen),
+                     std::string_view(value, vlen));
 }
 
 void onRequestMethod(void *data, const char *at, size_t length) {
@@ -28,23 +33,22 @@ void onRequestMethod(void *data, const char *at, size_t length) {
 
 void onRequestUri(void *data, const char *at, size_t length) {
   auto *context = static_cast<HttpContext *>(data);
-  context->request().setUri(std::string(at, length));
+  context->request().setUri(std::string_view(at, length));
 }
 
 void onRequestFragment(void *data, const char *at, size_t length) {
   auto *context = static_cast<HttpContext *>(data);
-  context->request().setFragment(std::string(at, length));
+  context->request().setFragment(std::string_view(at, length));
 }
 
 void onRequestPath(void *data, const char *at, size_t length) {
   auto *context = static_cast<HttpContext *>(data);
-  context->request().setPath(std::string(at, length));
+  context->request().setPath(std::string_view(at, length));
 }
 
 void onRequestQuery(void *data, const char *at, size_t length) {
   auto *context = static_cast<HttpContext *>(data);
-  context->request().setQuery(std::string(at, length));
-  context->request().initQueryParam(); /// Init query params
+  context->request().setQuery(std::string_view(at, length));
 }
 
 void onRequestVersion(void *data, const char *at, size_t length) {
@@ -63,15 +67,35 @@ void onRequestVersion(void *data, const char *at, size_t length) {
 
 void onRequestHeaderDone(void *data, const char *at, size_t length) {
   auto *context = static_cast<HttpContext *>(data);
-  context->request().initCookies(); /// Init cookies
-  /// Set parser's content length
-  std::string content_len = context->request().getHeader("content-length");
-  context->parser().content_len_ = atoi(content_len.c_str());
+  /// Set parser's content length, -1 for a malformed value, which
+  /// checkFraming() rejects
+  std::string_view content_len =
+      context->request().getHeader(HttpHeader::CONTENT_LENGTH, "0");
+  bool digits = !content_len.empty() &&
+                std::all_of(content_len.begin(), content_len.end(),
+                            [](char c) { return c >= '0' && c <= '9'; });
+  int64_t len = -1;
+  if (digits) {
+    auto [ptr, ec] = std::from_chars(
+        content_len.data(), content_len.data() + content_len.size(), len);
+    /// Longer than anything we store, refused by the max body size
+    if (ec == std::errc::result_out_of_range) {
+      len = std::numeric_limits<int64_t>::max();
+    }
+  }
+  context->parser().content_len_ = len;
 }
 
 } // namespace detail
 
-HttpContext::HttpContext() : request_(), parser_(), error_(0) {}
+HttpContext::HttpContext()
+    : request_(), parser_(), base_(nullptr), base_len_(0), nparsed_(0),
+      got_all_(false), error_(),
+      spill_threshold_(HttpBodyStream::K_SPILL_THRESHOLD),
+      max_body_size_(K_MAX_BODY_SIZE), max_headers_(K_MAX_HEADERS),
+      max_header_size_(K_MAX_HEADER_SIZE), streaming_(false),
+      chunked_(false), selected_(false), header_owned_(false), body_offset_(0),
+      body_left_(0) {}
 
 void HttpContext::start() {
   parser_.http_field_ = detail::onRequestHttpField;
@@ -85,19 +109,214 @@ void HttpContext::start() {
   parser_.data_ = this;
 }
 
-bool HttpContext::parseRequest(char *data, size_t len) {
-  size_t offset = parser_.execute(data, len, 0);
-  (void)offset;
+bool HttpContext::parseRequest(const char *data, size_t len) {
+  if (got_all_) {
+    return true;
+  }
+
+  /// The buffer may have been moved by a read since the last call, keep the
+  /// views of the request pointing at the current copy of its bytes
+  if (base_ != nullptr && base_ != data) {
+    request_.rebase(base_, base_len_, data);
+  }
+  base_ = data;
+  base_len_ = len;
+
+  /// Resume the header parsing where the previous read stopped
+  if (!parser_.isFinished()) {
+    nparsed_ += parser_.execute(data, len, nparsed_);
+    if (parser_.hasError() || error_ != HttpStatus{}) {
+      return false;
+    }
+    /// The unparsed header stays in the input buffer, bound how much of it
+    if (parser_.isFinished() ? parser_.body_start_ > max_header_size_
+                             : len > max_header_size_) {
+      error_ = HttpStatus::REQUEST_HEADER_FIELDS_TOO_LARGE;
+      return false;
+    }
+    if (!parser_.isFinished()) {
+      return true;
+    }
+    if (!checkFraming()) {
+      return false;
+    }
+    if (!startBodyStream()) {
+      error_ = HttpStatus::PAYLOAD_TOO_LARGE;
+      return false;
+    }
+  }
+
+  if (streaming_) {
+    return feedBodyStream(data, len);
+  }
+
+  /// Wait until the whole body has arrived
+  if (len < requestLength()) {
+    return true;
+  }
 
   /// Set body
   request_.setBody(
-      std::string(data + parser_.body_start_, parser_.content_len_));
-  request_.initBodyParam();
+      std::string_view(data + parser_.body_start_, parser_.content_len_));
+  got_all_ = true;
+
+  return true;
+}
+
+bool HttpContext::parseRequest(Buffer *buf) {
+  if (!parseRequest(buf->peek(), buf->readableBytes())) {
+    return false;
+  }
+  /// While the body streams, keep only its unconsumed bytes in the buffer
+  if (streaming_ && !got_all_ && body_offset_ > 0) {
+    if (!header_owned_) {
+      request_.materialize();
+      header_owned_ = true;
+    }
+    buf->retrieve(body_offset_);
+    body_offset_ = 0;
+    base_ = nullptr;
+  }
+  return true;
+}
+
+void HttpContext::addHeader(std::string_view field, std::string_view value) {
+  if (error_ != HttpStatus{}) {
+    return;
+  }
+  /// Each field costs a lookup over the ones before it, bound the count
+  if (request_.headers().size() >= max_headers_) {
+    error_ = HttpStatus::REQUEST_HEADER_FIELDS_TOO_LARGE;
+    return;
+  }
+  /// A repeated framing header would be merged into one, while a proxy in
+  /// front may have read the other, refuse it
+  HttpHeader known = stringToHttpHeader(field);
+  if ((known == HttpHeader::CONTENT_LENGTH ||
+       known == HttpHeader::TRANSFER_ENCODING) &&
+      request_.headers().find(known) != nullptr) {
+    error_ = HttpStatus::BAD_REQUEST;
+    return;
+  }
+  request_.setHeader(field, value);
+}
+
+bool HttpContext::checkFraming() {
+  const std::string_view *te =
+      request_.headers().find(HttpHeader::TRANSFER_ENCODING);
+  if (te != nullptr) {
+    /// Either length could frame the body, a smuggled request hides between
+    if (request_.headers().find(HttpHeader::CONTENT_LENGTH) != nullptr) {
+      error_ = HttpStatus::BAD_REQUEST;
+      return false;
+    }
+    /// Other codings are not decoded
+    if (!equalsIgnoreCase(*te, "chunked")) {
+      error_ = HttpStatus::NOT_IMPLEMENTED;
+      return false;
+    }
+  }
+  if (parser_.content_len_ < 0) {
+    error_ = HttpStatus::BAD_REQUEST;
+    return false;
+  }
+  return true;
+}
+
+bool HttpContext::startBodyStream() {
+  /// checkFraming() let only "chunked" through
+  chunked_ =
+      request_.headers().find(HttpHeader::TRANSFER_ENCODING) != nullptr;
+  size_t content_len = chunked_ ? 0 : parser_.content_len_;
+  if (!chunked_ && !body_stream_selector_) {
+    return content_len <= max_body_size_;
+  }
+  auto stream = std::make_shared<HttpBodyStream>(spill_threshold_);
+  selected_ =
+      body_stream_selector_ && body_stream_selector_(request_, stream.get());
+  if (!selected_) {
+    /// Nobody asked for a stream, so the body goes to body() and never to
+    /// disk, which would block the loop
+    stream->setSpillThreshold(std::numeric_limits<size_t>::max());
+    stream->setMaxSize(max_body_size_);
+  }
+  if (!stream->hasChunkCallback() && content_len > stream->maxSize()) {
+    return false;
+  }
+  if (!chunked_ && !selected_) {
+    return true;
+  }
+  streaming_ = true;
+  body_stream_ = std::move(stream);
+  body_offset_ = parser_.body_start_;
+  body_left_ = content_len;
+  return true;
+}
 
-  return parser_.isFinished() && !parser_.hasError();
+bool HttpContext::feedBodyStream(const char *data, size_t len) {
+  const char *begin = data + body_offset_;
+  size_t avail = len - body_offset_;
+  bool done;
+  if (chunked_) {
+    ssize_t n = decoder_.decode(begin, avail, [this](std::string_view piece) {
+      body_stream_->append(piece);
+    });
+    if (n < 0) {
+      error_ = HttpStatus::BAD_REQUEST;
+      return false;
+    }
+    body_offset_ += n;
+    done = decoder_.done();
+  } else {
+    size_t n = std::min(body_left_, avail);
+    body_stream_->append(std::string_view(begin, n));
+    body_offset_ += n;
+    body_left_ -= n;
+    done = body_left_ == 0;
+  }
+  if (!body_stream_->ok()) {
+    error_ = HttpStatus::INTERNAL_SERVER_ERROR;
+    return false;
+  }
+  if (!body_stream_->hasChunkCallback() &&
+      body_stream_->size() > body_stream_->maxSize()) {
+    error_ = HttpStatus::PAYLOAD_TOO_LARGE;
+    return false;
+  }
+
+  if (done) {
+    /// A body small enough to stay whole in memory is also in body()
+    if (body_stream_->memory().size() == body_stream_->size()) {
+      request_.setBody(body_stream_->memory());
+    }
+    request_.setBodyStream(body_stream_);
+    got_all_ = true;
+  }
+  return true;
+}
+
+void HttpContext::reset() {
+  HttpRequest dummy;
+  request_.swap(dummy);
+  parser_.init();
+  base_ = nullptr;
+  base_len_ = 0;
+  nparsed_ = 0;
+  got_all_ = false;
+  error_ = HttpStatus{};
+  streaming_ = false;
+  chunked_ = false;
+  selected_ = false;
+  header_owned_ = false;
+  body_offset_ = 0;
+  body_left_ = 0;
+  decoder_.reset();
+  body_stream_.reset();
 }
 
 bool HttpContext::isFinished() { return parser_.isFinished(); }
-bool HttpContext::hasError() { return error_ || parser_.hasError(); }
+bool HttpContext::hasError() {
+  return error_ != HttpStatus{} || parser_.hasError();
+}
 
 } // namespace lynx
@@ -0,0 +1,55 @@
+#include "lynx/http/http_headers.h"
+#include "lynx/net/byte_scan.h"
+
+namespace lynx {
+
+HttpHeader stringToHttpHeader(std::string_view name) {
+  /// Dispatch on the length first so at most one strncasecmp runs
+  switch (name.size()) {
+#define XX(num, name_, string)                                                 \
+  case sizeof(string) - 1:                                                     \
+    if (equalsIgnoreCase(name, string)) {                                      \
+      return HttpHeader::name_;                                                \
+    }                                                                          \
+    break;
+    HTTP_KNOWN_HEADER_MAP(XX)
+#undef XX
+  default:
+    break;
+  }
+  return HttpHeader::UNKNOWN_HEADER;
+}
+
+static const char *header_string[] = {
+#define XX(num, name, string) string,
+    HTTP_KNOWN_HEADER_MAP(XX)
+#undef XX
+};
+
+const char *httpHeaderToString(const HttpHeader &h) {
+  auto idx = static_cast<uint32_t>(h);
+  if (idx >= (sizeof(header_string) / sizeof(header_string[0]))) {
+    return "unknown";
+  }
+  return header_string[idx];
+}
+
+/// tchar = "!" / "#" / "$" / "%" / "&" / "'" / "*" / "+" / "-" / "." /
+///         "^" / "_" / "`" / "|" / "~" / DIGIT / ALPHA
+static constexpr ByteSet K_TOKEN_CHARS([](char c) {
+  return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+         (c >= 'A' && c <= 'Z') ||
+         std::string_view("!#$%&'*+-.^_`|~").find(c) != std::string_view::npos;
+});
+
+bool isHeaderName(std::string_view name) {
+  const char *end = name.data() + name.size();
+  return !name.empty() && findNotIn(name.data(), end, K_TOKEN_CHARS) == end;
+}
+
+bool isHeaderValue(std::string_view value) {
+  const char *end = value.data() + value.size();
+  return findEither(value.data(), end, '\r', '\n') == end;
+}
+
+} // namespace lynx
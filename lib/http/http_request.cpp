@@ -1,4 +1,5 @@
 #include "lynx/http/http_request.h"
+#include "lynx/net/byte_scan.h"
 
 #include <cstring>
 #include <sstream>
@@ -23,49 +24,130 @@ static const char xdigit_chars[256] = {
     0,  0,  0,  0, 0, 0,  0,  0,  0,  0,  0,  0, 0, 0, 0, 0,
 };
 
-std::string urlDecode(const std::string &str, bool space_as_plus = true) {
-  std::string *ss = nullptr;
-  const char *end = str.c_str() + str.length();
-  for (const char *c = str.c_str(); c < end; ++c) {
-    if (*c == '+' && space_as_plus) {
-      if (!ss) {
-        ss = new std::string;
-        ss->append(str.c_str(), c - str.c_str());
-      }
-      ss->append(1, ' ');
-    } else if (*c == '%' && (c + 2) < end && isxdigit(*(c + 1)) &&
-               isxdigit(*(c + 2))) {
-      if (!ss) {
-        ss = new std::string;
-        ss->append(str.c_str(), c - str.c_str());
-      }
-      ss->append(
-          1, static_cast<char>(xdigit_chars[static_cast<int>(*(c + 1))] << 4 |
-                               xdigit_chars[static_cast<int>(*(c + 2))]));
-      c += 2;
-    } else if (ss) {
-      ss->append(1, *c);
-    }
+std::string urlDecode(std::string_view str, bool space_as_plus) {
+  const char *begin = str.data();
+  const char *end = str.data() + str.size();
+  const char plus = space_as_plus ? '+' : '%';
+  const char *c = findEither(begin, end, '%', plus);
+  if (c == end) {
+    return std::string(str);
   }
-  if (!ss) {
-    return str;
-  } else {
-    std::string rt = *ss;
-    delete ss;
-    return rt;
+
+  /// Copy the runs between escapes in bulk, the scan skips them vectorized
+  std::string ss;
+  ss.reserve(str.size());
+  for (; c != end; c = findEither(begin, end, '%', plus)) {
+    ss.append(begin, c);
+    if (*c == '+') {
+      ss.push_back(' ');
+      begin = c + 1;
+    } else if ((c + 2) < end && isxdigit(static_cast<unsigned char>(c[1])) &&
+               isxdigit(static_cast<unsigned char>(c[2]))) {
+      ss.push_back(
+          static_cast<char>(xdigit_chars[static_cast<int>(c[1])] << 4 |
+                            xdigit_chars[static_cast<int>(c[2])]));
+      begin = c + 3;
+    } else {
+      ss.push_back(*c);
+      begin = c + 1;
+    }
   }
+  ss.append(begin, end);
+  return ss;
 }
 
-std::string trim(const std::string &str,
-                 const std::string &delimit = " \t\r\n") {
+std::string_view trim(std::string_view str,
+                      std::string_view delimit = " \t\r\n") {
   auto begin = str.find_first_not_of(delimit);
-  if (begin == std::string::npos) {
-    return "";
+  if (begin == std::string_view::npos) {
+    return {};
   }
   auto end = str.find_last_not_of(delimit);
   return str.substr(begin, end - begin + 1);
 }
 
+/**
+ * @brief Calls `func(key, value)` for each `key=value` pair of `str`.
+ *
+ * Pairs are separated by `sep`, keys and values are trimmed if `trim_ws`, and
+ * values are passed raw (still url-encoded). Pairs without '=' are skipped.
+ * Iteration stops early when `func` returns false.
+ */
+template <typename Func>
+void forEachPair(std::string_view str, char sep, bool trim_ws, Func &&func) {
+  while (!str.empty()) {
+    size_t end = str.find(sep);
+    std::string_view pair = str.substr(0, end);
+    str = end == std::string_view::npos ? std::string_view()
+                                        : str.substr(end + 1);
+    size_t eq = pair.find('=');
+    if (eq == std::string_view::npos) {
+      continue;
+    }
+    std::string_view key = pair.substr(0, eq);
+    std::string_view val = pair.substr(eq + 1);
+    if (!func(trim_ws ? trim(key) : key, trim_ws ? trim(val) : val)) {
+      return;
+    }
+  }
+}
+
+/// Finds the raw value of `key` in `str`, see forEachPair().
+bool findPair(std::string_view str, char sep, bool trim_ws,
+              std::string_view key, std::string_view *val) {
+  bool found = false;
+  forEachPair(str, sep, trim_ws,
+              [&](std::string_view k, std::string_view v) {
+                if (equalsIgnoreCase(k, key)) {
+                  *val = v;
+                  found = true;
+                }
+                return !found;
+              });
+  return found;
+}
+
+/// Inserts every pair of `str` into `m`, the first value of a key wins.
+void parsePairs(std::string_view str, char sep, bool trim_ws,
+                HttpRequest::MapType *m) {
+  forEachPair(str, sep, trim_ws,
+              [m](std::string_view k, std::string_view v) {
+                m->emplace(std::string(k), urlDecode(v));
+                return true;
+              });
+}
+
+/// Decodes `raw` into `buf` only if it has escapes, and returns the result.
+std::string_view decodeInto(std::string_view raw, std::string *buf) {
+  if (findEither(raw.data(), raw.data() + raw.size(), '%', '+') ==
+      raw.data() + raw.size()) {
+    return raw;
+  }
+  *buf = urlDecode(raw);
+  return *buf;
+}
+
+/// Checks if `str` contains `needle`, ignoring case.
+bool containsIgnoreCase(std::string_view str, std::string_view needle) {
+  for (size_t i = 0; i + needle.size() <= str.size(); ++i) {
+    if (equalsIgnoreCase(str.substr(i, needle.size()), needle)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/// Returns the view at the same offset in `to` if it lies in [from, from+len).
+std::string_view rebaseView(std::string_view view, const char *from,
+                            size_t len, const char *to) {
+  std::less<const char *> less;
+  if (view.empty() || less(view.data(), from) ||
+      less(from + len, view.data() + view.size())) {
+    return view;
+  }
+  return {to + (view.data() - from), view.size()};
+}
+
 } // namespace detail
 
 HttpMethod stringToHttpMethod(const std::string &m) {
@@ -106,52 +188,71 @@ HttpRequest::HttpRequest(uint8_t version, bool close)
     : method_(HttpMethod::GET), version_(version), close_(close),
       websocket_(false), parser_param_flag_(0), path_("/") {}
 
-std::string HttpRequest::getHeader(const std::string &key,
-                                   const std::string &def) const {
-  auto it = headers_.find(key);
-  return it == headers_.end() ? def : it->second;
+std::string_view HttpRequest::getHeader(std::string_view key,
+                                        std::string_view def) const {
+  const std::string_view *val = headers_.find(key);
+  return val == nullptr ? def : *val;
+}
+
+std::string_view HttpRequest::getHeader(HttpHeader key,
+                                        std::string_view def) const {
+  const std::string_view *val = headers_.find(key);
+  return val == nullptr ? def : *val;
 }
 
 std::string HttpRequest::getParam(const std::string &key,
                                   const std::string &def) const {
+  initParams();
   auto it = params_.find(key);
   return it == params_.end() ? def : it->second;
 }
 
 std::string HttpRequest::getCookie(const std::string &key,
-                                   const std::string &def) {
+                                   const std::string &def) const {
+  initCookies();
   auto it = cookies_.find(key);
   return it == cookies_.end() ? def : it->second;
 }
 
-void HttpRequest::setHeader(const std::string &key, const std::string &val) {
-  headers_[key] = val;
+void HttpRequest::setHeader(std::string_view key, std::string_view val) {
+  headers_.set(key, val);
 }
 
 void HttpRequest::setParam(const std::string &key, const std::string &val) {
+  initParams();
   params_[key] = val;
 }
 
 void HttpRequest::setCookie(const std::string &key, const std::string &val) {
+  initCookies();
   cookies_[key] = val;
 }
 
-void HttpRequest::delHeader(const std::string &key) { headers_.erase(key); }
-void HttpRequest::delParam(const std::string &key) { params_.erase(key); }
-void HttpRequest::delCookie(const std::string &key) { cookies_.erase(key); }
+void HttpRequest::delHeader(std::string_view key) { headers_.erase(key); }
 
-bool HttpRequest::hasHeader(const std::string &key, std::string *val) {
-  auto it = headers_.find(key);
-  if (it == headers_.end()) {
+void HttpRequest::delParam(const std::string &key) {
+  initParams();
+  params_.erase(key);
+}
+
+void HttpRequest::delCookie(const std::string &key) {
+  initCookies();
+  cookies_.erase(key);
+}
+
+bool HttpRequest::hasHeader(std::string_view key, std::string *val) {
+  const std::string_view *found = headers_.find(key);
+  if (found == nullptr) {
     return false;
   }
   if (val) {
-    *val = it->second;
+    *val = std::string(*found);
   }
   return true;
 }
 
-bool HttpRequest::hasParam(const std::string &key, std::string *val) {
+bool HttpRequest::hasParam(const std::string &key, std::string *val) const {
+  initParams();
   auto it = params_.find(key);
   if (it == params_.end()) {
     return false;
@@ -162,7 +263,8 @@ bool HttpRequest::hasParam(const std::string &key, std::string *val) {
   return true;
 }
 
-bool HttpRequest::hasCookie(const std::string &key, std::string *val) {
+bool HttpRequest::hasCookie(const std::string &key, std::string *val) const {
+  initCookies();
   auto it = cookies_.find(key);
   if (it == cookies_.end()) {
     return false;
@@ -182,7 +284,7 @@ std::ostream &HttpRequest::dump(std::ostream &os) const {
     os << "connection: " << (close_ ? "close" : "keep-alive") << "\r\n";
   }
   for (auto &i : headers_) {
-    if (!websocket_ && strcasecmp(i.first.c_str(), "connection") == 0) {
+    if (!websocket_ && equalsIgnoreCase(i.first, "connection")) {
       continue;
     }
     os << i.first << ": " << i.second << "\r\n";
@@ -202,58 +304,115 @@ std::string HttpRequest::toString() const {
   return ss.str();
 }
 
-#define PARSE_PARAM(str, m, flag, _trim_)                                      \
-  size_t pos = 0;                                                              \
-  do {                                                                         \
-    size_t last = pos;                                                         \
-    pos = str.find('=', pos);                                                  \
-    if (pos == std::string::npos) {                                            \
-      break;                                                                   \
-    }                                                                          \
-    size_t key = pos;                                                          \
-    pos = str.find(flag, pos);                                                 \
-    m.insert(std::make_pair(                                                   \
-        _trim_(str.substr(last, key - last)),                                  \
-        lynx::detail::urlDecode(str.substr(key + 1, pos - key - 1))));         \
-    if (pos == std::string::npos) {                                            \
-      break;                                                                   \
-    }                                                                          \
-    ++pos;                                                                     \
-  } while (true);
-
-void HttpRequest::initQueryParam() {
-  if (parser_param_flag_ & 0x1) {
-    return;
+bool HttpRequest::isFormBody() const {
+  return !body_.empty() &&
+         detail::containsIgnoreCase(getHeader(HttpHeader::CONTENT_TYPE),
+                                    "application/x-www-form-urlencoded");
+}
+
+bool HttpRequest::findParam(std::string_view key, std::string_view *val,
+                            std::string *buf) const {
+  /// Once decoded, the map is authoritative as it may have been modified
+  if ((parser_param_flag_ & (K_QUERY_PARSED | K_BODY_PARSED)) ==
+      (K_QUERY_PARSED | K_BODY_PARSED)) {
+    auto it = params_.find(key);
+    if (it == params_.end()) {
+      return false;
+    }
+    *val = it->second;
+    return true;
   }
-  PARSE_PARAM(query_, params_, '&', );
-  parser_param_flag_ |= 0x1;
+  std::string_view raw;
+  if (detail::findPair(query_, '&', false, key, &raw) ||
+      (isFormBody() && detail::findPair(body_, '&', false, key, &raw))) {
+    *val = detail::decodeInto(raw, buf);
+    return true;
+  }
+  return false;
 }
 
-void HttpRequest::initBodyParam() {
-  if (parser_param_flag_ & 0x2) {
-    return;
+bool HttpRequest::findCookie(std::string_view key, std::string_view *val,
+                             std::string *buf) const {
+  if (parser_param_flag_ & K_COOKIES_PARSED) {
+    auto it = cookies_.find(key);
+    if (it == cookies_.end()) {
+      return false;
+    }
+    *val = it->second;
+    return true;
+  }
+  std::string_view raw;
+  if (detail::findPair(getHeader(HttpHeader::COOKIE), ';', true, key, &raw)) {
+    *val = detail::decodeInto(raw, buf);
+    return true;
   }
-  std::string content_type = getHeader("content-type");
-  if (strcasestr(content_type.c_str(), "application/x-www-form-urlencoded") ==
-      nullptr) {
-    parser_param_flag_ |= 0x2;
+  return false;
+}
+
+void HttpRequest::initQueryParam() const {
+  if (parser_param_flag_ & K_QUERY_PARSED) {
     return;
   }
-  PARSE_PARAM(body_, params_, '&', );
-  parser_param_flag_ |= 0x2;
+  detail::parsePairs(query_, '&', false, &params_);
+  parser_param_flag_ |= K_QUERY_PARSED;
 }
 
-void HttpRequest::initCookies() {
-  if (parser_param_flag_ & 0x4) {
+void HttpRequest::initBodyParam() const {
+  if (parser_param_flag_ & K_BODY_PARSED) {
     return;
   }
-  std::string cookie = getHeader("cookie");
-  if (cookie.empty()) {
-    parser_param_flag_ |= 0x4;
+  if (isFormBody()) {
+    detail::parsePairs(body_, '&', false, &params_);
+  }
+  parser_param_flag_ |= K_BODY_PARSED;
+}
+
+void HttpRequest::initCookies() const {
+  if (parser_param_flag_ & K_COOKIES_PARSED) {
     return;
   }
-  PARSE_PARAM(cookie, cookies_, ';', lynx::detail::trim);
-  parser_param_flag_ |= 0x4;
+  detail::parsePairs(getHeader(HttpHeader::COOKIE), ';', true, &cookies_);
+  parser_param_flag_ |= K_COOKIES_PARSED;
+}
+
+void HttpRequest::materialize() {
+  size_t total = path_.size() + query_.size() + uri_.size() +
+                 fragment_.size() + body_.size();
+  for (auto &[key, val] : headers_) {
+    total += key.size() + val.size();
+  }
+
+  /// Reserve up front so the views taken below are never invalidated
+  auto storage = std::make_shared<std::string>();
+  storage->reserve(total);
+  auto own = [&storage](std::string_view view) -> std::string_view {
+    const char *data = storage->data() + storage->size();
+    storage->append(view);
+    return {data, view.size()};
+  };
+
+  path_ = own(path_);
+  query_ = own(query_);
+  uri_ = own(uri_);
+  fragment_ = own(fragment_);
+  body_ = own(body_);
+  for (size_t i = 0; i < headers_.size(); ++i) {
+    headers_[i].first = own(headers_[i].first);
+    headers_[i].second = own(headers_[i].second);
+  }
+  storage_ = std::move(storage);
+}
+
+void HttpRequest::rebase(const char *from, size_t len, const char *to) {
+  path_ = detail::rebaseView(path_, from, len, to);
+  query_ = detail::rebaseView(query_, from, len, to);
+  uri_ = detail::rebaseView(uri_, from, len, to);
+  fragment_ = detail::rebaseView(fragment_, from, len, to);
+  body_ = detail::rebaseView(body_, from, len, to);
+  for (size_t i = 0; i < headers_.size(); ++i) {
+    headers_[i].first = detail::rebaseView(headers_[i].first, from, len, to);
+    headers_[i].second = detail::rebaseView(headers_[i].second, from, len, to);
+  }
 }
 
 } // namespace lynx
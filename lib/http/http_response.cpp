@@ -1,34 +1,145 @@
 #include "lynx/http/http_response.h"
+#include "lynx/logger/logging.h"
 #include "lynx/net/buffer.h"
+#include "lynx/net/chain_buffer.h"
 
-#include <cstdio>
+#include <algorithm>
+#include <charconv>
+#include <ctime>
+#include <type_traits>
 
 namespace lynx {
 
-void HttpResponse::appendToBuffer(Buffer *output) const {
-  char buf[32];
-  snprintf(buf, sizeof(buf), "HTTP/1.1 %d ", status_);
-  output->append(buf);
-  output->append(statusToString(status_));
-  output->append("\r\n");
+namespace detail {
 
+/**
+ * @brief Returns the "Date: ...\r\n" header line for `now`.
+ *
+ * Each loop runs in its own thread, so a thread local cache is a per-loop
+ * cache and needs no locking. It is refreshed when the second changes.
+ */
+std::string_view dateHeader(Timestamp now) {
+  thread_local int64_t cached_sec = -1;
+  thread_local char cached[48];
+  thread_local size_t cached_len = 0;
+
+  int64_t sec = now.microsecsSinceEpoch() / Timestamp::K_MICRO_SECS_PER_SEC;
+  if (sec != cached_sec) {
+    time_t seconds = sec;
+    std::tm tm_time;
+    gmtime_r(&seconds, &tm_time);
+    cached_len = strftime(cached, sizeof(cached),
+                          "Date: %a, %d %b %Y %H:%M:%S GMT\r\n", &tm_time);
+    cached_sec = sec;
+  }
+  return {cached, cached_len};
+}
+
+} // namespace detail
+
+void HttpResponse::addHeader(const std::string &key, const std::string &value) {
+  if (!isHeaderName(key) || !isHeaderValue(value)) {
+    LOG_ERROR << "invalid http response header: " << key;
+    return;
+  }
+  headers_.set(key, value);
+}
+
+void HttpResponse::appendToBuffer(Buffer *output, Timestamp now) const {
+  serialize(output, now);
+}
+
+void HttpResponse::appendToBuffer(ChainBuffer *output, Timestamp now) const {
+  serialize(output, now);
+}
+
+template <typename Output>
+void HttpResponse::serialize(Output *output, Timestamp now) const {
+  static const std::string_view k_close = "Connection: close\r\n";
+  static const std::string_view k_keep_alive = "Connection: Keep-Alive\r\n";
+  static const std::string_view k_content_length = "Content-Length: ";
+  static const std::string_view k_chunked = "Transfer-Encoding: chunked\r\n";
+
+  std::string_view status_line = statusLine(status_);
+  char status_buf[32];
+  if (status_line.empty()) {
+    /// Not a known status, format the line once here
+    char *p = std::copy_n("HTTP/1.1 ", 9, status_buf);
+    p = std::to_chars(p, status_buf + 16, static_cast<int>(status_)).ptr;
+    p = std::copy_n(" unknown\r\n", 10, p);
+    status_line = std::string_view(status_buf, p - status_buf);
+  }
+  std::string_view date = detail::dateHeader(now);
+  /// 1xx, 204 and 304 responses have no body, nor a Content-Length for one
+  bool bodiless = static_cast<int>(status_) < 200 ||
+                  status_ == HttpStatus::NO_CONTENT ||
+                  status_ == HttpStatus::NOT_MODIFIED;
+  bool has_length = !close_connection_ && !isStreaming() && !bodiless;
+  char length_buf[24];
+  std::string_view length;
+  if (has_length) {
+    size_t body_size = hasFileBody() ? file_.length_ : body_.size();
+    char *p = std::to_chars(length_buf, length_buf + 20, body_size).ptr;
+    p = std::copy_n("\r\n", 2, p);
+    length = std::string_view(length_buf, p - length_buf);
+  }
+
+  /// Grow the buffer once, the appends below then only copy. A chain
+  /// buffer takes the body in slabs, it never needs the body contiguous.
+  size_t total = status_line.size() + date.size() + 2;
+  if constexpr (std::is_same_v<Output, Buffer>) {
+    total += body_.size();
+  }
   if (close_connection_) {
-    output->append("Connection: close\r\n");
+    total += k_close.size();
   } else {
-    snprintf(buf, sizeof(buf), "Content-Length: %zd\r\n", body_.size());
-    output->append(buf);
-    output->append("Connection: Keep-Alive\r\n");
+    total += k_keep_alive.size();
+  }
+  if (has_length) {
+    total += k_content_length.size() + length.size();
+  }
+  /// A HEAD response announces the framing a GET would get
+  bool chunked =
+      isStreaming() && stream_framing_ != HttpStreamWriter::CLOSE_DELIMITED;
+  if (chunked) {
+    total += k_chunked.size() + 32;
+  }
+  for (const auto &header : headers_) {
+    total += header.first.size() + header.second.size() + 4;
+  }
+  output->ensureWritableBytes(total);
+
+  output->append(status_line.data(), status_line.size());
+  output->append(date.data(), date.size());
+  if (close_connection_) {
+    output->append(k_close.data(), k_close.size());
+  } else {
+    if (has_length) {
+      output->append(k_content_length.data(), k_content_length.size());
+      output->append(length.data(), length.size());
+    }
+    output->append(k_keep_alive.data(), k_keep_alive.size());
+  }
+  if (chunked) {
+    output->append(k_chunked.data(), k_chunked.size());
   }
 
   for (const auto &header : headers_) {
     output->append(header.first);
-    output->append(": ");
+    output->append(": ", 2);
     output->append(header.second);
-    output->append("\r\n");
+    output->append("\r\n", 2);
   }
 
-  output->append("\r\n");
-  output->append(body_);
+  output->append("\r\n", 2);
+  if (hasFileBody()) {
+    /// The file region is sent by the connection after these bytes
+  } else if (!isStreaming() ||
+             stream_framing_ == HttpStreamWriter::CLOSE_DELIMITED) {
+    output->append(body_);
+  } else if (!body_.empty() && stream_framing_ == HttpStreamWriter::CHUNKED) {
+    HttpStreamWriter::appendChunk(output, body_);
+  }
 }
 
 } // namespace lynx
@@ -4,7 +4,6 @@
 #include "lynx/http/http_response.h"
 #include "lynx/logger/logging.h"
 
-#include <memory>
 
 namespace lynx {
 
@@ -20,7 +19,12 @@ void defaultHttpCallback(const HttpRequest & /*unused*/, HttpResponse *resp) {
 HttpServer::HttpServer(EventLoop *loop, const InetAddress &listenAddr,
                        const std::string &name, TcpServer::Option option)
     : server_(loop, listenAddr, name, option),
-      http_callback_(detail::defaultHttpCallback) {
+      http_callback_(detail::defaultHttpCallback),
+      stream_high_water_mark_(K_STREAM_HIGH_WATER_MARK),
+      spill_threshold_(HttpBodyStream::K_SPILL_THRESHOLD),
+      max_body_size_(HttpContext::K_MAX_BODY_SIZE),
+      max_headers_(HttpContext::K_MAX_HEADERS),
+      max_header_size_(HttpContext::K_MAX_HEADER_SIZE) {
   server_.setConnectionCallback(
       [this](auto &&PH1) { onConnection(std::forward<decltype(PH1)>(PH1)); });
   server_.setMessageCallback([this](auto &&PH1, auto &&PH2, auto &&PH3) {
@@ -28,6 +32,9 @@ HttpServer::HttpServer(EventLoop *loop, const InetAddress &listenAddr,
               std::forward<decltype(PH2)>(PH2),
               std::forward<decltype(PH3)>(PH3));
   });
+  server_.setWriteCompleteCallback([this](auto &&PH1) {
+    onWriteComplete(std::forward<decltype(PH1)>(PH1));
+  });
 }
 
 void HttpServer::start() {
@@ -39,42 +46,154 @@ void HttpServer::start() {
 void HttpServer::onConnection(const TcpConnectionPtr &conn) {
   if (conn->connected()) {
     LOG_INFO << "new Connection arrived";
+    conn->setContext(HttpContext());
+    auto *context = std::any_cast<HttpContext>(conn->getMutableContext());
+    context->start();
+    context->setBodyStreamSelector(body_stream_selector_);
+    context->setSpillThreshold(spill_threshold_);
+    context->setMaxBodySize(max_body_size_);
+    context->setMaxHeaders(max_headers_);
+    context->setMaxHeaderSize(max_header_size_);
+    conn->setHighWaterMarkCallback(
+        [this](auto &&PH1, auto &&PH2) {
+          onHighWaterMark(std::forward<decltype(PH1)>(PH1),
+                          std::forward<decltype(PH2)>(PH2));
+        },
+        stream_high_water_mark_);
   } else {
     LOG_INFO << "Connection closed";
+    /// Let a producer of a streamed response know nobody is listening
+    auto *context = std::any_cast<HttpContext>(conn->getMutableContext());
+    if (context && context->stream()) {
+      context->stream()->abort();
+      context->setStream(nullptr);
+    }
   }
 }
 
 void HttpServer::onMessage(const TcpConnectionPtr &conn, Buffer *buf,
                            Timestamp receiveTime) {
-  std::unique_ptr<HttpContext> context(new HttpContext);
-  context->start();
+  auto *context = std::any_cast<HttpContext>(conn->getMutableContext());
+  /// Bytes read after a "Connection: close" response are not answered
+  if (!conn->connected()) {
+    buf->retrieveAll();
+    return;
+  }
+  /// Pipelined requests wait for the streamed response before them to end,
+  /// and nothing more is read meanwhile
+  if (context->stream()) {
+    if (conn->isReading()) {
+      conn->stopRead();
+    }
+    return;
+  }
 
-  std::string msg(buf->retrieveAllAsString());
+  /// Drain every complete request in the input buffer, the responses are
+  /// serialized straight into the connection output buffer and sent together
+  ChainBuffer *output = conn->outputBuffer();
+  bool close = false;
+  bool bad_request = false;
+  while (!close) {
+    if (!context->parseRequest(buf)) {
+      bad_request = true;
+      break;
+    }
+    if (!context->gotAll()) {
+      break;
+    }
+    close = onRequest(conn, context->request(), receiveTime);
+    /// The request is a view of these bytes until the handler returns
+    buf->retrieve(context->requestLength());
+    context->reset();
+    if (context->stream()) {
+      break;
+    }
+  }
 
-  if (!context->parseRequest(msg.data(), msg.size())) {
-    conn->send("HTTP/1.1 400 Bad Request\r\n\r\n");
+  if (bad_request) {
+    std::string_view status_line = statusLine(context->errorStatus());
+    output->append(status_line.data(), status_line.size());
+    output->append("\r\n", 2);
+    buf->retrieveAll();
+    close = true;
+  }
+  conn->flushOutputBuffer();
+  if (context->stream()) {
+    /// Shut down, if needed, once the stream ends
+    context->stream()->resume();
+  } else if (close) {
     conn->shutdown();
   }
+}
+
+void HttpServer::onWriteComplete(const TcpConnectionPtr &conn) {
+  auto *context = std::any_cast<HttpContext>(conn->getMutableContext());
+  if (context && context->stream()) {
+    context->stream()->resume();
+  }
+}
+
+void HttpServer::onHighWaterMark(const TcpConnectionPtr &conn, size_t len) {
+  auto *context = std::any_cast<HttpContext>(conn->getMutableContext());
+  if (context && context->stream()) {
+    LOG_DEBUG << "pause streamed response, " << len << " bytes pending";
+    context->stream()->pause();
+  }
+}
 
-  if (context->isFinished()) {
-    onRequest(conn, context->request());
-    context.reset();
+void HttpServer::onStreamEnd(const std::weak_ptr<TcpConnection> &weak_conn,
+                             bool close) {
+  TcpConnectionPtr conn = weak_conn.lock();
+  if (!conn || !conn->connected()) {
+    return;
+  }
+  auto *context = std::any_cast<HttpContext>(conn->getMutableContext());
+  context->setStream(nullptr);
+  if (close) {
+    conn->shutdown();
+    return;
+  }
+  if (!conn->isReading()) {
+    conn->startRead();
+  }
+  if (conn->inputBuffer()->readableBytes() > 0) {
+    /// Serve the requests that were pipelined behind the stream
+    onMessage(conn, conn->inputBuffer(), conn->getLoop()->pollReturnTime());
   }
 }
 
-void HttpServer::onRequest(const TcpConnectionPtr &conn,
-                           const HttpRequest &req) {
-  const std::string &connection = req.getHeader("Connection");
+bool HttpServer::onRequest(const TcpConnectionPtr &conn,
+                           const HttpRequest &req, Timestamp receiveTime) {
+  std::string_view connection = req.getHeader(HttpHeader::CONNECTION);
   bool close = connection == "close" ||
                (req.version() == 0x10 && connection != "Keep-Alive");
   HttpResponse response(close);
   http_callback_(req, &response);
-  Buffer buf;
-  response.appendToBuffer(&buf);
-  conn->send(&buf);
-  if (response.closeConnection()) {
-    conn->shutdown();
+  if (response.isStreaming()) {
+    if (req.method() == HttpMethod::HEAD) {
+      response.setStreamFraming(HttpStreamWriter::NO_BODY);
+    } else if (req.version() == 0x10) {
+      /// No chunked encoding before HTTP/1.1, closing ends the body
+      response.setStreamFraming(HttpStreamWriter::CLOSE_DELIMITED);
+      response.setCloseConnection(true);
+    }
+  }
+  response.appendToBuffer(conn->outputBuffer(), receiveTime);
+  if (response.hasFileBody() && req.method() != HttpMethod::HEAD) {
+    const HttpResponse::FileBody &file = response.fileBody();
+    conn->sendFile(file.fd_, file.offset_, file.length_, file.owner_);
+  } else if (response.isStreaming() &&
+             response.streamFraming() != HttpStreamWriter::NO_BODY) {
+    auto stream = std::make_shared<HttpStreamWriter>(
+        conn, response.streamCallback(), response.streamFraming());
+    std::weak_ptr<TcpConnection> weak_conn(conn);
+    stream->setEndCallback([this, weak_conn,
+                            end_close = response.closeConnection()] {
+      onStreamEnd(weak_conn, end_close);
+    });
+    std::any_cast<HttpContext>(conn->getMutableContext())->setStream(stream);
   }
+  return response.closeConnection();
 }
 
 } // namespace lynx
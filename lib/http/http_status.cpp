@@ -14,4 +14,16 @@ const char *statusToString(const HttpStatus &s) {
   }
 }
 
+std::string_view statusLine(const HttpStatus &s) {
+  switch (s) {
+#define XX(code, name, msg)                                                    \
+  case HttpStatus::name:                                                       \
+    return "HTTP/1.1 " #code " " #msg "\r\n";
+    HTTP_STATUS_MAP(XX)
+#undef XX
+  default:
+    return {};
+  }
+}
+
 } // namespace lynx
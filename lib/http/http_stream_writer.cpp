@@ -0,0 +1,193 @@
+#include "lynx/http/http_stream_writer.h"
+#include "lynx/net/buffer.h"
+#include "lynx/net/chain_buffer.h"
+#include "lynx/net/event_loop.h"
+#include "lynx/net/tcp_connection.h"
+
+#include <algorithm>
+#include <charconv>
+#include <string>
+#include <type_traits>
+
+namespace lynx {
+
+HttpStreamWriter::HttpStreamWriter(const std::shared_ptr<TcpConnection> &conn,
+                                   StreamCallback cb, Framing framing)
+    : conn_(conn), stream_callback_(std::move(cb)), framing_(framing),
+      ended_(false), paused_(false), pending_end_(false),
+      drain_queued_(false) {}
+
+void HttpStreamWriter::write(std::string_view data) {
+  std::shared_ptr<TcpConnection> conn = conn_.lock();
+  if (data.empty() || framing_ == NO_BODY || !conn) {
+    return;
+  }
+  if (conn->getLoop()->isInLoopThread()) {
+    /// After what other threads wrote before
+    drain();
+    writeInLoop(data);
+  } else {
+    post(conn, data, false);
+  }
+}
+
+void HttpStreamWriter::end() {
+  std::shared_ptr<TcpConnection> conn = conn_.lock();
+  if (!conn) {
+    /// Nobody to end the stream for, the server dropped the end callback
+    ended_ = true;
+    return;
+  }
+  if (conn->getLoop()->isInLoopThread()) {
+    drain();
+    endInLoop();
+  } else {
+    post(conn, {}, true);
+  }
+}
+
+bool HttpStreamWriter::writable() const {
+  std::shared_ptr<TcpConnection> conn = conn_.lock();
+  if (ended_ || paused_ || !conn || !conn->connected()) {
+    return false;
+  }
+  size_t unsent = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    unsent = pending_.readableBytes();
+  }
+  /// The output buffer belongs to the loop, other threads rely on paused_
+  if (conn->getLoop()->isInLoopThread()) {
+    unsent += conn->pendingBytes();
+  }
+  return unsent < conn->highWaterMark();
+}
+
+void HttpStreamWriter::resume() {
+  paused_ = false;
+  if (writable()) {
+    stream_callback_(shared_from_this());
+  }
+}
+
+void HttpStreamWriter::abort() {
+  ended_ = true;
+  end_callback_ = nullptr;
+}
+
+namespace detail {
+
+template <typename Output>
+void appendChunk(Output *output, std::string_view data) {
+  char size[24];
+  char *end = std::to_chars(size, size + 16, data.size(), 16).ptr;
+  end = std::copy_n("\r\n", 2, end);
+  if constexpr (std::is_same_v<Output, Buffer>) {
+    output->ensureWritableBytes((end - size) + data.size() + 2);
+  }
+  output->append(size, end - size);
+  output->append(data.data(), data.size());
+  output->append("\r\n", 2);
+}
+
+} // namespace detail
+
+void HttpStreamWriter::appendChunk(Buffer *output, std::string_view data) {
+  detail::appendChunk(output, data);
+}
+
+void HttpStreamWriter::appendChunk(ChainBuffer *output, std::string_view data) {
+  detail::appendChunk(output, data);
+}
+
+template <typename Output>
+void HttpStreamWriter::append(Output *output, std::string_view data) {
+  if (framing_ == CHUNKED) {
+    appendChunk(output, data);
+  } else {
+    output->append(data.data(), data.size());
+  }
+}
+
+void HttpStreamWriter::post(const std::shared_ptr<TcpConnection> &conn,
+                            std::string_view data, bool last) {
+  bool queue = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!data.empty()) {
+      append(&pending_, data);
+    }
+    pending_end_ = pending_end_ || last;
+    queue = !drain_queued_;
+    drain_queued_ = true;
+  }
+  if (queue) {
+    conn->getLoop()->queueInLoop(
+        [self = shared_from_this()] { self->drain(); });
+  }
+}
+
+void HttpStreamWriter::drain() {
+  std::shared_ptr<TcpConnection> conn = conn_.lock();
+  if (conn && !conn->getLoop()->isInLoopThread()) {
+    /// Queued before the connection moved to another loop, follow it
+    conn->getLoop()->queueInLoop(
+        [self = shared_from_this()] { self->drain(); });
+    return;
+  }
+  Buffer chunks;
+  bool last = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    chunks.swap(pending_);
+    last = pending_end_;
+    pending_end_ = false;
+    drain_queued_ = false;
+  }
+  if (chunks.readableBytes() > 0 && !ended_ && conn && conn->connected()) {
+    conn->outputBuffer()->append(chunks.peek(), chunks.readableBytes());
+    flush(conn);
+  }
+  if (last) {
+    endInLoop();
+  }
+}
+
+void HttpStreamWriter::writeInLoop(std::string_view data) {
+  std::shared_ptr<TcpConnection> conn = conn_.lock();
+  if (ended_ || !conn || !conn->connected()) {
+    return;
+  }
+  append(conn->outputBuffer(), data);
+  flush(conn);
+}
+
+void HttpStreamWriter::flush(const std::shared_ptr<TcpConnection> &conn) {
+  conn->flushOutputBuffer();
+  /// A connection already waiting for the socket does not report the mark
+  /// again, so see it here; the write complete callback resumes
+  if (conn->pendingBytes() >= conn->highWaterMark()) {
+    paused_ = true;
+  }
+}
+
+void HttpStreamWriter::endInLoop() {
+  if (ended_) {
+    return;
+  }
+  ended_ = true;
+  std::shared_ptr<TcpConnection> conn = conn_.lock();
+  /// A close-delimited body ends when the end callback shuts down
+  if (framing_ == CHUNKED && conn && conn->connected()) {
+    conn->outputBuffer()->append("0\r\n\r\n", 5);
+    conn->flushOutputBuffer();
+  }
+  /// Release the callback before running it, it may drop the last owner
+  EndCallback cb;
+  cb.swap(end_callback_);
+  if (cb) {
+    cb();
+  }
+}
+
+} // namespace lynx
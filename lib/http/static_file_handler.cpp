@@ -0,0 +1,339 @@
+#include "lynx/http/static_file_handler.h"
+#include "lynx/http/http_request.h"
+#include "lynx/http/http_response.h"
+#include "lynx/logger/logging.h"
+
+#include <charconv>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace lynx {
+
+namespace detail {
+
+/// How long a cached stat result is trusted
+constexpr double K_REVALIDATE_SECONDS = 1.0;
+
+#define STATIC_CONTENT_TYPE_MAP(XX)                                            \
+  XX("html", "text/html; charset=utf-8")                                       \
+  XX("htm", "text/html; charset=utf-8")                                        \
+  XX("css", "text/css; charset=utf-8")                                         \
+  XX("js", "text/javascript; charset=utf-8")                                   \
+  XX("json", "application/json")                                              \
+  XX("txt", "text/plain; charset=utf-8")                                       \
+  XX("xml", "application/xml")                                                 \
+  XX("svg", "image/svg+xml")                                                   \
+  XX("png", "image/png")                                                       \
+  XX("jpg", "image/jpeg")                                                      \
+  XX("jpeg", "image/jpeg")                                                     \
+  XX("gif", "image/gif")                                                       \
+  XX("webp", "image/webp")                                                     \
+  XX("ico", "image/x-icon")                                                    \
+  XX("woff", "font/woff")                                                      \
+  XX("woff2", "font/woff2")                                                    \
+  XX("wasm", "application/wasm")                                              \
+  XX("pdf", "application/pdf")                                                 \
+  XX("mp4", "video/mp4")
+
+const char *contentType(std::string_view path) {
+  size_t dot = path.rfind('.');
+  if (dot != std::string_view::npos && path.find('/', dot) == path.npos) {
+    std::string_view ext = path.substr(dot + 1);
+#define XX(extension, type)                                                    \
+  if (equalsIgnoreCase(ext, extension)) {                                      \
+    return type;                                                               \
+  }
+    STATIC_CONTENT_TYPE_MAP(XX)
+#undef XX
+  }
+  return "application/octet-stream";
+}
+
+/// Formats `t` as an IMF-fixdate, e.g. "Sun, 06 Nov 1994 08:49:37 GMT"
+std::string httpDate(time_t t) {
+  struct tm tm_time;
+  gmtime_r(&t, &tm_time);
+  char buf[32];
+  size_t n = strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &tm_time);
+  return std::string(buf, n);
+}
+
+/// Parses an IMF-fixdate, returns -1 if it is not one
+time_t parseHttpDate(std::string_view date) {
+  std::string s(date);
+  struct tm tm_time = {};
+  const char *end = strptime(s.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &tm_time);
+  if (end == nullptr || *end != '\0') {
+    return -1;
+  }
+  return timegm(&tm_time);
+}
+
+/// Returns true if `etag` is in the If-None-Match list `header`
+bool etagMatches(std::string_view header, std::string_view etag) {
+  while (!header.empty()) {
+    size_t comma = header.find(',');
+    std::string_view tag = header.substr(0, comma);
+    while (!tag.empty() && tag.front() == ' ') {
+      tag.remove_prefix(1);
+    }
+    while (!tag.empty() && tag.back() == ' ') {
+      tag.remove_suffix(1);
+    }
+    /// Weak comparison, as If-None-Match requires
+    if (tag.starts_with("W/")) {
+      tag.remove_prefix(2);
+    }
+    if (tag == "*" || tag == etag) {
+      return true;
+    }
+    if (comma == std::string_view::npos) {
+      break;
+    }
+    header.remove_prefix(comma + 1);
+  }
+  return false;
+}
+
+/**
+ * Parses a single "bytes=first-last", "bytes=first-" or "bytes=-suffix" range
+ * of a file of `size` bytes. Returns 1 and sets [*first, *last] if it is
+ * satisfiable, 0 if it is not and -1 if the header is to be ignored (a
+ * malformed or multi-range header, served with the whole file).
+ */
+int parseRange(std::string_view header, off_t size, off_t *first,
+               off_t *last) {
+  if (!header.starts_with("bytes=") || header.find(',') != header.npos) {
+    return -1;
+  }
+  header.remove_prefix(6);
+  size_t dash = header.find('-');
+  if (dash == std::string_view::npos) {
+    return -1;
+  }
+  std::string_view lo = header.substr(0, dash);
+  std::string_view hi = header.substr(dash + 1);
+  auto toOff = [](std::string_view s, off_t *v) {
+    auto [p, ec] = std::from_chars(s.data(), s.data() + s.size(), *v);
+    return ec == std::errc() && p == s.data() + s.size() && *v >= 0;
+  };
+  off_t a = 0;
+  off_t b = 0;
+  if (lo.empty()) {
+    if (!toOff(hi, &b) || b == 0) {
+      return hi.empty() ? -1 : 0;
+    }
+    *first = b >= size ? 0 : size - b;
+    *last = size - 1;
+    return size > 0 ? 1 : 0;
+  }
+  if (!toOff(lo, &a) || (!hi.empty() && (!toOff(hi, &b) || b < a))) {
+    return -1;
+  }
+  if (a >= size) {
+    return 0;
+  }
+  *first = a;
+  *last = hi.empty() || b >= size ? size - 1 : b;
+  return 1;
+}
+
+} // namespace detail
+
+StaticFileHandler::File::File(int fd, const struct stat &st,
+                              const std::string &path, MonoTime checked)
+    : fd_(fd), size_(st.st_size), mtime_(st.st_mtime), ino_(st.st_ino),
+      last_modified_(detail::httpDate(st.st_mtime)),
+      content_type_(detail::contentType(path)),
+      checked_(checked.microsecs()) {
+  char buf[64];
+  int n = snprintf(buf, sizeof(buf), "\"%lx-%lx-%lx\"",
+                   static_cast<unsigned long>(ino_),
+                   static_cast<unsigned long>(mtime_),
+                   static_cast<unsigned long>(size_));
+  etag_.assign(buf, n);
+}
+
+StaticFileHandler::File::~File() { ::close(fd_); }
+
+StaticFileHandler::StaticFileHandler(const std::string &root,
+                                     const std::string &prefix,
+                                     size_t cacheCapacity)
+    : root_(root), prefix_(prefix), capacity_(cacheCapacity) {}
+
+std::string StaticFileHandler::resolve(std::string_view path) const {
+  /// "/static" serves "/static/..." but not "/staticfoo"
+  if (!path.starts_with(prefix_) ||
+      (path.size() != prefix_.size() && path[prefix_.size()] != '/')) {
+    return {};
+  }
+  path.remove_prefix(prefix_.size());
+  std::string decoded = detail::urlDecode(path, false);
+  if (decoded.find('\0') != std::string::npos) {
+    return {};
+  }
+  /// Reject any ".." segment, so the path cannot leave the root
+  std::string_view rest(decoded);
+  while (!rest.empty()) {
+    size_t slash = rest.find('/');
+    if (rest.substr(0, slash) == "..") {
+      return {};
+    }
+    if (slash == std::string_view::npos) {
+      break;
+    }
+    rest.remove_prefix(slash + 1);
+  }
+  if (decoded.empty() || decoded.front() != '/') {
+    decoded.insert(decoded.begin(), '/');
+  }
+  if (decoded.back() == '/') {
+    decoded += "index.html";
+  }
+  return root_ + decoded;
+}
+
+StaticFileHandler::FilePtr StaticFileHandler::open(const std::string &path,
+                                                   MonoTime now) {
+  FilePtr cached;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(path);
+    if (it != index_.end()) {
+      lru_.splice(lru_.begin(), lru_, it->second);
+      cached = it->second->second;
+    }
+  }
+  if (cached && timeDiff(now, MonoTime(cached->checked_.load())) <
+                    detail::K_REVALIDATE_SECONDS) {
+    return cached;
+  }
+
+  struct stat st;
+  if (::stat(path.c_str(), &st) < 0) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(path);
+    if (it != index_.end()) {
+      lru_.erase(it->second);
+      index_.erase(it);
+    }
+    return nullptr;
+  }
+  if (cached && cached->ino_ == st.st_ino && cached->mtime_ == st.st_mtime &&
+      cached->size_ == st.st_size) {
+    /// Unchanged, only the time of the check moves
+    cached->checked_.store(now.microsecs());
+    return cached;
+  }
+  if (!S_ISREG(st.st_mode)) {
+    return nullptr;
+  }
+
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    LOG_SYSERR << "StaticFileHandler::open " << path;
+    return nullptr;
+  }
+  /// Describe the opened file, it may have changed since the stat above
+  if (::fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+    ::close(fd);
+    return nullptr;
+  }
+  auto file = std::make_shared<const File>(fd, st, path, now);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = index_.find(path);
+  if (it != index_.end()) {
+    it->second->second = file;
+    lru_.splice(lru_.begin(), lru_, it->second);
+  } else {
+    lru_.emplace_front(path, file);
+    index_[path] = lru_.begin();
+    if (lru_.size() > capacity_) {
+      /// In-flight responses own the evicted file until they are sent
+      index_.erase(lru_.back().first);
+      lru_.pop_back();
+    }
+  }
+  return file;
+}
+
+void StaticFileHandler::operator()(const HttpRequest &req,
+                                   HttpResponse *resp) {
+  if (req.method() != HttpMethod::GET && req.method() != HttpMethod::HEAD) {
+    resp->setStatusCode(HttpStatus::METHOD_NOT_ALLOWED);
+    resp->addHeader("Allow", "GET, HEAD");
+    return;
+  }
+  std::string path = resolve(req.path());
+  if (path.empty()) {
+    resp->setStatusCode(HttpStatus::FORBIDDEN);
+    return;
+  }
+  /// A scheduler tick is plenty for revalidating once a second
+  MonoTime now = MonoTime::coarseNow();
+  FilePtr file = open(path, now);
+  if (!file && path.back() != '/') {
+    /// A directory named without the trailing slash
+    file = open(path + "/index.html", now);
+  }
+  if (!file) {
+    resp->setStatusCode(HttpStatus::NOT_FOUND);
+    return;
+  }
+
+  resp->addHeader("ETag", file->etag_);
+  resp->addHeader("Last-Modified", file->last_modified_);
+  resp->addHeader("Accept-Ranges", "bytes");
+
+  /// If-None-Match takes precedence over If-Modified-Since
+  std::string_view none_match = req.getHeader("If-None-Match");
+  bool not_modified = false;
+  if (!none_match.empty()) {
+    not_modified = detail::etagMatches(none_match, file->etag_);
+  } else {
+    std::string_view since = req.getHeader("If-Modified-Since");
+    time_t t = since.empty() ? -1 : detail::parseHttpDate(since);
+    not_modified = t >= 0 && file->mtime_ <= t;
+  }
+  if (not_modified) {
+    resp->setStatusCode(HttpStatus::NOT_MODIFIED);
+    return;
+  }
+
+  off_t first = 0;
+  off_t last = file->size_ - 1;
+  bool partial = false;
+  std::string_view range = req.getHeader("Range");
+  /// A stale If-Range validator gets the whole file
+  std::string_view if_range = req.getHeader("If-Range");
+  if (!range.empty() && (if_range.empty() || if_range == file->etag_ ||
+                         if_range == file->last_modified_)) {
+    int ok = detail::parseRange(range, file->size_, &first, &last);
+    if (ok == 0) {
+      resp->setStatusCode(HttpStatus::RANGE_NOT_SATISFIABLE);
+      resp->addHeader("Content-Range",
+                      "bytes */" + std::to_string(file->size_));
+      return;
+    }
+    partial = ok > 0;
+  }
+  if (partial) {
+    resp->setStatusCode(HttpStatus::PARTIAL_CONTENT);
+    resp->addHeader("Content-Range", "bytes " + std::to_string(first) + "-" +
+                                         std::to_string(last) + "/" +
+                                         std::to_string(file->size_));
+  } else {
+    first = 0;
+    last = file->size_ - 1;
+    resp->setStatusCode(HttpStatus::OK);
+  }
+  resp->setContentType(file->content_type_);
+  if (file->size_ > 0) {
+    resp->setFileBody(file->fd_, first, static_cast<size_t>(last - first + 1),
+                      file);
+  }
+}
+
+} // namespace lynx
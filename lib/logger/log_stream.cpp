@@ -147,6 +147,11 @@ LogStream &LogStream::operator<<(const std::string &str) {
   return *this;
 }
 
+LogStream &LogStream::operator<<(std::string_view str) {
+  buffer_.append(str.data(), str.size());
+  return *this;
+}
+
 LogStream &LogStream::operator<<(const Buffer &v) {
   *this << v.toString();
   return *this;
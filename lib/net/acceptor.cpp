@@ -48,8 +48,22 @@ void Acceptor::listen() {
 
 void Acceptor::handleRead() {
   loop_->assertInLoopThread();
-  InetAddress peer_addr;
+  if (!accept_channel_.edgeTriggered()) {
+    acceptOne();
+    return;
+  }
+  /// No new edge comes until the backlog was found empty
+  for (int i = 0; i < K_ACCEPT_BUDGET; ++i) {
+    if (!acceptOne()) {
+      return;
+    }
+  }
+  /// Budget spent, be reported again after the other ready channels
+  accept_channel_.rearm();
+}
 
+bool Acceptor::acceptOne() {
+  InetAddress peer_addr;
   int connfd = accept_socket_.accept(&peer_addr);
   if (connfd >= 0) {
     if (new_connection_callback_) {
@@ -59,15 +73,20 @@ void Acceptor::handleRead() {
         LOG_SYSERR << "close";
       }
     }
-  } else {
-    LOG_SYSERR << "in Acceptor::handleRead";
-    if (errno == EMFILE) {
-      ::close(idle_fd_);
-      idle_fd_ = ::accept(accept_socket_.fd(), nullptr, nullptr);
-      ::close(idle_fd_);
-      idle_fd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
-    }
+    return true;
+  }
+  int saved_errno = errno;
+  if (saved_errno == EAGAIN) {
+    return false;
+  }
+  LOG_SYSERR << "in Acceptor::handleRead";
+  if (saved_errno == EMFILE) {
+    ::close(idle_fd_);
+    idle_fd_ = ::accept(accept_socket_.fd(), nullptr, nullptr);
+    ::close(idle_fd_);
+    idle_fd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
   }
+  return true;
 }
 
 } // namespace lynx
@@ -0,0 +1,156 @@
+#include "lynx/net/byte_scan.h"
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace lynx {
+
+namespace {
+
+#if defined(__AVX2__)
+
+using Vec = __m256i;
+const long K_WIDTH = 32;
+
+Vec load(const char *p) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+}
+Vec splat(char c) { return _mm256_set1_epi8(c); }
+uint32_t eqMask(Vec a, Vec b) {
+  return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b)));
+}
+Vec loadTable(const uint8_t *table) {
+  return _mm256_broadcastsi128_si256(
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(table)));
+}
+/// Bytes of `v` whose row bit is clear, i.e. that are not in the set
+uint32_t notInMask(Vec v, Vec rows, Vec bits) {
+  const Vec nibble = _mm256_set1_epi8(0x0F);
+  Vec lo = _mm256_and_si256(v, nibble);
+  Vec hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble);
+  Vec hit = _mm256_and_si256(_mm256_shuffle_epi8(rows, lo),
+                             _mm256_shuffle_epi8(bits, hi));
+  return eqMask(hit, _mm256_setzero_si256());
+}
+#define LYNX_SCAN_HAS_SHUFFLE 1
+
+#elif defined(__SSE2__)
+
+using Vec = __m128i;
+const long K_WIDTH = 16;
+
+Vec load(const char *p) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+}
+Vec splat(char c) { return _mm_set1_epi8(c); }
+uint32_t eqMask(Vec a, Vec b) {
+  return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)));
+}
+#if defined(__SSSE3__)
+Vec loadTable(const uint8_t *table) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i *>(table));
+}
+uint32_t notInMask(Vec v, Vec rows, Vec bits) {
+  const Vec nibble = _mm_set1_epi8(0x0F);
+  Vec lo = _mm_and_si128(v, nibble);
+  Vec hi = _mm_and_si128(_mm_srli_epi16(v, 4), nibble);
+  Vec hit =
+      _mm_and_si128(_mm_shuffle_epi8(rows, lo), _mm_shuffle_epi8(bits, hi));
+  return eqMask(hit, _mm_setzero_si128());
+}
+#define LYNX_SCAN_HAS_SHUFFLE 1
+#endif
+
+#endif
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#define LYNX_SCAN_HAS_SIMD 1
+#endif
+
+} // namespace
+
+const char *findCRLF(const char *begin, const char *end) {
+  const char *p = begin;
+#ifdef LYNX_SCAN_HAS_SIMD
+  const Vec cr = splat('\r');
+  const Vec lf = splat('\n');
+  for (; end - p >= K_WIDTH + 1; p += K_WIDTH) {
+    uint32_t mask = eqMask(load(p), cr) & eqMask(load(p + 1), lf);
+    if (mask != 0) {
+      return p + __builtin_ctz(mask);
+    }
+  }
+#endif
+  for (; end - p >= 2; ++p) {
+    if (p[0] == '\r' && p[1] == '\n') {
+      return p;
+    }
+  }
+  return end;
+}
+
+const char *findCRLFCRLF(const char *begin, const char *end) {
+  const char *p = begin;
+#ifdef LYNX_SCAN_HAS_SIMD
+  const Vec cr = splat('\r');
+  const Vec lf = splat('\n');
+  for (; end - p >= K_WIDTH + 3; p += K_WIDTH) {
+    uint32_t mask = eqMask(load(p), cr) & eqMask(load(p + 1), lf) &
+                    eqMask(load(p + 2), cr) & eqMask(load(p + 3), lf);
+    if (mask != 0) {
+      return p + __builtin_ctz(mask);
+    }
+  }
+#endif
+  for (; end - p >= 4; ++p) {
+    if (p[0] == '\r' && p[1] == '\n' && p[2] == '\r' && p[3] == '\n') {
+      return p;
+    }
+  }
+  return end;
+}
+
+const char *findEither(const char *begin, const char *end, char a, char b) {
+  const char *p = begin;
+#ifdef LYNX_SCAN_HAS_SIMD
+  const Vec va = splat(a);
+  const Vec vb = splat(b);
+  for (; end - p >= K_WIDTH; p += K_WIDTH) {
+    Vec v = load(p);
+    uint32_t mask = eqMask(v, va) | eqMask(v, vb);
+    if (mask != 0) {
+      return p + __builtin_ctz(mask);
+    }
+  }
+#endif
+  for (; p < end; ++p) {
+    if (*p == a || *p == b) {
+      return p;
+    }
+  }
+  return end;
+}
+
+const char *findNotIn(const char *begin, const char *end, const ByteSet &set) {
+  const char *p = begin;
+#ifdef LYNX_SCAN_HAS_SHUFFLE
+  static const uint8_t K_ROW_BITS[16] = {1, 2, 4, 8, 16, 32, 64, 128};
+  const Vec rows = loadTable(set.rows());
+  const Vec bits = loadTable(K_ROW_BITS);
+  for (; end - p >= K_WIDTH; p += K_WIDTH) {
+    uint32_t mask = notInMask(load(p), rows, bits);
+    if (mask != 0) {
+      return p + __builtin_ctz(mask);
+    }
+  }
+#endif
+  for (; p < end; ++p) {
+    if (!set.contains(*p)) {
+      return p;
+    }
+  }
+  return end;
+}
+
+} // namespace lynx
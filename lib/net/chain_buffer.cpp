@@ -0,0 +1,168 @@
+#include "lynx/net/chain_buffer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <sys/uio.h>
+
+namespace lynx {
+
+const size_t ChainBuffer::K_SLAB_SIZE;
+const size_t ChainBuffer::K_MIN_SLICE;
+const int ChainBuffer::K_MAX_IOVECS;
+
+size_t ChainBuffer::writableBytes() const {
+  if (segments_.empty() || !segments_.back().slab_) {
+    return 0;
+  }
+  return segments_.back().capacity_ - segments_.back().end_;
+}
+
+void ChainBuffer::addSlab(size_t capacity) {
+  std::unique_ptr<char[]> slab;
+  if (capacity == K_SLAB_SIZE && spare_) {
+    slab.swap(spare_);
+  } else {
+    slab.reset(new char[capacity]);
+  }
+  const char *data = slab.get();
+  segments_.push_back(Segment{data, 0, 0, capacity, std::move(slab), nullptr});
+}
+
+void ChainBuffer::append(const char *data, size_t len) {
+  while (len > 0) {
+    size_t writable = writableBytes();
+    if (writable == 0) {
+      addSlab(K_SLAB_SIZE);
+      writable = K_SLAB_SIZE;
+    }
+    size_t n = std::min(writable, len);
+    memcpy(beginWrite(), data, n);
+    hasWritten(n);
+    data += n;
+    len -= n;
+  }
+}
+
+void ChainBuffer::appendSlice(const char *data, size_t len,
+                              std::shared_ptr<const void> owner) {
+  if (len < K_MIN_SLICE) {
+    append(data, len);
+    return;
+  }
+  segments_.push_back(Segment{data, 0, len, len, nullptr, std::move(owner)});
+  readable_ += len;
+}
+
+void ChainBuffer::ensureWritableBytes(size_t len) {
+  if (writableBytes() < len) {
+    addSlab(std::max(len, K_SLAB_SIZE));
+  }
+  assert(writableBytes() >= len);
+}
+
+char *ChainBuffer::beginWrite() {
+  assert(!segments_.empty() && segments_.back().slab_);
+  Segment &back = segments_.back();
+  return back.slab_.get() + back.end_;
+}
+
+void ChainBuffer::hasWritten(size_t len) {
+  assert(len <= writableBytes());
+  segments_.back().end_ += len;
+  readable_ += len;
+}
+
+void ChainBuffer::popFront() {
+  Segment &front = segments_.front();
+  if (front.slab_ && front.capacity_ == K_SLAB_SIZE && !spare_) {
+    spare_.swap(front.slab_);
+  }
+  segments_.pop_front();
+}
+
+void ChainBuffer::retrieve(size_t len) {
+  assert(len <= readable_);
+  readable_ -= len;
+  while (len > 0) {
+    Segment &front = segments_.front();
+    size_t n = std::min(front.readable(), len);
+    front.begin_ += n;
+    len -= n;
+    if (front.begin_ < front.end_) {
+      break;
+    }
+    if (segments_.size() == 1 && front.slab_) {
+      /// Keep the last slab, the next append reuses it from the start
+      front.begin_ = front.end_ = 0;
+    } else {
+      popFront();
+    }
+  }
+}
+
+void ChainBuffer::retrieveAll() {
+  while (segments_.size() > 1) {
+    popFront();
+  }
+  if (!segments_.empty() && segments_.front().slab_) {
+    segments_.front().begin_ = segments_.front().end_ = 0;
+  } else {
+    segments_.clear();
+  }
+  readable_ = 0;
+}
+
+std::string ChainBuffer::toString() const {
+  std::string result;
+  result.reserve(readable_);
+  for (const auto &segment : segments_) {
+    result.append(segment.data_ + segment.begin_, segment.readable());
+  }
+  return result;
+}
+
+std::string ChainBuffer::retrieveAllAsString() {
+  std::string result = toString();
+  retrieveAll();
+  return result;
+}
+
+ssize_t ChainBuffer::writeFd(int fd, size_t maxBytes, int *savedErrno) {
+  size_t written = 0;
+  maxBytes = std::min(maxBytes, readable_);
+  while (written < maxBytes) {
+    /// Gather the segments holding the next bytes, up to K_MAX_IOVECS of them
+    struct iovec vec[K_MAX_IOVECS];
+    int iovcnt = 0;
+    size_t offered = 0;
+    for (auto it = segments_.begin();
+         it != segments_.end() && iovcnt < K_MAX_IOVECS &&
+         written + offered < maxBytes;
+         ++it) {
+      size_t len = std::min(it->readable(), maxBytes - written - offered);
+      if (len == 0) {
+        continue;
+      }
+      vec[iovcnt].iov_base = const_cast<char *>(it->data_ + it->begin_);
+      vec[iovcnt].iov_len = len;
+      offered += len;
+      ++iovcnt;
+    }
+
+    ssize_t n = ::writev(fd, vec, iovcnt);
+    if (n < 0) {
+      *savedErrno = errno;
+      return written > 0 ? static_cast<ssize_t>(written) : -1;
+    }
+    retrieve(n);
+    written += n;
+    if (static_cast<size_t>(n) < offered) {
+      break;
+    }
+  }
+  return static_cast<ssize_t>(written);
+}
+
+} // namespace lynx
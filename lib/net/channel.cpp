@@ -14,8 +14,8 @@ const int Channel::K_WRITE_EVENT = POLLOUT;
 
 Channel::Channel(EventLoop *loop, int fd__)
     : loop_(loop), fd_(fd__), events_(0), revents_(0), index_(-1),
-      log_hup_(true), tied_(false), event_handling_(false),
-      added_to_loop_(false) {}
+      log_hup_(true), edge_triggered_(false), tied_(false),
+      event_handling_(false), added_to_loop_(false) {}
 
 Channel::~Channel() {
   assert(!event_handling_);
@@ -41,6 +41,12 @@ void Channel::remove() {
   loop_->removeChannel(this);
 }
 
+void Channel::detach(DetachCallback cb) {
+  assert(isNoneEvent());
+  added_to_loop_ = false;
+  loop_->detachChannel(this, std::move(cb));
+}
+
 void Channel::handleEvent(Timestamp receiveTime) {
   std::shared_ptr<void> guard;
   if (tied_) {
@@ -51,11 +57,16 @@ void Channel::handleEvent(Timestamp receiveTime) {
   } else {
     handleEventWithGuard(receiveTime);
   }
+  received_.clear();
 }
 
 void Channel::handleEventWithGuard(Timestamp receiveTime) {
   event_handling_ = true;
   LOG_TRACE << reventsToString();
+  /// Received bytes come first, a hang up is reported after them
+  for (const Received &received : received_) {
+    receive_callback_(received.data_, received.n_, receiveTime);
+  }
   if (((revents_ & POLLHUP) != 0) && ((revents_ & POLLIN) == 0)) {
     if (log_hup_) {
       LOG_WARN << "fd = " << fd_ << " Channel::handle_event() POLLHUP";
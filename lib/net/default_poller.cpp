@@ -0,0 +1,21 @@
+#include "lynx/logger/logging.h"
+#include "lynx/net/epoller.h"
+#include "lynx/net/uring_poller.h"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace lynx {
+
+Poller *Poller::newDefaultPoller(EventLoop *loop) {
+  const char *backend = ::getenv("LYNX_POLLER");
+  if (backend != nullptr && ::strcmp(backend, "io_uring") == 0) {
+    if (UringPoller::available()) {
+      return new UringPoller(loop);
+    }
+    LOG_WARN << "io_uring is not available, falling back to epoll";
+  }
+  return new Epoller(loop);
+}
+
+} // namespace lynx
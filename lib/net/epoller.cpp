@@ -12,7 +12,7 @@ const int K_ADDED = 1;
 const int K_DELETED = 2;
 
 Epoller::Epoller(EventLoop *loop)
-    : owner_loop_(loop), epollfd_(::epoll_create1(EPOLL_CLOEXEC)),
+    : Poller(loop), epollfd_(::epoll_create1(EPOLL_CLOEXEC)),
       events_(K_INIT_EVENT_LIST_SIZE) {
   if (epollfd_ < 0) {
     LOG_SYSFATAL << "Epoller::Epoller";
@@ -21,12 +21,12 @@ Epoller::Epoller(EventLoop *loop)
 
 Epoller::~Epoller() { ::close(epollfd_); }
 
-Timestamp Epoller::poll(int timeoutMs, ChannelList *activeChannels) {
+MonoTime Epoller::poll(int timeoutMs, ChannelList *activeChannels) {
   LOG_TRACE << "fd total count " << channels_.size();
   int num_events = ::epoll_wait(epollfd_, &*events_.begin(),
                                 static_cast<int>(events_.size()), timeoutMs);
   int saved_errno = errno;
-  Timestamp now(Timestamp::now());
+  MonoTime now(MonoTime::now());
   if (num_events > 0) {
     LOG_TRACE << num_events << " events happened";
     fillActiveChannels(num_events, activeChannels);
@@ -106,16 +106,13 @@ void Epoller::removeChannel(Channel *channel) {
   channel->setIndex(K_NEW);
 }
 
-bool Epoller::hasChannel(Channel *channel) const {
-  assertInLoopThread();
-  auto it = channels_.find(channel->fd());
-  return it != channels_.end() && it->second == channel;
-}
-
 void Epoller::update(int operation, Channel *channel) {
   struct epoll_event event;
   memset(&event, 0, sizeof(event));
   event.events = channel->events();
+  if (channel->edgeTriggered()) {
+    event.events |= EPOLLET;
+  }
   event.data.ptr = channel;
   int fd = channel->fd();
   LOG_TRACE << "epoll_ctl op = " << operationToString(operation)
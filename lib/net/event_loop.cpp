@@ -1,9 +1,10 @@
 #include "lynx/net/event_loop.h"
 #include "lynx/logger/logging.h"
 #include "lynx/net/channel.h"
-#include "lynx/net/epoller.h"
+#include "lynx/net/poller.h"
 
 #include "lynx/timer/timer_queue.h"
+#include "lynx/timer/timing_wheel.h"
 
 #include <cassert>
 #include <csignal>
@@ -17,6 +18,10 @@ thread_local EventLoop *t_loop_in_this_thread = nullptr;
 
 const int K_POLL_TIME_MS = 10000;
 
+/// Idle timeouts of up to about four minutes take one turn
+const double K_WHEEL_TICK = 1.0;
+const size_t K_WHEEL_BUCKETS = 256;
+
 int createEventfd() {
   int evtfd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
   if (evtfd < 0) {
@@ -40,12 +45,19 @@ EventLoop *EventLoop::getEventLoopOfCurrentThread() {
 
 EventLoop::EventLoop()
     : looping_(false), quit_(false), event_handling_(false),
-      calling_pending_functors_(false), thread_id_(current_thread::tid()),
-      poller_(new Epoller(this)), timer_queue_(new TimerQueue(this)),
+      thread_id_(current_thread::tid()),
+      poller_(Poller::newDefaultPoller(this)),
+      timer_queue_(TimerQueue::newDefaultTimerQueue(this)),
       wakeup_fd_(createEventfd()),
       wakeup_channel_(new Channel(this, wakeup_fd_)),
-      current_active_channel_(nullptr) {
-  LOG_DEBUG << "EventLoop created " << this << " in thread " << thread_id_;
+      current_active_channel_(nullptr), needs_wakeup_(false),
+      connection_count_(0), busy_ratio_(0.0),
+      busy_window_start_(MonoTime::now()), busy_us_(0),
+      wall_offset_us_(wallOffset()) {
+  LOG_DEBUG << "EventLoop created " << this << " in thread " << thread_id_
+            << " polling with " << poller_->name() << ", "
+            << timer_queue_->name() << " timers"
+            << (timer_queue_->usesTimerfd() ? "" : " without timerfd");
   if (t_loop_in_this_thread != nullptr) {
     LOG_FATAL << "Another EventLoop " << t_loop_in_this_thread
               << " exists in this thread " << thread_id_;
@@ -59,6 +71,8 @@ EventLoop::EventLoop()
 EventLoop::~EventLoop() {
   LOG_DEBUG << "EventLoop " << this << " of thread " << thread_id_
             << " destructs in thread " << current_thread::tid();
+  /// Its timer goes first, while the timer queue is still there
+  timing_wheel_.reset();
   wakeup_channel_->disableAll();
   wakeup_channel_->remove();
   ::close(wakeup_fd_);
@@ -72,9 +86,21 @@ void EventLoop::loop() {
   quit_ = false;
   LOG_TRACE << "EventLoop " << this << " start looping";
 
+  /// When the last iteration ended, read once for the busy ratio and the
+  /// poll timeout
+  MonoTime iteration_end(MonoTime::now());
   while (!quit_) {
     active_channels_.clear();
-    poll_return_time_ = poller_->poll(K_POLL_TIME_MS, &active_channels_);
+    /// Publish that the loop may sleep, then look for work queued before
+    /// that; a producer queueing after it sees the flag and wakes us
+    needs_wakeup_.store(true, std::memory_order_seq_cst);
+    int timeout_ms = pending_functors_.empty()
+                         ? timer_queue_->pollTimeout(iteration_end,
+                                                     K_POLL_TIME_MS)
+                         : 0;
+    loop_now_ = poller_->poll(timeout_ms, &active_channels_);
+    poll_return_time_ = Timestamp(loop_now_.microsecs() + wall_offset_us_);
+    needs_wakeup_.store(false, std::memory_order_relaxed);
     if (Logger::logLevel() <= Logger::TRACE) {
       printActiveChannels();
     }
@@ -85,8 +111,15 @@ void EventLoop::loop() {
     }
     current_active_channel_ = nullptr;
     event_handling_ = false;
+    /// Without a timerfd, the poll timeout is what woke us for the timers
+    timer_queue_->expireDue(loop_now_);
     doPendingFunctors();
+    iteration_end = MonoTime::now();
+    updateBusyRatio(iteration_end);
   }
+  /// What was queued before quit(), e.g. the teardown of a connection by a
+  /// server being destroyed, still runs
+  doPendingFunctors();
 
   LOG_TRACE << "EventLoop " << this << " stop looping";
   looping_ = false;
@@ -108,32 +141,52 @@ void EventLoop::runInLoop(Functor cb) {
 }
 
 void EventLoop::queueInLoop(Functor cb) {
-  {
-    std::lock_guard<std::mutex> lock(mutex_);
-    pending_functors_.push_back(std::move(cb));
-  }
+  pending_functors_.push(std::move(cb));
 
-  if (!isInLoopThread() || calling_pending_functors_) {
+  /// From the loop thread, the loop checks the queue before it sleeps.
+  /// Otherwise only the first producer after the loop went to sleep pays for
+  /// the eventfd write.
+  if (!isInLoopThread() && needs_wakeup_.load(std::memory_order_seq_cst) &&
+      needs_wakeup_.exchange(false, std::memory_order_seq_cst)) {
     wakeup();
   }
 }
 
-size_t EventLoop::queueSize() const {
-  std::lock_guard<std::mutex> lock(mutex_);
-  return pending_functors_.size();
+size_t EventLoop::queueSize() const { return pending_functors_.size(); }
+
+void EventLoop::updateBusyRatio(MonoTime now) {
+  busy_us_ += now.microsecs() - loop_now_.microsecs();
+  int64_t window = now.microsecs() - busy_window_start_.microsecs();
+  if (window >= K_BUSY_WINDOW_US) {
+    busy_ratio_.store(static_cast<double>(busy_us_) /
+                          static_cast<double>(window),
+                      std::memory_order_relaxed);
+    busy_us_ = 0;
+    busy_window_start_ = now;
+    /// Follow a change of the wall clock within a window
+    wall_offset_us_ = wallOffset();
+  }
+}
+
+int64_t EventLoop::wallOffset() {
+  return Timestamp::now().microsecsSinceEpoch() - MonoTime::now().microsecs();
 }
 
 TimerId EventLoop::runAt(Timestamp time, TimerCallback cb) {
+  return runAfter(timeDiff(time, Timestamp::now()), std::move(cb));
+}
+
+TimerId EventLoop::runAt(MonoTime time, TimerCallback cb) {
   return timer_queue_->addTimer(std::move(cb), time, 0.0);
 }
 
 TimerId EventLoop::runAfter(double delay, TimerCallback cb) {
-  Timestamp time(addTime(Timestamp::now(), delay));
+  MonoTime time(addTime(MonoTime::now(), delay));
   return runAt(time, std::move(cb));
 }
 
 TimerId EventLoop::runEvery(double interval, TimerCallback cb) {
-  Timestamp time(addTime(Timestamp::now(), interval));
+  MonoTime time(addTime(MonoTime::now(), interval));
   return timer_queue_->addTimer(std::move(cb), time, interval);
 }
 
@@ -141,6 +194,15 @@ void EventLoop::cancel(TimerId timerId) {
   return timer_queue_->cancel(timerId);
 }
 
+TimingWheel *EventLoop::timingWheel() {
+  assertInLoopThread();
+  if (!timing_wheel_) {
+    timing_wheel_ =
+        std::make_unique<TimingWheel>(this, K_WHEEL_TICK, K_WHEEL_BUCKETS);
+  }
+  return timing_wheel_.get();
+}
+
 void EventLoop::updateChannel(Channel *channel) {
   assert(channel->ownerLoop() == this);
   assertInLoopThread();
@@ -158,6 +220,13 @@ void EventLoop::removeChannel(Channel *channel) {
   poller_->removeChannel(channel);
 }
 
+void EventLoop::detachChannel(Channel *channel, Channel::DetachCallback cb) {
+  assert(channel->ownerLoop() == this);
+  assertInLoopThread();
+  assert(!event_handling_);
+  poller_->detachChannel(channel, std::move(cb));
+}
+
 bool EventLoop::hasChannel(Channel *channel) {
   assert(channel->ownerLoop() == this);
   assertInLoopThread();
@@ -187,18 +256,15 @@ void EventLoop::handleRead() {
 }
 
 void EventLoop::doPendingFunctors() {
-  std::vector<Functor> functors;
-  calling_pending_functors_ = true;
-
-  {
-    std::lock_guard<std::mutex> lock(mutex_);
-    functors.swap(pending_functors_);
-  }
-
-  for (const Functor &functor : functors) {
-    functor();
+  /// Callbacks queued by these ones run in the next iteration, after I/O
+  size_t count = pending_functors_.size();
+  for (size_t i = 0; i < count; ++i) {
+    std::optional<Functor> functor = pending_functors_.pop();
+    if (!functor) {
+      break;
+    }
+    (*functor)();
   }
-  calling_pending_functors_ = false;
 }
 
 void EventLoop::printActiveChannels() const {
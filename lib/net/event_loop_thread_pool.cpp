@@ -1,8 +1,10 @@
 #include "lynx/net/event_loop_thread_pool.h"
 #include "lynx/net/event_loop.h"
 #include "lynx/net/event_loop_thread.h"
+#include "lynx/net/inet_address.h"
 
 #include <cassert>
+#include <netinet/in.h>
 
 namespace lynx {
 
@@ -23,6 +25,7 @@ void EventLoopThreadPool::start(const ThreadInitCallback &cb) {
     char buf[name_.size() + 32];
     snprintf(buf, sizeof(buf), "%s%d", name_.c_str(), i);
     auto *t = new EventLoopThread(cb, buf);
+    t->setCpuAffinity(affinity_.cpuFor(i));
     threads_.push_back(std::unique_ptr<EventLoopThread>(t));
     loops_.push_back(t->startLoop());
   }
@@ -46,6 +49,68 @@ EventLoop *EventLoopThreadPool::getNextLoop() {
   return loop;
 }
 
+EventLoop *EventLoopThreadPool::getLoopForPeer(const InetAddress &peerAddr) {
+  base_loop_->assertInLoopThread();
+  assert(started_);
+  if (!placement_policy_ || loops_.empty()) {
+    return getNextLoop();
+  }
+  return placement_policy_(loops_, peerAddr);
+}
+
+namespace {
+
+/// A policy choosing the loop of least `load`, scanning from where the last
+/// scan stopped so that ties rotate.
+template <typename Load>
+EventLoopThreadPool::PlacementPolicy leastLoaded(Load load) {
+  return [load, next = size_t{0}](const std::vector<EventLoop *> &loops,
+                                  const InetAddress &) mutable {
+    size_t n = loops.size();
+    size_t best = next % n;
+    auto best_load = load(loops[best]);
+    for (size_t i = 1; i < n; ++i) {
+      size_t j = (next + i) % n;
+      auto l = load(loops[j]);
+      if (l < best_load) {
+        best = j;
+        best_load = l;
+      }
+    }
+    next = best + 1;
+    return loops[best];
+  };
+}
+
+} // namespace
+
+EventLoopThreadPool::PlacementPolicy EventLoopThreadPool::leastConnections() {
+  return leastLoaded([](EventLoop *loop) { return loop->connectionCount(); });
+}
+
+EventLoopThreadPool::PlacementPolicy EventLoopThreadPool::leastQueued() {
+  return leastLoaded([](EventLoop *loop) { return loop->queueSize(); });
+}
+
+EventLoopThreadPool::PlacementPolicy EventLoopThreadPool::leastBusy() {
+  return leastLoaded([](EventLoop *loop) { return loop->busyRatio(); });
+}
+
+EventLoopThreadPool::PlacementPolicy EventLoopThreadPool::peerHash() {
+  return [](const std::vector<EventLoop *> &loops,
+            const InetAddress &peerAddr) {
+    const auto *addr =
+        reinterpret_cast<const struct sockaddr_in *>(peerAddr.getSockAddr());
+    /// Hashes the IPv4 address only, not the ephemeral port, so every
+    /// connection of a client maps to the same loop for as long as the pool
+    /// has the same loops. Multiplying by 2^64 / phi and keeping the high
+    /// bits spreads addresses that differ only in their last octet, such as
+    /// the clients of one subnet.
+    uint64_t h = ntohl(addr->sin_addr.s_addr) * 0x9E3779B97F4A7C15ULL;
+    return loops[(h >> 32) % loops.size()];
+  };
+}
+
 std::vector<EventLoop *> EventLoopThreadPool::getAllLoops() {
   base_loop_->assertInLoopThread();
   assert(started_);
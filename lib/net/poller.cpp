@@ -0,0 +1,17 @@
+#include "lynx/net/poller.h"
+#include "lynx/net/channel.h"
+
+namespace lynx {
+
+bool Poller::hasChannel(Channel *channel) const {
+  assertInLoopThread();
+  auto it = channels_.find(channel->fd());
+  return it != channels_.end() && it->second == channel;
+}
+
+void Poller::detachChannel(Channel *channel, Channel::DetachCallback cb) {
+  removeChannel(channel);
+  cb(std::string());
+}
+
+} // namespace lynx
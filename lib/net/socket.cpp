@@ -61,7 +61,10 @@ int Socket::accept(InetAddress *peeraddr) {
       SOCK_NONBLOCK | SOCK_CLOEXEC);
   if (connfd < 0) {
     int saved_errno = errno;
-    LOG_SYSERR << "Socket::accept";
+    /// The backlog was drained, expected when accepting until EAGAIN
+    if (saved_errno != EAGAIN) {
+      LOG_SYSERR << "Socket::accept";
+    }
     switch (saved_errno) {
     case EAGAIN:
     case ECONNABORTED:
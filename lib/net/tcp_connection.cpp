@@ -4,6 +4,11 @@
 #include "lynx/net/event_loop.h"
 #include "lynx/net/socket.h"
 
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+
 namespace lynx {
 
 void defaultConnectionCallback(const TcpConnectionPtr &conn) {
@@ -21,23 +26,34 @@ TcpConnection::TcpConnection(EventLoop *loop, const std::string &name,
                              int sockfd, const InetAddress &localAddr,
                              const InetAddress &peerAddr)
     : loop_(CHECK_NOTNULL(loop)), name_(name), state_(CONNECTING),
-      reading_(true), socket_(new Socket(sockfd)),
+      reading_(true), migrating_(false), close_after_migration_(false),
+      unread_input_(false), bytes_received_(0), calls_queued_(false),
+      socket_(new Socket(sockfd)),
       channel_(new Channel(loop, sockfd)), local_addr_(localAddr),
-      peer_addr_(peerAddr), high_water_mark_(64 * 1024 * 1024) {
+      peer_addr_(peerAddr), high_water_mark_(64 * 1024 * 1024),
+      read_budget_(K_DEFAULT_READ_BUDGET), pending_file_bytes_(0),
+      idle_timeout_(0.0), idle_entry_([this] { handleIdle(); }) {
   channel_->setReadCallback(
       [this](auto &&PH1) { handleRead(std::forward<decltype(PH1)>(PH1)); });
+  channel_->setReceiveCallback(
+      [this](const char *data, ssize_t n, Timestamp receiveTime) {
+        handleReceived(data, n, receiveTime);
+      });
   channel_->setWriteCallback([this] { handleWrite(); });
   channel_->setCloseCallback([this] { handleClose(); });
   channel_->setErrorCallback([this] { handleError(); });
   LOG_DEBUG << "TcpConnection::ctor[" << name_ << "] at " << this
             << " fd=" << sockfd;
   socket_->setKeepAlive(true);
+  /// Counted from placement on, a burst of accepts sees its own choices
+  getLoop()->addConnectionCount(1);
 }
 
 TcpConnection::~TcpConnection() {
   LOG_DEBUG << "TcpConnection::dtor[" << name_ << "] at " << this
             << " fd=" << channel_->fd() << " state=" << stateToString();
   assert(state_ == DISCONNECTED);
+  getLoop()->addConnectionCount(-1);
 }
 
 bool TcpConnection::getTcpInfo(struct tcp_info *tcpi) const {
@@ -52,37 +68,121 @@ std::string TcpConnection::getTcpInfoString() const {
 }
 
 void TcpConnection::send(const void *data, int len) {
-  send(std::string(static_cast<const char *>(data), len));
+  if (state_ == CONNECTED) {
+    if (inOwnLoop()) {
+      sendInLoop(data, len);
+    } else {
+      send(std::string(static_cast<const char *>(data), len));
+    }
+  }
 }
 
 void TcpConnection::send(const std::string &message) {
   if (state_ == CONNECTED) {
-    if (loop_->isInLoopThread()) {
-      sendInLoop(message);
+    if (inOwnLoop()) {
+      sendInLoop(message.data(), message.size());
     } else {
-      loop_->runInLoop([this, &message] { sendInLoop(message); });
+      send(ByteSlice(message));
+    }
+  }
+}
+
+void TcpConnection::send(std::string &&message) {
+  if (state_ == CONNECTED) {
+    if (inOwnLoop()) {
+      sendInLoop(message.data(), message.size());
+    } else {
+      send(ByteSlice(std::move(message)));
     }
   }
 }
 
 void TcpConnection::send(Buffer *buf) {
   if (state_ == CONNECTED) {
-    if (loop_->isInLoopThread()) {
+    if (inOwnLoop()) {
       sendInLoop(buf->peek(), buf->readableBytes());
       buf->retrieveAll();
     } else {
-      loop_->runInLoop(
-          [this, &buf] { sendInLoop(buf->retrieveAllAsString()); });
+      send(ByteSlice(buf->retrieveAllAsString()));
+    }
+  }
+}
+
+void TcpConnection::send(Buffer &&buf) {
+  if (state_ == CONNECTED) {
+    if (inOwnLoop()) {
+      sendInLoop(buf.peek(), buf.readableBytes());
+      buf.retrieveAll();
+    } else {
+      auto owner = std::make_shared<const Buffer>(std::move(buf));
+      send(ByteSlice(owner->peek(), owner->readableBytes(), owner));
     }
   }
 }
 
-void TcpConnection::sendInLoop(const std::string &message) {
-  sendInLoop(message.data(), message.size());
+void TcpConnection::send(const ByteSlice &slice) {
+  if (state_ == CONNECTED) {
+    if (inOwnLoop()) {
+      sendInLoop(slice.data(), slice.size(), slice.owner());
+    } else {
+      runInOwnLoop([guard = shared_from_this(), slice] {
+        guard->sendInLoop(slice.data(), slice.size(), slice.owner());
+      });
+    }
+  }
 }
 
-void TcpConnection::sendInLoop(const void *data, size_t len) {
-  loop_->assertInLoopThread();
+bool TcpConnection::inOwnLoop() {
+  if (!getLoop()->isInLoopThread()) {
+    return false;
+  }
+  /// What other threads sent before goes first, if it has not gone out yet
+  if (calls_queued_.load(std::memory_order_acquire)) {
+    runQueuedCalls();
+  }
+  return true;
+}
+
+void TcpConnection::runInOwnLoop(Task call) {
+  if (inOwnLoop()) {
+    call();
+    return;
+  }
+  EventLoop *loop = getLoop();
+  bool queue = false;
+  {
+    std::lock_guard<std::mutex> lock(calls_mutex_);
+    queued_calls_.push_back(std::move(call));
+    queue = !calls_queued_.load(std::memory_order_relaxed);
+    calls_queued_.store(true, std::memory_order_release);
+  }
+  if (queue) {
+    loop->queueInLoop(
+        [guard = shared_from_this()] { guard->runQueuedCalls(); });
+  }
+}
+
+void TcpConnection::runQueuedCalls() {
+  if (!getLoop()->isInLoopThread()) {
+    /// Queued before the connection moved to another loop, follow it
+    getLoop()->queueInLoop(
+        [guard = shared_from_this()] { guard->runQueuedCalls(); });
+    return;
+  }
+  std::vector<Task> calls;
+  {
+    std::lock_guard<std::mutex> lock(calls_mutex_);
+    calls.swap(queued_calls_);
+    calls_queued_.store(false, std::memory_order_relaxed);
+  }
+  for (const auto &call : calls) {
+    call();
+  }
+}
+
+void TcpConnection::sendInLoop(const void *data, size_t len,
+                               const std::shared_ptr<const void> &owner) {
+  getLoop()->assertInLoopThread();
   ssize_t nwrote = 0;
   size_t remaining = len;
   bool fault_error = false;
@@ -90,13 +190,16 @@ void TcpConnection::sendInLoop(const void *data, size_t len) {
     LOG_WARN << "disconnected, give up writing";
     return;
   }
-  if (!channel_->isWriting() && output_buffer_.readableBytes() == 0) {
+  if (!channel_->isWriting() && outputEmpty()) {
     nwrote = ::write(channel_->fd(), data, len);
     if (nwrote >= 0) {
+      /// The peer takes bytes, it is not idle
+      idle_entry_.touch();
       remaining = len - nwrote;
       if (remaining == 0 && write_complete_callback_) {
-        loop_->queueInLoop(
-            [this] { write_complete_callback_(shared_from_this()); });
+        getLoop()->queueInLoop([guard = shared_from_this()] {
+          guard->write_complete_callback_(guard);
+        });
       }
     } else {
       nwrote = 0;
@@ -111,30 +214,250 @@ void TcpConnection::sendInLoop(const void *data, size_t len) {
 
   assert(remaining <= len);
   if (!fault_error && remaining > 0) {
-    size_t old_len = output_buffer_.readableBytes();
+    size_t old_len = pendingBytes();
     if (old_len + remaining >= high_water_mark_ && old_len < high_water_mark_ &&
         high_water_mark_callback_) {
-      loop_->queueInLoop([this, &old_len, &remaining] {
-        high_water_mark_callback_(shared_from_this(), old_len + remaining);
-      });
+      getLoop()->queueInLoop(
+          [guard = shared_from_this(), pending = old_len + remaining] {
+            guard->high_water_mark_callback_(guard, pending);
+          });
+    }
+    /// An owned payload is queued as is, the buffer copies only small ones
+    const char *rest = static_cast<const char *>(data) + nwrote;
+    if (owner) {
+      output_buffer_.appendSlice(rest, remaining, owner);
+    } else {
+      output_buffer_.append(rest, remaining);
     }
-    output_buffer_.append(static_cast<const char *>(data) + nwrote, remaining);
-    if (!channel_->isWriting()) {
+    if (!channel_->isWriting() && !waitingForSource() && !migrating_) {
       channel_->enableWriting();
     }
   }
 }
 
+void TcpConnection::flushOutputBuffer() {
+  getLoop()->assertInLoopThread();
+  if (state_ == DISCONNECTED) {
+    LOG_WARN << "disconnected, give up writing";
+    output_buffer_.retrieveAll();
+    clearFiles();
+    return;
+  }
+  /// Already waiting for the socket to drain, or for a pipe to fill,
+  /// handleWrite() sends the rest. A moving connection is flushed once moved.
+  if (channel_->isWriting() || outputEmpty() || waitingForSource() ||
+      migrating_) {
+    return;
+  }
+
+  if (!writeOutput()) {
+    return;
+  }
+  if (outputEmpty()) {
+    if (write_complete_callback_) {
+      getLoop()->queueInLoop([guard = shared_from_this()] {
+        guard->write_complete_callback_(guard);
+      });
+    }
+    return;
+  }
+  size_t remaining = pendingBytes();
+  if (remaining >= high_water_mark_ && high_water_mark_callback_) {
+    getLoop()->queueInLoop([guard = shared_from_this(), remaining] {
+      guard->high_water_mark_callback_(guard, remaining);
+    });
+  }
+  if (!waitingForSource()) {
+    channel_->enableWriting();
+  }
+}
+
+void TcpConnection::sendFile(int fd, off_t offset, size_t len,
+                             std::shared_ptr<const void> owner) {
+  if (inOwnLoop()) {
+    sendFileInLoop(fd, offset, len, std::move(owner));
+  } else {
+    runInOwnLoop([guard = shared_from_this(), fd, offset, len,
+                  owner = std::move(owner)] {
+      guard->sendFileInLoop(fd, offset, len, owner);
+    });
+  }
+}
+
+void TcpConnection::sendFileInLoop(int fd, off_t offset, size_t len,
+                                   std::shared_ptr<const void> owner) {
+  getLoop()->assertInLoopThread();
+  if (state_ == DISCONNECTED) {
+    LOG_WARN << "disconnected, give up writing";
+    return;
+  }
+  struct stat st;
+  if (::fstat(fd, &st) < 0) {
+    LOG_SYSERR << "TcpConnection::sendFileInLoop fstat";
+    return;
+  }
+  bool pipe = S_ISFIFO(st.st_mode);
+  if (!pipe && len == K_TO_EOF) {
+    len = st.st_size > offset ? static_cast<size_t>(st.st_size - offset) : 0;
+  }
+  if (len == 0) {
+    return;
+  }
+  /// The buffered bytes not yet claimed by an earlier region go first
+  size_t claimed = 0;
+  for (const auto &pending : pending_files_) {
+    claimed += pending.before_;
+  }
+  size_t before = output_buffer_.readableBytes() - claimed;
+  pending_files_.push_back(
+      PendingFile{fd, offset, len, before, pipe, std::move(owner), nullptr});
+  if (len != K_TO_EOF) {
+    pending_file_bytes_ += len;
+  }
+  flushOutputBuffer();
+}
+
+bool TcpConnection::waitingForSource() const {
+  return !pending_files_.empty() && pending_files_.front().source_ &&
+         pending_files_.front().source_->isReading();
+}
+
+void TcpConnection::waitForSource(PendingFile *file) {
+  if (!file->source_) {
+    file->source_ = std::make_unique<Channel>(getLoop(), file->fd_);
+    file->source_->tie(shared_from_this());
+    /// The pipe has data, or its writer is gone: let the socket take it
+    Channel *source = file->source_.get();
+    auto ready = [this, source] {
+      if (source->isReading()) {
+        source->disableAll();
+      }
+      if (state_ != DISCONNECTED && !channel_->isWriting()) {
+        channel_->enableWriting();
+      }
+    };
+    file->source_->setReadCallback([ready](Timestamp) { ready(); });
+    file->source_->setCloseCallback(ready);
+    file->source_->setErrorCallback(ready);
+  }
+  file->source_->enableReading();
+  if (channel_->isWriting()) {
+    channel_->disableWriting();
+  }
+}
+
+ssize_t TcpConnection::writeFile(PendingFile *file) {
+  if (!file->pipe_) {
+    return ::sendfile(channel_->fd(), file->fd_, &file->offset_,
+                      file->remaining_);
+  }
+  /// The kernel moves at most a pipe's worth per call anyway
+  static const size_t k_splice_max = 1024 * 1024;
+  ssize_t n = ::splice(file->fd_, nullptr, channel_->fd(), nullptr,
+                       std::min(file->remaining_, k_splice_max),
+                       SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+  if (n < 0 && errno == EAGAIN) {
+    int available = 0;
+    if (::ioctl(file->fd_, FIONREAD, &available) == 0 && available == 0) {
+      /// The pipe is empty, not the socket full
+      waitForSource(file);
+      errno = EAGAIN;
+    }
+  }
+  return n;
+}
+
+void TcpConnection::popFile() {
+  PendingFile &file = pending_files_.front();
+  if (file.remaining_ != K_TO_EOF) {
+    pending_file_bytes_ -= file.remaining_;
+  }
+  if (file.source_) {
+    if (!file.source_->isNoneEvent()) {
+      file.source_->disableAll();
+    }
+    /// It may still be in the active list of this poll, remove it after
+    std::shared_ptr<Channel> source(std::move(file.source_));
+    getLoop()->queueInLoop(
+        [source, owner = file.owner_] { source->remove(); });
+  }
+  pending_files_.pop_front();
+}
+
+void TcpConnection::clearFiles() {
+  while (!pending_files_.empty()) {
+    popFile();
+  }
+}
+
+bool TcpConnection::writeOutput() {
+  while (!outputEmpty()) {
+    if (pending_files_.empty() || pending_files_.front().before_ > 0) {
+      size_t len = pending_files_.empty() ? output_buffer_.readableBytes()
+                                          : pending_files_.front().before_;
+      int saved_errno = 0;
+      ssize_t n = output_buffer_.writeFd(channel_->fd(), len, &saved_errno);
+      if (n < 0) {
+        errno = saved_errno;
+        break;
+      }
+      idle_entry_.touch();
+      if (!pending_files_.empty()) {
+        pending_files_.front().before_ -= n;
+      }
+      if (static_cast<size_t>(n) < len) {
+        return true;
+      }
+      continue;
+    }
+
+    PendingFile &file = pending_files_.front();
+    ssize_t n = writeFile(&file);
+    if (n < 0) {
+      break;
+    }
+    if (n > 0) {
+      idle_entry_.touch();
+    }
+    if (n == 0) {
+      if (file.remaining_ == K_TO_EOF) {
+        popFile();
+        continue;
+      }
+      /// The file is shorter than announced, the peer cannot be told anymore
+      LOG_ERROR << "TcpConnection::writeOutput file ended " << file.remaining_
+                << " bytes early";
+      popFile();
+      forceClose();
+      return false;
+    }
+    if (file.remaining_ != K_TO_EOF) {
+      file.remaining_ -= n;
+      pending_file_bytes_ -= n;
+      if (file.remaining_ == 0) {
+        popFile();
+      }
+    }
+  }
+
+  if (!outputEmpty() && errno != EWOULDBLOCK) {
+    LOG_SYSERR << "TcpConnection::writeOutput";
+    return false;
+  }
+  return true;
+}
+
 void TcpConnection::shutdown() {
   if (state_ == CONNECTED) {
     setState(DISCONNECTING);
-    loop_->runInLoop([this] { shutdownInLoop(); });
+    /// After the bytes sent before
+    runInOwnLoop([guard = shared_from_this()] { guard->shutdownInLoop(); });
   }
 }
 
 void TcpConnection::shutdownInLoop() {
-  loop_->assertInLoopThread();
-  if (!channel_->isWriting()) {
+  getLoop()->assertInLoopThread();
+  if (!channel_->isWriting() && outputEmpty()) {
     socket_->shutdownWrite();
   }
 }
@@ -142,14 +465,20 @@ void TcpConnection::shutdownInLoop() {
 void TcpConnection::forceClose() {
   if (state_ == CONNECTED || state_ == DISCONNECTING) {
     setState(DISCONNECTING);
-    loop_->queueInLoop(
+    getLoop()->queueInLoop(
         [capture0 = shared_from_this()] { capture0->forceCloseInLoop(); });
   }
 }
 
 void TcpConnection::forceCloseInLoop() {
-  loop_->assertInLoopThread();
-  if (state_ == CONNECTED || state_ == DISCONNECTING) {
+  if (!getLoop()->isInLoopThread()) {
+    getLoop()->runInLoop(
+        [capture0 = shared_from_this()] { capture0->forceCloseInLoop(); });
+    return;
+  }
+  if (migrating_) {
+    close_after_migration_ = true;
+  } else if (state_ == CONNECTED || state_ == DISCONNECTING) {
     handleClose();
   }
 }
@@ -171,24 +500,58 @@ const char *TcpConnection::stateToString() const {
 
 void TcpConnection::setTcpNoDelay(bool on) { socket_->setTcpNoDelay(on); }
 
+void TcpConnection::setEdgeTriggered(bool on, size_t readBudget) {
+  assert(state_ == CONNECTING);
+  channel_->setEdgeTriggered(on);
+  read_budget_ = readBudget;
+}
+
 void TcpConnection::startRead() {
-  loop_->runInLoop([this] { startReadInLoop(); });
+  getLoop()->runInLoop(
+      [guard = shared_from_this()] { guard->startReadInLoop(); });
 }
 
 void TcpConnection::startReadInLoop() {
-  loop_->assertInLoopThread();
+  if (!getLoop()->isInLoopThread()) {
+    getLoop()->runInLoop(
+        [guard = shared_from_this()] { guard->startReadInLoop(); });
+    return;
+  }
+  if (migrating_) {
+    reading_ = true;
+    return;
+  }
   if (!reading_ || !channel_->isReading()) {
     channel_->enableReading();
     reading_ = true;
   }
+  if (unread_input_) {
+    /// Not from within the caller, which may be a callback of this connection
+    unread_input_ = false;
+    getLoop()->queueInLoop([guard = shared_from_this()] {
+      if (guard->connected() && guard->reading_) {
+        guard->message_callback_(guard, &guard->input_buffer_,
+                                 guard->getLoop()->pollReturnTime());
+      }
+    });
+  }
 }
 
 void TcpConnection::stopRead() {
-  loop_->runInLoop([this] { stopReadInLoop(); });
+  getLoop()->runInLoop(
+      [guard = shared_from_this()] { guard->stopReadInLoop(); });
 }
 
 void TcpConnection::stopReadInLoop() {
-  loop_->assertInLoopThread();
+  if (!getLoop()->isInLoopThread()) {
+    getLoop()->runInLoop(
+        [guard = shared_from_this()] { guard->stopReadInLoop(); });
+    return;
+  }
+  if (migrating_) {
+    reading_ = false;
+    return;
+  }
   if (reading_ || channel_->isReading()) {
     channel_->disableReading();
     reading_ = false;
@@ -196,31 +559,128 @@ void TcpConnection::stopReadInLoop() {
 }
 
 void TcpConnection::connectEstablished() {
-  loop_->assertInLoopThread();
+  getLoop()->assertInLoopThread();
   assert(state_ == CONNECTING);
   setState(CONNECTED);
   channel_->tie(shared_from_this());
   channel_->enableReading();
+  if (idle_timeout_ > 0.0) {
+    getLoop()->timingWheel()->add(&idle_entry_, idle_timeout_);
+  }
 
   connection_callback_(shared_from_this());
 }
 
 void TcpConnection::connectDestroyed() {
-  loop_->assertInLoopThread();
-  if (state_ == CONNECTED) {
+  if (!getLoop()->isInLoopThread()) {
+    getLoop()->runInLoop(
+        [capture0 = shared_from_this()] { capture0->connectDestroyed(); });
+    return;
+  }
+  /// A server destroyed mid-shutdown still has the channel enabled
+  if (state_ == CONNECTED || state_ == DISCONNECTING) {
     setState(DISCONNECTED);
-    channel_->disableAll();
+    if (!migrating_) {
+      channel_->disableAll();
+    }
 
     connection_callback_(shared_from_this());
   }
-  channel_->remove();
+  clearFiles();
+  idle_entry_.unlink();
+  /// A moving channel is in no loop, the move sees the connection is gone
+  if (!migrating_) {
+    channel_->remove();
+  }
+}
+
+void TcpConnection::migrateTo(EventLoop *loop) {
+  /// Queued, not run: the channel may be handling an event right now
+  getLoop()->queueInLoop(
+      [guard = shared_from_this(), loop] { guard->migrateInLoop(loop); });
+}
+
+void TcpConnection::migrateInLoop(EventLoop *loop) {
+  if (!getLoop()->isInLoopThread()) {
+    getLoop()->queueInLoop(
+        [guard = shared_from_this(), loop] { guard->migrateInLoop(loop); });
+    return;
+  }
+  if (loop == getLoop() || migrating_ || state_ != CONNECTED) {
+    return;
+  }
+  for (const PendingFile &file : pending_files_) {
+    if (file.source_) {
+      /// Its channel watches the pipe in this loop
+      LOG_DEBUG << "TcpConnection::migrateInLoop [" << name_
+                << "] waits for a pipe, not moved";
+      return;
+    }
+  }
+  LOG_DEBUG << "TcpConnection::migrateInLoop [" << name_ << "] from "
+            << getLoop() << " to " << loop;
+  migrating_ = true;
+  /// Put on the wheel of the new loop once there
+  idle_entry_.unlink();
+  channel_->disableAll();
+  channel_->detach([this, guard = shared_from_this(),
+                    loop](std::string received) {
+    /// Still in the old loop, which owns the buffers until the store below;
+    /// other threads only read loop_, to find where to queue their calls
+    if (!received.empty()) {
+      input_buffer_.append(received.data(), received.size());
+      countReceived(received.size());
+    }
+    getLoop()->addConnectionCount(-1);
+    loop->addConnectionCount(1);
+    channel_->setOwnerLoop(loop);
+    loop_.store(loop, std::memory_order_release);
+    loop->queueInLoop([guard, fresh = !received.empty()] {
+      guard->adoptInLoop(fresh);
+    });
+  });
+}
+
+void TcpConnection::adoptInLoop(bool received) {
+  getLoop()->assertInLoopThread();
+  migrating_ = false;
+  if (state_ == DISCONNECTED) {
+    /// Destroyed on the way
+    return;
+  }
+  if (close_after_migration_) {
+    handleClose();
+    return;
+  }
+  if (reading_) {
+    channel_->enableReading();
+  }
+  if (!outputEmpty()) {
+    channel_->enableWriting();
+  }
+  if (idle_timeout_ > 0.0) {
+    getLoop()->timingWheel()->add(&idle_entry_, idle_timeout_);
+  }
+  if (received) {
+    if (reading_) {
+      message_callback_(shared_from_this(), &input_buffer_,
+                        getLoop()->pollReturnTime());
+    } else {
+      unread_input_ = true;
+    }
+  }
 }
 
 void TcpConnection::handleRead(Timestamp receiveTime) {
-  loop_->assertInLoopThread();
+  getLoop()->assertInLoopThread();
+  if (channel_->edgeTriggered()) {
+    handleReadEdge(receiveTime);
+    return;
+  }
   int saved_errno = 0;
   ssize_t n = input_buffer_.readFd(channel_->fd(), &saved_errno);
   if (n > 0) {
+    countReceived(static_cast<size_t>(n));
     message_callback_(shared_from_this(), &input_buffer_, receiveTime);
   } else if (n == 0) {
     handleClose();
@@ -231,25 +691,83 @@ void TcpConnection::handleRead(Timestamp receiveTime) {
   }
 }
 
+void TcpConnection::handleReadEdge(Timestamp receiveTime) {
+  /// No new edge comes until the socket was found empty
+  size_t total = 0;
+  int saved_errno = 0;
+  ssize_t n = 0;
+  while (total < read_budget_) {
+    n = input_buffer_.readFd(channel_->fd(), &saved_errno);
+    if (n <= 0) {
+      break;
+    }
+    total += n;
+  }
+  if (total > 0) {
+    countReceived(total);
+    message_callback_(shared_from_this(), &input_buffer_, receiveTime);
+  }
+  if (n == 0) {
+    if (state_ == CONNECTED || state_ == DISCONNECTING) {
+      handleClose();
+    }
+  } else if (n < 0) {
+    if (saved_errno != EAGAIN) {
+      errno = saved_errno;
+      LOG_SYSERR << "TcpConnection::handleReadEdge";
+      handleError();
+      /// No edge reports the error again, so the stream is over
+      if (state_ == CONNECTED || state_ == DISCONNECTING) {
+        handleClose();
+      }
+    }
+  } else if (channel_->isReading()) {
+    /// Budget spent with bytes left, be reported again after the other
+    /// ready channels
+    channel_->rearm();
+  }
+}
+
+void TcpConnection::handleReceived(const char *data, ssize_t n,
+                                   Timestamp receiveTime) {
+  getLoop()->assertInLoopThread();
+  if (state_ == DISCONNECTED) {
+    /// The rest of a batch received before the connection was closed
+    return;
+  }
+  if (n > 0) {
+    input_buffer_.append(data, static_cast<size_t>(n));
+    countReceived(static_cast<size_t>(n));
+    message_callback_(shared_from_this(), &input_buffer_, receiveTime);
+  } else if (n == 0) {
+    handleClose();
+  } else {
+    errno = static_cast<int>(-n);
+    LOG_SYSERR << "TcpConnection::handleReceived";
+    handleError();
+    /// The poller receives no more, the stream is over
+    if (state_ == CONNECTED || state_ == DISCONNECTING) {
+      handleClose();
+    }
+  }
+}
+
 void TcpConnection::handleWrite() {
-  loop_->assertInLoopThread();
+  getLoop()->assertInLoopThread();
   if (channel_->isWriting()) {
-    ssize_t n = ::write(channel_->fd(), output_buffer_.peek(),
-                        output_buffer_.readableBytes());
-    if (n > 0) {
-      output_buffer_.retrieve(n);
-      if (output_buffer_.readableBytes() == 0) {
-        channel_->disableWriting();
-        if (write_complete_callback_) {
-          loop_->queueInLoop(
-              [this] { write_complete_callback_(shared_from_this()); });
-        }
-        if (state_ == DISCONNECTING) {
-          shutdownInLoop();
-        }
+    if (!writeOutput()) {
+      return;
+    }
+    if (outputEmpty()) {
+      channel_->disableWriting();
+      if (write_complete_callback_) {
+        getLoop()->queueInLoop([guard = shared_from_this()] {
+          guard->write_complete_callback_(guard);
+        });
+      }
+      if (state_ == DISCONNECTING) {
+        shutdownInLoop();
       }
-    } else {
-      LOG_SYSERR << "TcpConnection::handleWrite";
     }
   } else {
     LOG_TRACE << "Connection fd = " << channel_->fd()
@@ -258,17 +776,25 @@ void TcpConnection::handleWrite() {
 }
 
 void TcpConnection::handleClose() {
-  loop_->assertInLoopThread();
+  getLoop()->assertInLoopThread();
   LOG_TRACE << "fd = " << channel_->fd() << " state = " << stateToString();
   assert(state_ == CONNECTED || state_ == DISCONNECTING);
   setState(DISCONNECTED);
   channel_->disableAll();
+  clearFiles();
+  idle_entry_.unlink();
 
   TcpConnectionPtr guard_this(shared_from_this());
   connection_callback_(guard_this);
   close_callback_(guard_this);
 }
 
+void TcpConnection::handleIdle() {
+  LOG_INFO << "TcpConnection::handleIdle [" << name_ << "] - idle for "
+           << idle_timeout_ << "s, closing";
+  forceCloseInLoop();
+}
+
 void TcpConnection::handleError() {
   int optval;
   auto optlen = static_cast<socklen_t>(sizeof(optval));
@@ -4,6 +4,9 @@
 #include "lynx/net/event_loop.h"
 #include "lynx/net/event_loop_thread_pool.h"
 
+#include <algorithm>
+#include <latch>
+
 namespace lynx {
 
 namespace detail {
@@ -25,26 +28,63 @@ struct sockaddr_in getLocalAddr(int sockfd) {
 
 TcpServer::TcpServer(EventLoop *loop, const InetAddress &listenAddr,
                      const std::string &name, Option option)
-    : loop_(CHECK_NOTNULL(loop)), ip_port_(listenAddr.toIpPort()), name_(name),
-      acceptor_(new Acceptor(loop, listenAddr, option == REUSE_PORT)),
+    : loop_(CHECK_NOTNULL(loop)), listen_addr_(listenAddr),
+      ip_port_(listenAddr.toIpPort()), name_(name),
+      sharded_(option == SHARDED_REUSE_PORT),
       thread_pool_(new EventLoopThreadPool(loop, name_)),
       connection_callback_(defaultConnectionCallback),
-      message_callback_(defaultMessageCallback), next_conn_id_(1) {
-  acceptor_->setNewConnectionCallback([this](auto &&PH1, auto &&PH2) {
-    newConnection(std::forward<decltype(PH1)>(PH1),
-                  std::forward<decltype(PH2)>(PH2));
-  });
+      message_callback_(defaultMessageCallback), edge_triggered_(false),
+      read_budget_(TcpConnection::K_DEFAULT_READ_BUDGET), idle_timeout_(0.0),
+      next_conn_id_(1), rebalance_interval_(0.0), rebalance_imbalance_(0.0) {
+  if (!sharded_) {
+    acceptor_ = std::make_unique<Acceptor>(loop, listenAddr,
+                                           option == REUSE_PORT);
+    acceptor_->setNewConnectionCallback([this](auto &&PH1, auto &&PH2) {
+      newConnection(std::forward<decltype(PH1)>(PH1),
+                    std::forward<decltype(PH2)>(PH2));
+    });
+  }
 }
 
 TcpServer::~TcpServer() {
   loop_->assertInLoopThread();
   LOG_TRACE << "TcpServer::~TcpServer [" << name_ << "] destructing";
+  if (rebalance_interval_ > 0.0) {
+    loop_->cancel(rebalance_timer_);
+  }
 
   for (auto &item : connections_) {
     TcpConnectionPtr conn(item.second);
     item.second.reset();
     conn->getLoop()->runInLoop([conn] { conn->connectDestroyed(); });
   }
+  /// A shard may be accepting right now, wait until each loop has torn its
+  /// shard down
+  std::latch torn_down(static_cast<std::ptrdiff_t>(shards_.size()));
+  for (const auto &shard : shards_) {
+    shard->loop_->runInLoop([raw = shard.get(), &torn_down] {
+      raw->acceptor_.reset();
+      for (auto &item : raw->connections_) {
+        item.second->connectDestroyed();
+      }
+      raw->connections_.clear();
+      torn_down.count_down();
+    });
+  }
+  torn_down.wait();
+}
+
+void TcpServer::setPlacementPolicy(
+    EventLoopThreadPool::PlacementPolicy policy) {
+  thread_pool_->setPlacementPolicy(std::move(policy));
+}
+
+void TcpServer::setRebalancing(double interval, double imbalance) {
+  assert(started_ == 0);
+  assert(!sharded_);
+  assert(interval > 0.0);
+  rebalance_interval_ = interval;
+  rebalance_imbalance_ = imbalance;
 }
 
 void TcpServer::setThreadNum(int numThreads) {
@@ -52,38 +92,159 @@ void TcpServer::setThreadNum(int numThreads) {
   thread_pool_->setThreadNum(numThreads);
 }
 
+void TcpServer::setCpuAffinity(const CpuAffinity &affinity) {
+  assert(started_ == 0);
+  thread_pool_->setCpuAffinity(affinity);
+}
+
+void TcpServer::setEdgeTriggered(bool on, size_t readBudget) {
+  assert(started_ == 0);
+  edge_triggered_ = on;
+  read_budget_ = readBudget;
+  if (acceptor_) {
+    acceptor_->setEdgeTriggered(on);
+  }
+}
+
 void TcpServer::start() {
   if (started_.exchange(1, std::memory_order_seq_cst) == 0) {
     thread_pool_->start(thread_init_callback_);
 
+    if (sharded_) {
+      startShards();
+      return;
+    }
     assert(!acceptor_->listening());
     loop_->runInLoop([capture0 = acceptor_.get()] { capture0->listen(); });
+    if (rebalance_interval_ > 0.0) {
+      rebalance_timer_ =
+          loop_->runEvery(rebalance_interval_, [this] { rebalance(); });
+    }
   }
 }
 
-void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr) {
+void TcpServer::rebalance() {
   loop_->assertInLoopThread();
-  EventLoop *io_loop = thread_pool_->getNextLoop();
+  std::map<std::string, uint64_t> marks;
+  std::map<EventLoop *, std::vector<std::pair<uint64_t, TcpConnection *>>>
+      active;
+  for (const auto &[name, conn] : connections_) {
+    uint64_t received = conn->bytesReceived();
+    marks[name] = received;
+    auto it = received_marks_.find(name);
+    uint64_t delta = received - (it == received_marks_.end() ? 0 : it->second);
+    if (delta > 0) {
+      active[conn->getLoop()].emplace_back(delta, conn.get());
+    }
+  }
+  received_marks_.swap(marks);
+
+  std::vector<EventLoop *> loops = thread_pool_->getAllLoops();
+  if (loops.size() < 2) {
+    return;
+  }
+  EventLoop *busiest = loops[0];
+  EventLoop *idlest = loops[0];
+  for (EventLoop *loop : loops) {
+    if (loop->busyRatio() > busiest->busyRatio()) {
+      busiest = loop;
+    }
+    if (loop->busyRatio() < idlest->busyRatio()) {
+      idlest = loop;
+    }
+  }
+  if (busiest->busyRatio() - idlest->busyRatio() <= rebalance_imbalance_) {
+    return;
+  }
+  auto &candidates = active[busiest];
+  if (candidates.size() < 2) {
+    return;
+  }
+  TcpConnection *hottest =
+      std::max_element(candidates.begin(), candidates.end())->second;
+  LOG_INFO << "TcpServer::rebalance [" << name_ << "] - connection "
+           << hottest->name() << " to the loop " << idlest << ", busy "
+           << busiest->busyRatio() << " vs " << idlest->busyRatio();
+  hottest->migrateTo(idlest);
+}
+
+void TcpServer::startShards() {
+  std::vector<EventLoop *> loops = thread_pool_->getAllLoops();
+  const auto num_shards = static_cast<int>(loops.size());
+  for (int i = 0; i < num_shards; ++i) {
+    auto shard = std::make_unique<Shard>();
+    shard->loop_ = loops[i];
+    shard->acceptor_ =
+        std::make_unique<Acceptor>(loops[i], listen_addr_, true);
+    shard->acceptor_->setEdgeTriggered(edge_triggered_);
+    /// Ids stride over the shards, so names stay unique without sharing
+    /// a counter
+    shard->next_conn_id_ = i + 1;
+    shard->id_stride_ = num_shards;
+    Shard *raw = shard.get();
+    shard->acceptor_->setNewConnectionCallback(
+        [this, raw](int sockfd, const InetAddress &peerAddr) {
+          newShardConnection(raw, sockfd, peerAddr);
+        });
+    shards_.push_back(std::move(shard));
+    loops[i]->runInLoop([raw] { raw->acceptor_->listen(); });
+  }
+}
+
+TcpConnectionPtr TcpServer::makeConnection(EventLoop *ioLoop, int id,
+                                           int sockfd,
+                                           const InetAddress &peerAddr) {
   char buf[64];
-  snprintf(buf, sizeof(buf), "-%s#%d", ip_port_.c_str(), next_conn_id_);
-  ++next_conn_id_;
+  snprintf(buf, sizeof(buf), "-%s#%d", ip_port_.c_str(), id);
   std::string conn_name = name_ + buf;
 
   LOG_INFO << "TcpServer::newConnection [" << name_ << "] - new connection ["
            << conn_name << "] from " << peerAddr.toIpPort();
   InetAddress local_addr(detail::getLocalAddr(sockfd));
   TcpConnectionPtr conn(
-      new TcpConnection(io_loop, conn_name, sockfd, local_addr, peerAddr));
-  connections_[conn_name] = conn;
+      new TcpConnection(ioLoop, conn_name, sockfd, local_addr, peerAddr));
+  if (edge_triggered_) {
+    conn->setEdgeTriggered(true, read_budget_);
+  }
+  conn->setIdleTimeout(idle_timeout_);
   conn->setConnectionCallback(connection_callback_);
   conn->setMessageCallback(message_callback_);
   conn->setWriteCompleteCallback(write_complete_callback_);
+  return conn;
+}
+
+void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr) {
+  loop_->assertInLoopThread();
+  EventLoop *io_loop = thread_pool_->getLoopForPeer(peerAddr);
+  TcpConnectionPtr conn =
+      makeConnection(io_loop, next_conn_id_, sockfd, peerAddr);
+  ++next_conn_id_;
+  connections_[conn->name()] = conn;
   conn->setCloseCallback([this](auto &&PH1) {
     removeConnection(std::forward<decltype(PH1)>(PH1));
   });
   io_loop->runInLoop([conn] { conn->connectEstablished(); });
 }
 
+void TcpServer::newShardConnection(Shard *shard, int sockfd,
+                                   const InetAddress &peerAddr) {
+  shard->loop_->assertInLoopThread();
+  TcpConnectionPtr conn =
+      makeConnection(shard->loop_, shard->next_conn_id_, sockfd, peerAddr);
+  shard->next_conn_id_ += shard->id_stride_;
+  shard->connections_[conn->name()] = conn;
+  conn->setCloseCallback([this, shard](const TcpConnectionPtr &closed) {
+    /// Called in the shard's loop, which owns the registry
+    LOG_INFO << "TcpServer::removeConnectionInLoop [" << name_
+             << "] - connection " << closed->name();
+    size_t n = shard->connections_.erase(closed->name());
+    (void)n;
+    assert(n == 1);
+    shard->loop_->queueInLoop([closed] { closed->connectDestroyed(); });
+  });
+  conn->connectEstablished();
+}
+
 void TcpServer::removeConnection(const TcpConnectionPtr &conn) {
   loop_->runInLoop([this, conn] { removeConnectionInLoop(conn); });
 }
@@ -0,0 +1,660 @@
+#include "lynx/net/uring_poller.h"
+#include "lynx/logger/logging.h"
+#include "lynx/net/channel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <linux/time_types.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+namespace lynx {
+
+namespace {
+
+const int K_NEW = -1;
+const int K_ADDED = 1;
+
+const uint32_t K_SERIAL_BITS = 30;
+const uint32_t K_SERIAL_MASK = (1U << K_SERIAL_BITS) - 1;
+
+int ioUringSetup(unsigned entries, struct io_uring_params *params) {
+  return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int ioUringEnter(int fd, unsigned toSubmit, unsigned minComplete,
+                 unsigned flags, const void *arg, size_t argSize) {
+  return static_cast<int>(::syscall(__NR_io_uring_enter, fd, toSubmit,
+                                    minComplete, flags, arg, argSize));
+}
+
+int ioUringRegister(int fd, unsigned opcode, void *arg, unsigned nrArgs) {
+  return static_cast<int>(
+      ::syscall(__NR_io_uring_register, fd, opcode, arg, nrArgs));
+}
+
+template <typename T> T loadAcquire(T *p) {
+  return std::atomic_ref<T>(*p).load(std::memory_order_acquire);
+}
+
+template <typename T> void storeRelease(T *p, T value) {
+  std::atomic_ref<T>(*p).store(value, std::memory_order_release);
+}
+
+const unsigned K_REQUIRED_FEATURES =
+    IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG;
+
+/// Multishot recv came with Linux 6.0
+bool kernelHasMultishotRecv() {
+  struct utsname name;
+  int major = 0;
+  int minor = 0;
+  if (::uname(&name) != 0 ||
+      ::sscanf(name.release, "%d.%d", &major, &minor) != 2) {
+    return false;
+  }
+  return major >= 6;
+}
+
+bool probeRing() {
+  struct io_uring_params params;
+  ::memset(&params, 0, sizeof(params));
+  int fd = ioUringSetup(4, &params);
+  if (fd < 0) {
+    return false;
+  }
+  bool ok = (params.features & K_REQUIRED_FEATURES) == K_REQUIRED_FEATURES;
+  if (ok) {
+    const size_t k_ops = 64;
+    char storage[sizeof(struct io_uring_probe) +
+                 k_ops * sizeof(struct io_uring_probe_op)] = {};
+    auto *probe = reinterpret_cast<struct io_uring_probe *>(storage);
+    ok = ioUringRegister(fd, IORING_REGISTER_PROBE, probe, k_ops) == 0;
+    for (int op : {IORING_OP_POLL_ADD, IORING_OP_ASYNC_CANCEL}) {
+      ok = ok && op <= probe->last_op &&
+           (probe->ops[op].flags & IO_URING_OP_SUPPORTED) != 0;
+    }
+  }
+  ::close(fd);
+  return ok;
+}
+
+} // namespace
+
+UringPoller::UringPoller(EventLoop *loop)
+    : Poller(loop), ring_fd_(-1), ring_(nullptr), ring_size_(0),
+      sq_head_(nullptr), sq_tail_(nullptr), sq_mask_(0), sq_array_(nullptr),
+      sqes_(nullptr), sqes_size_(0), sq_flags_(nullptr), sq_local_tail_(0),
+      cq_head_(nullptr), cq_tail_(nullptr), cq_mask_(0), cqes_(nullptr),
+      buf_ring_(nullptr), buf_ring_size_(0), buffers_(nullptr), buf_tail_(0),
+      serial_(0) {
+  if (!setupRing(K_RING_ENTRIES)) {
+    LOG_SYSFATAL << "UringPoller::UringPoller";
+  }
+  if (!setupBufferRing()) {
+    LOG_INFO << "UringPoller: no provided buffer ring, sockets are read by "
+                "their channels";
+  }
+}
+
+UringPoller::~UringPoller() {
+  /// Closing the ring cancels whatever is still in flight
+  ::close(ring_fd_);
+  if (buffers_ != nullptr) {
+    ::munmap(buffers_, static_cast<size_t>(K_BUFFER_COUNT) * K_BUFFER_SIZE);
+  }
+  if (buf_ring_ != nullptr) {
+    ::munmap(buf_ring_, buf_ring_size_);
+  }
+  ::munmap(sqes_, sqes_size_);
+  ::munmap(ring_, ring_size_);
+}
+
+bool UringPoller::available() {
+  static const bool k_available = probeRing();
+  return k_available;
+}
+
+bool UringPoller::setupRing(unsigned entries) {
+  ::memset(&params_, 0, sizeof(params_));
+  /// Multishot requests post many completions per submission
+  params_.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SINGLE_ISSUER |
+                  IORING_SETUP_COOP_TASKRUN;
+  params_.cq_entries = entries * 8;
+  ring_fd_ = ioUringSetup(entries, &params_);
+  if (ring_fd_ < 0 && errno == EINVAL) {
+    /// Kernels before 6.0 know neither of the hints
+    params_.flags = IORING_SETUP_CQSIZE;
+    params_.cq_entries = entries * 8;
+    ring_fd_ = ioUringSetup(entries, &params_);
+  }
+  if (ring_fd_ < 0) {
+    return false;
+  }
+  if ((params_.features & K_REQUIRED_FEATURES) != K_REQUIRED_FEATURES) {
+    errno = ENOSYS;
+    return false;
+  }
+
+  size_t sq_size = params_.sq_off.array + params_.sq_entries * sizeof(unsigned);
+  size_t cq_size =
+      params_.cq_off.cqes + params_.cq_entries * sizeof(struct io_uring_cqe);
+  ring_size_ = std::max(sq_size, cq_size);
+  ring_ = ::mmap(nullptr, ring_size_, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  if (ring_ == MAP_FAILED) {
+    ring_ = nullptr;
+    return false;
+  }
+  sqes_size_ = params_.sq_entries * sizeof(struct io_uring_sqe);
+  void *sqes = ::mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    return false;
+  }
+  sqes_ = static_cast<struct io_uring_sqe *>(sqes);
+
+  char *base = static_cast<char *>(ring_);
+  sq_head_ = reinterpret_cast<unsigned *>(base + params_.sq_off.head);
+  sq_tail_ = reinterpret_cast<unsigned *>(base + params_.sq_off.tail);
+  sq_mask_ = *reinterpret_cast<unsigned *>(base + params_.sq_off.ring_mask);
+  sq_flags_ = reinterpret_cast<unsigned *>(base + params_.sq_off.flags);
+  sq_array_ = reinterpret_cast<unsigned *>(base + params_.sq_off.array);
+  cq_head_ = reinterpret_cast<unsigned *>(base + params_.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned *>(base + params_.cq_off.tail);
+  cq_mask_ = *reinterpret_cast<unsigned *>(base + params_.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<struct io_uring_cqe *>(base + params_.cq_off.cqes);
+  /// Slot i of the array always names sqe i
+  for (unsigned i = 0; i < params_.sq_entries; ++i) {
+    sq_array_[i] = i;
+  }
+  sq_local_tail_ = *sq_tail_;
+  return true;
+}
+
+bool UringPoller::setupBufferRing() {
+  if (!kernelHasMultishotRecv()) {
+    return false;
+  }
+  buf_ring_size_ = K_BUFFER_COUNT * sizeof(struct io_uring_buf);
+  void *ring = ::mmap(nullptr, buf_ring_size_, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (ring == MAP_FAILED) {
+    return false;
+  }
+  struct io_uring_buf_reg reg;
+  ::memset(&reg, 0, sizeof(reg));
+  reg.ring_addr = reinterpret_cast<uint64_t>(ring);
+  reg.ring_entries = K_BUFFER_COUNT;
+  reg.bgid = 0;
+  if (ioUringRegister(ring_fd_, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) {
+    ::munmap(ring, buf_ring_size_);
+    return false;
+  }
+  void *buffers = ::mmap(nullptr,
+                         static_cast<size_t>(K_BUFFER_COUNT) * K_BUFFER_SIZE,
+                         PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                         -1, 0);
+  if (buffers == MAP_FAILED) {
+    ioUringRegister(ring_fd_, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+    ::munmap(ring, buf_ring_size_);
+    return false;
+  }
+  buf_ring_ = static_cast<struct io_uring_buf *>(ring);
+  buffers_ = static_cast<char *>(buffers);
+  for (unsigned bid = 0; bid < K_BUFFER_COUNT; ++bid) {
+    addBuffer(static_cast<uint16_t>(bid));
+  }
+  storeRelease(&buf_ring_[0].resv, buf_tail_);
+  return true;
+}
+
+MonoTime UringPoller::poll(int timeoutMs, ChannelList *activeChannels) {
+  LOG_TRACE << "fd total count " << channels_.size();
+  /// The channels have handled what the last batch pointed them to
+  recycleBuffers();
+  delivered_stashes_.clear();
+  armDirty(activeChannels);
+
+  bool ready = !active_entries_.empty() ||
+               loadAcquire(cq_tail_) != *cq_head_;
+  int ret;
+  if (ready) {
+    ret = enter(0, 0, -1);
+  } else if (timeoutMs == 0) {
+    /// Still enters to run completions the kernel has deferred to us
+    ret = enter(0, IORING_ENTER_GETEVENTS, -1);
+  } else {
+    ret = enter(1, IORING_ENTER_GETEVENTS, timeoutMs);
+  }
+  int saved_errno = errno;
+  MonoTime now(MonoTime::now());
+  if (ret < 0 && saved_errno != EINTR && saved_errno != ETIME &&
+      saved_errno != EBUSY) {
+    errno = saved_errno;
+    LOG_SYSERR << "UringPoller::poll()";
+  }
+
+  reap(activeChannels);
+  if (active_entries_.empty()) {
+    LOG_TRACE << "nothing happened";
+  } else {
+    LOG_TRACE << active_entries_.size() << " events happened";
+  }
+  for (Entry *entry : active_entries_) {
+    entry->channel_->setRevents(static_cast<int>(entry->revents_));
+    entry->revents_ = 0;
+    entry->active_ = false;
+  }
+  active_entries_.clear();
+  return now;
+}
+
+void UringPoller::updateChannel(Channel *channel) {
+  assertInLoopThread();
+  const int index = channel->index();
+  const int fd = channel->fd();
+  LOG_TRACE << "fd = " << fd << " events = " << channel->events()
+            << " index = " << index;
+  Entry *entry;
+  if (index == K_NEW) {
+    assert(channels_.find(fd) == channels_.end());
+    channels_[fd] = channel;
+    entry = &entries_[fd];
+    entry->channel_ = channel;
+    /// Completions of requests made for an earlier owner of the fd are
+    /// older than this
+    entry->instance_ = nextSerial();
+    channel->setIndex(K_ADDED);
+  } else {
+    assert(channels_.find(fd) != channels_.end());
+    assert(channels_[fd] == channel);
+    assert(index == K_ADDED);
+    entry = &entries_[fd];
+  }
+  if (channel->edgeTriggered()) {
+    /// A fresh poll reports readiness that is already there
+    entry->rearm_ = true;
+  }
+  markDirty(fd, entry);
+}
+
+void UringPoller::removeChannel(Channel *channel) {
+  assertInLoopThread();
+  int fd = channel->fd();
+  LOG_TRACE << "fd = " << fd;
+  assert(channels_.find(fd) != channels_.end());
+  assert(channels_[fd] == channel);
+  assert(channel->isNoneEvent());
+  assert(channel->index() == K_ADDED);
+  auto it = entries_.find(fd);
+  assert(it != entries_.end());
+  Entry &entry = it->second;
+  assert(!entry.active_);
+  if (entry.poll_armed_) {
+    prepCancel(fd, userData(fd, K_POLL, entry.poll_serial_));
+  }
+  if (entry.recv_armed_) {
+    prepCancel(fd, userData(fd, K_RECV, entry.recv_serial_));
+  }
+  entries_.erase(it);
+  channels_.erase(fd);
+  channel->setIndex(K_NEW);
+}
+
+void UringPoller::detachChannel(Channel *channel, Channel::DetachCallback cb) {
+  assertInLoopThread();
+  int fd = channel->fd();
+  auto it = entries_.find(fd);
+  assert(it != entries_.end());
+  Entry &entry = it->second;
+  if (entry.recv_live_ == 0) {
+    std::string received(std::move(entry.stash_));
+    removeChannel(channel);
+    cb(std::move(received));
+    return;
+  }
+  LOG_TRACE << "fd = " << fd << " detached, " << entry.recv_live_
+            << " recv requests to end";
+  assert(channels_[fd] == channel);
+  assert(channel->isNoneEvent());
+  assert(!entry.active_);
+  if (entry.poll_armed_) {
+    prepCancel(fd, userData(fd, K_POLL, entry.poll_serial_));
+    entry.poll_armed_ = false;
+  }
+  if (entry.recv_armed_) {
+    prepCancel(fd, userData(fd, K_RECV, entry.recv_serial_));
+    entry.recv_armed_ = false;
+  }
+  /// Nothing is armed for it anymore, whatever it was marked for
+  entry.dirty_ = false;
+  entry.detach_callback_ = std::move(cb);
+  channels_.erase(fd);
+  channel->setIndex(K_NEW);
+}
+
+void UringPoller::finishDetach(Entry *entry) {
+  int fd = entry->channel_->fd();
+  Channel::DetachCallback cb(std::move(entry->detach_callback_));
+  std::string received(std::move(entry->stash_));
+  entries_.erase(fd);
+  /// Not in the middle of reaping
+  ownerLoop()->queueInLoop(
+      [cb = std::move(cb), received = std::move(received)]() mutable {
+        cb(std::move(received));
+      });
+}
+
+struct io_uring_sqe *UringPoller::getSqe() {
+  while (sq_local_tail_ - loadAcquire(sq_head_) >= params_.sq_entries) {
+    /// Full, hand what is queued to the kernel first
+    if (enter(0, 0, -1) < 0 && errno != EINTR && errno != EBUSY) {
+      LOG_SYSFATAL << "UringPoller::getSqe";
+    }
+  }
+  struct io_uring_sqe *sqe = &sqes_[sq_local_tail_ & sq_mask_];
+  ::memset(sqe, 0, sizeof(*sqe));
+  ++sq_local_tail_;
+  return sqe;
+}
+
+void UringPoller::prepPoll(int fd, Entry *entry, uint32_t events,
+                           bool multishot) {
+  struct io_uring_sqe *sqe = getSqe();
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = fd;
+  sqe->poll32_events = events;
+  if (multishot) {
+    sqe->poll32_events |= EPOLLET;
+    sqe->len = IORING_POLL_ADD_MULTI;
+  }
+  entry->poll_serial_ = nextSerial();
+  entry->poll_events_ = events;
+  entry->poll_armed_ = true;
+  sqe->user_data = userData(fd, K_POLL, entry->poll_serial_);
+}
+
+void UringPoller::prepRecv(int fd, Entry *entry) {
+  struct io_uring_sqe *sqe = getSqe();
+  sqe->opcode = IORING_OP_RECV;
+  sqe->fd = fd;
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = 0;
+  entry->recv_serial_ = nextSerial();
+  entry->recv_armed_ = true;
+  ++entry->recv_live_;
+  sqe->user_data = userData(fd, K_RECV, entry->recv_serial_);
+}
+
+void UringPoller::prepCancel(int fd, uint64_t userData) {
+  struct io_uring_sqe *sqe = getSqe();
+  sqe->opcode = IORING_OP_ASYNC_CANCEL;
+  sqe->fd = -1;
+  sqe->addr = userData;
+  sqe->user_data = UringPoller::userData(fd, K_CANCEL, 0);
+}
+
+void UringPoller::armDirty(ChannelList *activeChannels) {
+  for (int fd : dirty_fds_) {
+    auto it = entries_.find(fd);
+    if (it == entries_.end() || !it->second.dirty_) {
+      /// Removed since, or met earlier in the list
+      continue;
+    }
+    Entry &entry = it->second;
+    entry.dirty_ = false;
+    Channel *channel = entry.channel_;
+
+    if (receivesFor(entry) && channel->isReading()) {
+      deliverStash(&entry, activeChannels);
+    }
+    bool recv = wantsRecv(entry);
+    if (recv && !entry.recv_armed_) {
+      prepRecv(fd, &entry);
+    } else if (!recv && entry.recv_armed_) {
+      /// What it receives until the cancel lands is stashed
+      prepCancel(fd, userData(fd, K_RECV, entry.recv_serial_));
+      entry.recv_armed_ = false;
+    }
+
+    uint32_t events = wantedPollEvents(entry);
+    if (entry.poll_armed_ && (events != entry.poll_events_ || entry.rearm_)) {
+      prepCancel(fd, userData(fd, K_POLL, entry.poll_serial_));
+      entry.poll_armed_ = false;
+    }
+    if (!entry.poll_armed_ && events != 0) {
+      prepPoll(fd, &entry, events, channel->edgeTriggered());
+    }
+    entry.rearm_ = false;
+  }
+  dirty_fds_.clear();
+}
+
+void UringPoller::markDirty(int fd, Entry *entry) {
+  if (!entry->dirty_) {
+    entry->dirty_ = true;
+    dirty_fds_.push_back(fd);
+  }
+}
+
+bool UringPoller::receivesFor(const Entry &entry) const {
+  return receiving() && entry.channel_->receives();
+}
+
+uint32_t UringPoller::wantedPollEvents(const Entry &entry) const {
+  auto events = static_cast<uint32_t>(entry.channel_->events());
+  if (receivesFor(entry)) {
+    events &= ~static_cast<uint32_t>(POLLIN | POLLPRI);
+  }
+  return events;
+}
+
+bool UringPoller::wantsRecv(const Entry &entry) const {
+  return receivesFor(entry) && entry.channel_->isReading() && entry.end_ == 1;
+}
+
+int UringPoller::enter(unsigned minComplete, unsigned flags, int timeoutMs) {
+  storeRelease(sq_tail_, sq_local_tail_);
+  unsigned to_submit = sq_local_tail_ - loadAcquire(sq_head_);
+  if (to_submit == 0 && (flags & IORING_ENTER_GETEVENTS) == 0) {
+    return 0;
+  }
+  if (timeoutMs < 0 || (flags & IORING_ENTER_GETEVENTS) == 0) {
+    return ioUringEnter(ring_fd_, to_submit, minComplete, flags, nullptr, 0);
+  }
+  struct __kernel_timespec ts;
+  ts.tv_sec = timeoutMs / 1000;
+  ts.tv_nsec = static_cast<long long>(timeoutMs % 1000) * 1000 * 1000;
+  struct io_uring_getevents_arg arg;
+  ::memset(&arg, 0, sizeof(arg));
+  arg.ts = reinterpret_cast<uint64_t>(&ts);
+  return ioUringEnter(ring_fd_, to_submit, minComplete,
+                      flags | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+}
+
+void UringPoller::reap(ChannelList *activeChannels) {
+  for (;;) {
+    unsigned head = *cq_head_;
+    unsigned tail = loadAcquire(cq_tail_);
+    for (; head != tail; ++head) {
+      handleCompletion(cqes_[head & cq_mask_], activeChannels);
+    }
+    storeRelease(cq_head_, head);
+    if ((std::atomic_ref<unsigned>(*sq_flags_).load(
+             std::memory_order_relaxed) &
+         IORING_SQ_CQ_OVERFLOW) == 0) {
+      break;
+    }
+    /// Completions the kernel kept aside while the queue was full
+    enter(0, IORING_ENTER_GETEVENTS, -1);
+  }
+}
+
+void UringPoller::handleCompletion(const struct io_uring_cqe &cqe,
+                                   ChannelList *activeChannels) {
+  auto fd = static_cast<int>(cqe.user_data >> 32);
+  auto kind = static_cast<RequestKind>((cqe.user_data >> K_SERIAL_BITS) & 3);
+  auto serial = static_cast<uint32_t>(cqe.user_data & K_SERIAL_MASK);
+  if (kind == K_CANCEL) {
+    return;
+  }
+  auto it = entries_.find(fd);
+  if (kind == K_RECV) {
+    if (it == entries_.end() ||
+        ((serial - it->second.instance_) & K_SERIAL_MASK) > K_SERIAL_MASK / 2) {
+      /// For a channel that is gone, the buffer still goes back
+      if ((cqe.flags & IORING_CQE_F_BUFFER) != 0) {
+        used_buffers_.push_back(
+            static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT));
+      }
+      return;
+    }
+    handleRecv(&it->second, serial, cqe, activeChannels);
+    return;
+  }
+
+  if (it == entries_.end()) {
+    return;
+  }
+  Entry &entry = it->second;
+  if (!entry.poll_armed_ || serial != entry.poll_serial_) {
+    /// Cancelled or replaced
+    return;
+  }
+  if ((cqe.flags & IORING_CQE_F_MORE) == 0) {
+    /// One-shot, or a multishot poll the kernel ended
+    entry.poll_armed_ = false;
+    markDirty(fd, &entry);
+  }
+  if (cqe.res < 0) {
+    if (cqe.res != -ECANCELED) {
+      errno = -cqe.res;
+      LOG_SYSERR << "UringPoller poll fd = " << fd;
+    }
+    return;
+  }
+  auto revents = static_cast<uint32_t>(cqe.res);
+  if (receivesFor(entry)) {
+    /// The recv requests report the data, the end and the errors of the
+    /// stream
+    revents &= ~static_cast<uint32_t>(POLLIN | POLLPRI | POLLRDHUP | POLLHUP);
+  }
+  if (revents != 0) {
+    entry.revents_ |= revents;
+    activate(&entry, activeChannels);
+  }
+}
+
+void UringPoller::handleRecv(Entry *entry, uint32_t serial,
+                             const struct io_uring_cqe &cqe,
+                             ChannelList *activeChannels) {
+  bool current = entry->recv_armed_ && serial == entry->recv_serial_;
+  bool more = (cqe.flags & IORING_CQE_F_MORE) != 0;
+  if (current && !more) {
+    entry->recv_armed_ = false;
+  }
+  if (!more) {
+    --entry->recv_live_;
+  }
+  int fd = entry->channel_->fd();
+  bool deliver = entry->channel_->isReading() && entry->stash_.empty();
+  if (cqe.res > 0) {
+    assert((cqe.flags & IORING_CQE_F_BUFFER) != 0);
+    auto bid = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+    used_buffers_.push_back(bid);
+    const char *data = buffers_ + static_cast<size_t>(bid) * K_BUFFER_SIZE;
+    if (deliver) {
+      entry->channel_->addReceived(data, cqe.res);
+      activate(entry, activeChannels);
+    } else {
+      entry->stash_.append(data, cqe.res);
+    }
+    if (current && !more) {
+      markDirty(fd, entry);
+    }
+  } else if (cqe.res == -ENOBUFS || cqe.res == -EAGAIN) {
+    /// Out of buffers, they are given back before it is re-armed
+    if (current) {
+      markDirty(fd, entry);
+    }
+  } else if (cqe.res != -ECANCELED && entry->end_ == 1) {
+    entry->end_ = cqe.res;
+    if (deliver) {
+      entry->channel_->addReceived(nullptr, cqe.res);
+      entry->end_delivered_ = true;
+      activate(entry, activeChannels);
+    }
+  }
+  if (entry->detach_callback_ && entry->recv_live_ == 0) {
+    finishDetach(entry);
+  }
+}
+
+void UringPoller::activate(Entry *entry, ChannelList *activeChannels) {
+  if (!entry->active_) {
+    entry->active_ = true;
+    active_entries_.push_back(entry);
+    activeChannels->push_back(entry->channel_);
+  }
+}
+
+void UringPoller::deliverStash(Entry *entry, ChannelList *activeChannels) {
+  bool end = entry->end_ != 1 && !entry->end_delivered_;
+  if (entry->stash_.empty() && !end) {
+    return;
+  }
+  if (!entry->stash_.empty()) {
+    delivered_stashes_.push_back(std::move(entry->stash_));
+    entry->stash_.clear();
+    const std::string &stash = delivered_stashes_.back();
+    entry->channel_->addReceived(stash.data(),
+                                 static_cast<ssize_t>(stash.size()));
+  }
+  if (end) {
+    entry->channel_->addReceived(nullptr, entry->end_);
+    entry->end_delivered_ = true;
+  }
+  activate(entry, activeChannels);
+}
+
+void UringPoller::addBuffer(uint16_t bid) {
+  struct io_uring_buf &buf = buf_ring_[buf_tail_ & (K_BUFFER_COUNT - 1)];
+  char *data = buffers_ + static_cast<size_t>(bid) * K_BUFFER_SIZE;
+  buf.addr = reinterpret_cast<uint64_t>(data);
+  buf.len = K_BUFFER_SIZE;
+  buf.bid = bid;
+  ++buf_tail_;
+}
+
+void UringPoller::recycleBuffers() {
+  if (used_buffers_.empty()) {
+    return;
+  }
+  for (uint16_t bid : used_buffers_) {
+    addBuffer(bid);
+  }
+  used_buffers_.clear();
+  storeRelease(&buf_ring_[0].resv, buf_tail_);
+}
+
+uint64_t UringPoller::userData(int fd, RequestKind kind, uint32_t serial) {
+  return (static_cast<uint64_t>(static_cast<uint32_t>(fd)) << 32) |
+         (static_cast<uint64_t>(kind) << K_SERIAL_BITS) |
+         (serial & K_SERIAL_MASK);
+}
+
+uint32_t UringPoller::nextSerial() {
+  serial_ = (serial_ + 1) & K_SERIAL_MASK;
+  return serial_;
+}
+
+} // namespace lynx
@@ -0,0 +1,24 @@
+#include "lynx/timer/tree_timer_queue.h"
+#include "lynx/timer/wheel_timer_queue.h"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace lynx {
+
+TimerQueue *TimerQueue::newDefaultTimerQueue(EventLoop *loop) {
+  const char *timerfd = ::getenv("LYNX_TIMERFD");
+  bool use_timerfd = timerfd == nullptr || ::strcmp(timerfd, "off") != 0;
+  const char *backend = ::getenv("LYNX_TIMER_QUEUE");
+  if (backend != nullptr && ::strcmp(backend, "wheel") == 0) {
+    int64_t resolution_us = WheelTimerQueue::K_DEFAULT_RESOLUTION_US;
+    const char *resolution = ::getenv("LYNX_TIMER_RESOLUTION_US");
+    if (resolution != nullptr && ::atoll(resolution) > 0) {
+      resolution_us = ::atoll(resolution);
+    }
+    return new WheelTimerQueue(loop, resolution_us, use_timerfd);
+  }
+  return new TreeTimerQueue(loop, use_timerfd);
+}
+
+} // namespace lynx
@@ -4,11 +4,19 @@ namespace lynx {
 
 std::atomic_int64_t Timer::num_created;
 
-void Timer::restart(Timestamp now) {
+void Timer::reset(TimerCallback cb, MonoTime when, double interval) {
+  callback_ = std::move(cb);
+  expiration_ = when;
+  interval_ = interval;
+  repeat_ = interval > 0.0;
+  sequence_.store(num_created.fetch_add(1), std::memory_order_relaxed);
+}
+
+void Timer::restart(MonoTime now) {
   if (repeat_) {
     expiration_ = addTime(now, interval_);
   } else {
-    expiration_ = Timestamp::invalid();
+    expiration_ = MonoTime::invalid();
   }
 }
 
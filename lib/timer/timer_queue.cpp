@@ -3,6 +3,7 @@
 #include "lynx/net/event_loop.h"
 #include "lynx/timer/timer.h"
 
+#include <algorithm>
 #include <cassert>
 #include <sys/timerfd.h>
 
@@ -38,9 +39,8 @@ int createTimerfd() {
  *
  * @return The time difference between the current time and the specified time.
  */
-struct timespec howMuchTimeFromNow(Timestamp when) {
-  int64_t microseconds =
-      when.microsecsSinceEpoch() - Timestamp::now().microsecsSinceEpoch();
+struct timespec howMuchTimeFromNow(MonoTime when) {
+  int64_t microseconds = when.microsecs() - MonoTime::now().microsecs();
   /// Ensure that the time difference is at least 100 microseconds.
   if (microseconds < 100) {
     microseconds = 100;
@@ -66,11 +66,11 @@ struct timespec howMuchTimeFromNow(Timestamp when) {
  * @param timerfd The file descriptor of the timerfd.
  * @param now The current time.
  */
-void readTimerfd(int timerfd, Timestamp now) {
+void readTimerfd(int timerfd, MonoTime now) {
   uint64_t howmany;
   ssize_t n = ::read(timerfd, &howmany, sizeof(howmany));
   LOG_TRACE << "TimerQueue::handleRead() " << howmany << " at "
-            << now.toString();
+            << now.microsecs();
   if (n != sizeof(howmany)) {
     LOG_ERROR << "TimerQueue::handleRead() reads " << n
               << " bytes instead of 8";
@@ -89,7 +89,7 @@ void readTimerfd(int timerfd, Timestamp now) {
  * @param timerfd The file descriptor of the timerfd.
  * @param expiration The desired expiration time.
  */
-void resetTimerfd(int timerfd, Timestamp expiration) {
+void resetTimerfd(int timerfd, MonoTime expiration) {
   struct itimerspec new_value;
   struct itimerspec old_value;
   memset(&new_value, 0, sizeof(new_value));
@@ -104,143 +104,76 @@ void resetTimerfd(int timerfd, Timestamp expiration) {
 
 } // namespace detail
 
-TimerQueue::TimerQueue(EventLoop *loop)
-    : loop_(loop), timerfd_(detail::createTimerfd()),
-      timerfd_channel_(loop, timerfd_), calling_expired_timers_(false) {
-  timerfd_channel_.setReadCallback([this](auto && /*PH1*/) { handleRead(); });
-  timerfd_channel_.enableReading();
+TimerQueue::TimerQueue(EventLoop *loop, bool useTimerfd)
+    : loop_(loop), timerfd_(useTimerfd ? detail::createTimerfd() : -1) {
+  if (timerfd_ >= 0) {
+    timerfd_channel_ = std::make_unique<Channel>(loop, timerfd_);
+    timerfd_channel_->setReadCallback(
+        [this](auto && /*PH1*/) { handleRead(); });
+    timerfd_channel_->enableReading();
+  }
 }
 
 TimerQueue::~TimerQueue() {
-  timerfd_channel_.disableAll();
-  timerfd_channel_.remove();
-  ::close(timerfd_);
-  for (const Entry &timer : timers_) {
-    delete timer.second;
+  if (timerfd_ >= 0) {
+    timerfd_channel_->disableAll();
+    timerfd_channel_->remove();
+    ::close(timerfd_);
   }
 }
 
-TimerId TimerQueue::addTimer(TimerCallback cb, Timestamp when,
-                             double interval) {
-  auto *timer = new Timer(std::move(cb), when, interval);
+TimerId TimerQueue::addTimer(TimerCallback cb, MonoTime when, double interval) {
+  Timer *timer = newTimer(std::move(cb), when, interval);
+  /// Taken first, the timer may be run and gone once it is in the loop
+  TimerId timer_id(timer, timer->sequence());
   loop_->runInLoop([this, timer] { addTimerInLoop(timer); });
-  return {timer, timer->sequence()};
+  return timer_id;
 }
 
 void TimerQueue::cancel(TimerId timerId) {
   loop_->runInLoop([this, timerId] { cancelInLoop(timerId); });
 }
 
-void TimerQueue::addTimerInLoop(Timer *timer) {
-  loop_->assertInLoopThread();
-  bool earliest_changed = insert(timer);
-
-  if (earliest_changed) {
-    detail::resetTimerfd(timerfd_, timer->expiration());
+int TimerQueue::pollTimeout(MonoTime now, int maxMs) const {
+  if (!next_expiration_.valid()) {
+    return maxMs;
   }
-}
-
-void TimerQueue::cancelInLoop(TimerId timerId) {
-  loop_->assertInLoopThread();
-  assert(timers_.size() == active_timers_.size());
-  ActiveTimer timer(timerId.timer_, timerId.sequence_);
-  auto it = active_timers_.find(timer);
-  if (it != active_timers_.end()) {
-    size_t n = timers_.erase(Entry(it->first->expiration(), it->first));
-    assert(n == 1);
-    (void)n;
-    delete it->first;
-    active_timers_.erase(it);
-  } else if (calling_expired_timers_) {
-    canceling_timers_.insert(timer);
+  int64_t microseconds = next_expiration_.microsecs() - now.microsecs();
+  if (microseconds <= 0) {
+    return 0;
   }
-  assert(timers_.size() == active_timers_.size());
+  /// Rounded up, a timer never runs early
+  return static_cast<int>(
+      std::min<int64_t>((microseconds + 999) / 1000, maxMs));
 }
 
-void TimerQueue::handleRead() {
+void TimerQueue::expireDue(MonoTime now) {
   loop_->assertInLoopThread();
-  Timestamp now(Timestamp::now());
-  detail::readTimerfd(timerfd_, now);
-
-  std::vector<Entry> expired = getExpired(now);
-
-  calling_expired_timers_ = true;
-  canceling_timers_.clear();
-  for (const Entry &it : expired) {
-    it.second->run();
+  if (!next_expiration_.valid()) {
+    return;
   }
-  calling_expired_timers_ = false;
-
-  reset(expired, now);
-}
-
-std::vector<TimerQueue::Entry> TimerQueue::getExpired(Timestamp now) {
-  assert(timers_.size() == active_timers_.size());
-  std::vector<Entry> expired;
-  Entry sentry(now, reinterpret_cast<Timer *>(UINTPTR_MAX));
-  auto end = timers_.lower_bound(sentry);
-  assert(end == timers_.end() || now < end->first);
-  std::copy(timers_.begin(), end, back_inserter(expired));
-  timers_.erase(timers_.begin(), end);
-
-  for (const Entry &it : expired) {
-    ActiveTimer timer(it.second, it.second->sequence());
-    size_t n = active_timers_.erase(timer);
-    assert(n == 1);
-    (void)n;
+  if (now < next_expiration_) {
+    return;
   }
-
-  assert(timers_.size() == active_timers_.size());
-  return expired;
+  /// Spent, the backend arms again for the timers left
+  next_expiration_ = MonoTime::invalid();
+  expire(now);
 }
 
-void TimerQueue::reset(const std::vector<Entry> &expired, Timestamp now) {
-  Timestamp next_expire;
-
-  for (const Entry &it : expired) {
-    ActiveTimer timer(it.second, it.second->sequence());
-    if (it.second->repeat() &&
-        canceling_timers_.find(timer) == canceling_timers_.end()) {
-      it.second->restart(now);
-      insert(it.second);
-    } else {
-      delete it.second;
-    }
-  }
-
-  if (!timers_.empty()) {
-    next_expire = timers_.begin()->second->expiration();
-  }
-
-  if (next_expire.valid()) {
-    detail::resetTimerfd(timerfd_, next_expire);
+void TimerQueue::arm(MonoTime expiration) {
+  if (timerfd_ >= 0) {
+    detail::resetTimerfd(timerfd_, expiration);
+  } else {
+    next_expiration_ = expiration;
   }
 }
 
-bool TimerQueue::insert(Timer *timer) {
+void TimerQueue::handleRead() {
   loop_->assertInLoopThread();
-  assert(timers_.size() == active_timers_.size());
-  bool earliest_changed = false;
-  Timestamp when = timer->expiration();
-  auto it = timers_.begin();
-  if (it == timers_.end() || when < it->first) {
-    earliest_changed = true;
-  }
-  {
-    std::pair<TimerList::iterator, bool> result =
-        timers_.insert(Entry(when, timer));
-    assert(result.second);
-    (void)result;
-  }
-  {
-    std::pair<ActiveTimerSet::iterator, bool> result =
-        active_timers_.insert(ActiveTimer(timer, timer->sequence()));
-    assert(result.second);
-    (void)result;
-  }
-
-  assert(timers_.size() == active_timers_.size());
-  return earliest_changed;
+  /// The timerfd is a channel of this poll, its time is current
+  MonoTime now(loop_->loopNow());
+  detail::readTimerfd(timerfd_, now);
+  expire(now);
 }
 
 } // namespace lynx
@@ -0,0 +1,102 @@
+#include "lynx/timer/timing_wheel.h"
+#include "lynx/net/event_loop.h"
+
+#include <cassert>
+#include <cmath>
+
+namespace lynx {
+
+void TimingWheel::Entry::unlink() {
+  if (wheel_ != nullptr) {
+    wheel_->loop_->assertInLoopThread();
+    unlinkRaw(this);
+    --wheel_->size_;
+    wheel_ = nullptr;
+  }
+}
+
+TimingWheel::TimingWheel(EventLoop *loop, double tick, size_t buckets)
+    : loop_(loop), tick_(tick), num_buckets_(buckets),
+      buckets_(new Entry[buckets]), now_(0), size_(0), ticking_(false) {
+  assert(tick > 0.0);
+  assert(buckets > 0);
+}
+
+TimingWheel::~TimingWheel() {
+  /// Entries outliving the wheel are left unlinked
+  for (size_t i = 0; i < num_buckets_; ++i) {
+    Entry *head = &buckets_[i];
+    while (head->next_ != head) {
+      Entry *entry = head->next_;
+      unlinkRaw(entry);
+      entry->wheel_ = nullptr;
+    }
+  }
+  if (ticking_) {
+    loop_->cancel(timer_);
+  }
+}
+
+void TimingWheel::add(Entry *entry, double timeout) {
+  loop_->assertInLoopThread();
+  entry->unlink();
+  /// One more tick, the current one is partly over
+  entry->ticks_ = static_cast<int64_t>(std::ceil(timeout / tick_)) + 1;
+  entry->deadline_ = now_ + entry->ticks_;
+  entry->wheel_ = this;
+  link(entry);
+  ++size_;
+  if (!ticking_) {
+    ticking_ = true;
+    timer_ = loop_->runEvery(tick_, [this] { onTick(); });
+  }
+}
+
+void TimingWheel::onTick() {
+  ++now_;
+  /// Taken out first, the callbacks may unlink any entry
+  Entry *head = &buckets_[static_cast<size_t>(now_) % num_buckets_];
+  Entry due;
+  if (head->next_ != head) {
+    due.next_ = head->next_;
+    due.prev_ = head->prev_;
+    due.next_->prev_ = &due;
+    due.prev_->next_ = &due;
+    head->next_ = head;
+    head->prev_ = head;
+  }
+  while (due.next_ != &due) {
+    Entry *entry = due.next_;
+    unlinkRaw(entry);
+    if (entry->deadline_ > now_) {
+      /// Touched since it was linked
+      link(entry);
+      continue;
+    }
+    entry->wheel_ = nullptr;
+    --size_;
+    entry->callback_();
+  }
+  if (size_ == 0 && ticking_) {
+    ticking_ = false;
+    loop_->cancel(timer_);
+  }
+}
+
+void TimingWheel::link(Entry *entry) {
+  Entry *head =
+      &buckets_[static_cast<size_t>(entry->deadline_) % num_buckets_];
+  entry->prev_ = head->prev_;
+  entry->next_ = head;
+  head->prev_->next_ = entry;
+  head->prev_ = entry;
+}
+
+void TimingWheel::unlinkRaw(Entry *entry) {
+  entry->prev_->next_ = entry->next_;
+  entry->next_->prev_ = entry->prev_;
+  entry->prev_ = entry;
+  entry->next_ = entry;
+}
+
+} // namespace lynx
@@ -0,0 +1,131 @@
+#include "lynx/timer/tree_timer_queue.h"
+#include "lynx/net/event_loop.h"
+#include "lynx/timer/timer.h"
+
+#include <cassert>
+
+namespace lynx {
+
+TreeTimerQueue::TreeTimerQueue(EventLoop *loop, bool useTimerfd)
+    : TimerQueue(loop, useTimerfd), calling_expired_timers_(false) {}
+
+TreeTimerQueue::~TreeTimerQueue() {
+  for (const Entry &timer : timers_) {
+    delete timer.second;
+  }
+}
+
+Timer *TreeTimerQueue::newTimer(TimerCallback cb, MonoTime when,
+                               double interval) {
+  return new Timer(std::move(cb), when, interval);
+}
+
+void TreeTimerQueue::addTimerInLoop(Timer *timer) {
+  loop_->assertInLoopThread();
+  bool earliest_changed = insert(timer);
+
+  if (earliest_changed) {
+    arm(timer->expiration());
+  }
+}
+
+void TreeTimerQueue::cancelInLoop(TimerId timerId) {
+  loop_->assertInLoopThread();
+  assert(timers_.size() == active_timers_.size());
+  ActiveTimer timer(timerOf(timerId), sequenceOf(timerId));
+  auto it = active_timers_.find(timer);
+  if (it != active_timers_.end()) {
+    size_t n = timers_.erase(Entry(it->first->expiration(), it->first));
+    assert(n == 1);
+    (void)n;
+    delete it->first;
+    active_timers_.erase(it);
+  } else if (calling_expired_timers_) {
+    canceling_timers_.insert(timer);
+  }
+  assert(timers_.size() == active_timers_.size());
+}
+
+void TreeTimerQueue::expire(MonoTime now) {
+  std::vector<Entry> expired = getExpired(now);
+
+  calling_expired_timers_ = true;
+  canceling_timers_.clear();
+  for (const Entry &it : expired) {
+    it.second->run();
+  }
+  calling_expired_timers_ = false;
+
+  reset(expired, now);
+}
+
+std::vector<TreeTimerQueue::Entry> TreeTimerQueue::getExpired(MonoTime now) {
+  assert(timers_.size() == active_timers_.size());
+  std::vector<Entry> expired;
+  Entry sentry(now, reinterpret_cast<Timer *>(UINTPTR_MAX));
+  auto end = timers_.lower_bound(sentry);
+  assert(end == timers_.end() || now < end->first);
+  std::copy(timers_.begin(), end, back_inserter(expired));
+  timers_.erase(timers_.begin(), end);
+
+  for (const Entry &it : expired) {
+    ActiveTimer timer(it.second, it.second->sequence());
+    size_t n = active_timers_.erase(timer);
+    assert(n == 1);
+    (void)n;
+  }
+
+  assert(timers_.size() == active_timers_.size());
+  return expired;
+}
+
+void TreeTimerQueue::reset(const std::vector<Entry> &expired, MonoTime now) {
+  MonoTime next_expire;
+
+  for (const Entry &it : expired) {
+    ActiveTimer timer(it.second, it.second->sequence());
+    if (it.second->repeat() &&
+        canceling_timers_.find(timer) == canceling_timers_.end()) {
+      it.second->restart(now);
+      insert(it.second);
+    } else {
+      delete it.second;
+    }
+  }
+
+  if (!timers_.empty()) {
+    next_expire = timers_.begin()->second->expiration();
+  }
+
+  if (next_expire.valid()) {
+    arm(next_expire);
+  }
+}
+
+bool TreeTimerQueue::insert(Timer *timer) {
+  loop_->assertInLoopThread();
+  assert(timers_.size() == active_timers_.size());
+  bool earliest_changed = false;
+  MonoTime when = timer->expiration();
+  auto it = timers_.begin();
+  if (it == timers_.end() || when < it->first) {
+    earliest_changed = true;
+  }
+  {
+    std::pair<TimerList::iterator, bool> result =
+        timers_.insert(Entry(when, timer));
+    assert(result.second);
+    (void)result;
+  }
+  {
+    std::pair<ActiveTimerSet::iterator, bool> result =
+        active_timers_.insert(ActiveTimer(timer, timer->sequence()));
+    assert(result.second);
+    (void)result;
+  }
+
+  assert(timers_.size() == active_timers_.size());
+  return earliest_changed;
+}
+
+} // namespace lynx
@@ -0,0 +1,250 @@
+#include "lynx/timer/wheel_timer_queue.h"
+#include "lynx/net/event_loop.h"
+#include "lynx/timer/timer.h"
+
+#include <cassert>
+#include <climits>
+
+namespace lynx {
+
+namespace {
+
+/// The first set bit of a 256 bit map at or after `from`, going round, or -1.
+int firstSet(const uint64_t *bits, int from) {
+  for (int n = 0; n <= 4; ++n) {
+    int word = ((from >> 6) + n) & 3;
+    uint64_t w = bits[word];
+    if (n == 0) {
+      w &= ~uint64_t{0} << (from & 63);
+    } else if (n == 4) {
+      /// Back to the first word, the bits before `from`
+      w &= (uint64_t{1} << (from & 63)) - 1;
+    }
+    if (w != 0) {
+      return word * 64 + __builtin_ctzll(w);
+    }
+  }
+  return -1;
+}
+
+} // namespace
+
+WheelTimerQueue::WheelTimerQueue(EventLoop *loop, int64_t resolutionUs,
+                                 bool useTimerfd)
+    : TimerQueue(loop, useTimerfd), resolution_us_(resolutionUs),
+      origin_us_(MonoTime::now().microsecs()), now_tick_(0),
+      armed_tick_(INT64_MAX), bitmap_(), running_(nullptr),
+      running_canceled_(false), free_list_(nullptr) {
+  assert(resolutionUs > 0);
+}
+
+WheelTimerQueue::~WheelTimerQueue() = default;
+
+Timer *WheelTimerQueue::newTimer(TimerCallback cb, MonoTime when,
+                                 double interval) {
+  Timer *timer = acquire();
+  timer->reset(std::move(cb), when, interval);
+  return timer;
+}
+
+void WheelTimerQueue::addTimerInLoop(Timer *timer) {
+  loop_->assertInLoopThread();
+  schedule(timer);
+  if (timer->tick_ < armed_tick_) {
+    armed_tick_ = timer->tick_;
+    arm(MonoTime(origin_us_ + armed_tick_ * resolution_us_));
+  }
+}
+
+void WheelTimerQueue::cancelInLoop(TimerId timerId) {
+  loop_->assertInLoopThread();
+  Timer *timer = timerOf(timerId);
+  /// Already run or cancelled, the timer may be another one by now
+  if (timer == nullptr || timer->sequence() != sequenceOf(timerId)) {
+    return;
+  }
+  if (timer == running_) {
+    running_canceled_ = true;
+  } else if (timer->slot_ != K_NONE) {
+    unlink(timer);
+    release(timer);
+  }
+}
+
+void WheelTimerQueue::expire(MonoTime now) {
+  /// The timerfd fired, it is no longer armed
+  armed_tick_ = INT64_MAX;
+  int64_t target = (now.microsecs() - origin_us_) / resolution_us_;
+  /// Straight to the ticks with something to do
+  while (now_tick_ < target) {
+    int64_t next = nextTick();
+    if (next > target) {
+      now_tick_ = target;
+      break;
+    }
+    advanceTo(next);
+  }
+
+  List &due = slots_[K_DUE];
+  while (due.head_ != nullptr) {
+    Timer *timer = due.head_;
+    unlink(timer);
+    running_ = timer;
+    running_canceled_ = false;
+    timer->run();
+    running_ = nullptr;
+    if (timer->repeat() && !running_canceled_) {
+      timer->restart(now);
+      schedule(timer);
+    } else {
+      release(timer);
+    }
+  }
+  rearm();
+}
+
+int64_t WheelTimerQueue::tickOf(MonoTime when) const {
+  int64_t us = when.microsecs() - origin_us_;
+  return us <= 0 ? 0 : (us + resolution_us_ - 1) / resolution_us_;
+}
+
+void WheelTimerQueue::schedule(Timer *timer) {
+  timer->tick_ = std::max(tickOf(timer->expiration()), now_tick_ + 1);
+  place(timer);
+}
+
+void WheelTimerQueue::place(Timer *timer) {
+  int64_t delta = timer->tick_ - now_tick_;
+  int level = 0;
+  while (level < K_LEVELS - 1 && delta >> (K_SLOT_BITS * (level + 1)) != 0) {
+    ++level;
+  }
+  int shift = K_SLOT_BITS * level;
+  int64_t index = timer->tick_ >> shift;
+  if (delta >> (shift + K_SLOT_BITS) != 0) {
+    /// Beyond the wheel, looked at again in the last slot of the top level
+    index = (now_tick_ >> shift) + K_SLOTS - 1;
+  }
+  append(level * K_SLOTS + static_cast<int>(index & (K_SLOTS - 1)), timer);
+}
+
+void WheelTimerQueue::append(int slot, Timer *timer) {
+  List &list = slots_[slot];
+  timer->slot_ = slot;
+  timer->prev_ = list.tail_;
+  timer->next_ = nullptr;
+  if (list.tail_ != nullptr) {
+    list.tail_->next_ = timer;
+  } else {
+    list.head_ = timer;
+  }
+  list.tail_ = timer;
+  if (slot < K_DUE) {
+    bitmap_[slot / K_SLOTS][(slot % K_SLOTS) / 64] |= uint64_t{1}
+                                                      << (slot % 64);
+  }
+}
+
+void WheelTimerQueue::unlink(Timer *timer) {
+  int slot = timer->slot_;
+  List &list = slots_[slot];
+  if (timer->prev_ != nullptr) {
+    timer->prev_->next_ = timer->next_;
+  } else {
+    list.head_ = timer->next_;
+  }
+  if (timer->next_ != nullptr) {
+    timer->next_->prev_ = timer->prev_;
+  } else {
+    list.tail_ = timer->prev_;
+  }
+  timer->prev_ = nullptr;
+  timer->next_ = nullptr;
+  timer->slot_ = K_NONE;
+  if (slot < K_DUE && list.head_ == nullptr) {
+    bitmap_[slot / K_SLOTS][(slot % K_SLOTS) / 64] &=
+        ~(uint64_t{1} << (slot % 64));
+  }
+}
+
+int WheelTimerQueue::cascade(int level) {
+  int index =
+      static_cast<int>((now_tick_ >> (K_SLOT_BITS * level)) & (K_SLOTS - 1));
+  int slot = level * K_SLOTS + index;
+  Timer *timer = slots_[slot].head_;
+  slots_[slot] = List();
+  bitmap_[level][index / 64] &= ~(uint64_t{1} << (index % 64));
+  while (timer != nullptr) {
+    Timer *next = timer->next_;
+    place(timer);
+    timer = next;
+  }
+  return index;
+}
+
+void WheelTimerQueue::advanceTo(int64_t tick) {
+  now_tick_ = tick;
+  int index = static_cast<int>(tick & (K_SLOTS - 1));
+  /// A level comes round when the one below wraps
+  if (index == 0) {
+    for (int level = 1; level < K_LEVELS && cascade(level) == 0; ++level) {
+    }
+  }
+  List &slot = slots_[index];
+  while (slot.head_ != nullptr) {
+    Timer *timer = slot.head_;
+    unlink(timer);
+    append(K_DUE, timer);
+  }
+}
+
+int64_t WheelTimerQueue::nextTick() const {
+  int64_t next = INT64_MAX;
+  for (int level = 0; level < K_LEVELS; ++level) {
+    int shift = K_SLOT_BITS * level;
+    int64_t from = (now_tick_ >> shift) + 1;
+    int index = firstSet(bitmap_[level], static_cast<int>(from % K_SLOTS));
+    if (index >= 0) {
+      /// The tick the slot comes up at, the first tick of its range
+      int64_t ahead = (index - from) & (K_SLOTS - 1);
+      next = std::min(next, (from + ahead) << shift);
+    }
+  }
+  return next;
+}
+
+void WheelTimerQueue::rearm() {
+  int64_t next = nextTick();
+  if (next != INT64_MAX && next != armed_tick_) {
+    armed_tick_ = next;
+    arm(MonoTime(origin_us_ + next * resolution_us_));
+  }
+}
+
+Timer *WheelTimerQueue::acquire() {
+  std::lock_guard<std::mutex> lock(pool_mutex_);
+  if (free_list_ == nullptr) {
+    chunks_.emplace_back(new Timer[K_CHUNK]);
+    Timer *chunk = chunks_.back().get();
+    for (size_t i = 0; i < K_CHUNK; ++i) {
+      chunk[i].next_ = free_list_;
+      free_list_ = &chunk[i];
+    }
+  }
+  Timer *timer = free_list_;
+  free_list_ = timer->next_;
+  timer->next_ = nullptr;
+  timer->slot_ = K_NONE;
+  return timer;
+}
+
+void WheelTimerQueue::release(Timer *timer) {
+  /// What the callback holds goes now, and stale ids no longer match
+  timer->callback_ = TimerCallback();
+  timer->sequence_.store(-1, std::memory_order_relaxed);
+  std::lock_guard<std::mutex> lock(pool_mutex_);
+  timer->next_ = free_list_;
+  free_list_ = timer;
+}
+
+} // namespace lynx
@@ -5,6 +5,7 @@
 #include "lynx/http/http_request.h"
 #include "lynx/http/http_response.h"
 #include "lynx/http/http_server.h"
+#include "lynx/http/static_file_handler.h"
 #include "lynx/net/event_loop.h"
 #include "lynx/net/inet_address.h"
 
@@ -59,6 +60,14 @@ public:
   void addRoute(const std::string &method, const std::string &path,
                 HttpHandler handler);
 
+  /**
+   * @brief Serves the files under a directory for GET and HEAD requests.
+   *
+   * @param prefix The URL path prefix of the files, e.g. "/static".
+   * @param root The directory the files are served from.
+   */
+  void addStatic(const std::string &prefix, const std::string &root);
+
   /// Print the route table.
   void printRouteTable();
 
@@ -0,0 +1,62 @@
+#ifndef LYNX_BASE_CPU_AFFINITY_H
+#define LYNX_BASE_CPU_AFFINITY_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace lynx {
+
+/**
+ * @class CpuAffinity
+ * @brief The CPUs a thread, or a group of threads, is allowed to run on.
+ *
+ * Empty means no pinning, the scheduler is free to move the thread. A group
+ * of threads (the IO loops, a ThreadPool) is spread with one CPU per thread,
+ * see cpuFor(), so that each keeps its caches warm.
+ */
+class CpuAffinity {
+public:
+  /// No pinning.
+  CpuAffinity() = default;
+  explicit CpuAffinity(std::vector<int> cpus);
+
+  /**
+   * @brief Parses an affinity specification.
+   *
+   * Either a list of CPUs and ranges such as "0-3,8,10-11", "physical_cores"
+   * for physicalCores(), or "" / "none" for no pinning.
+   *
+   * @throws std::invalid_argument if `spec` is malformed.
+   */
+  static CpuAffinity parse(const std::string &spec);
+
+  /**
+   * @brief One CPU of each physical core this process may run on.
+   *
+   * SMT siblings share the caches of their core, only the lowest numbered one
+   * is kept. Read from /sys/devices/system/cpu, every allowed CPU is taken as
+   * a core of its own where the topology is not exposed.
+   */
+  static CpuAffinity physicalCores();
+
+  bool empty() const { return cpus_.empty(); }
+  const std::vector<int> &cpus() const { return cpus_; }
+
+  /// The single CPU of the `index`th thread of a group, taken in turn, or no
+  /// pinning if empty.
+  CpuAffinity cpuFor(size_t index) const;
+
+  /// Pins the calling thread, returns false with errno set on failure.
+  bool applyToCurrentThread() const;
+
+  /// E.g. "0,2,4", for logging.
+  std::string toString() const;
+
+private:
+  std::vector<int> cpus_; /// Sorted, without duplicates.
+};
+
+} // namespace lynx
+
+#endif
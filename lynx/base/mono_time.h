@@ -0,0 +1,82 @@
+#ifndef LYNX_BASE_MONO_TIME_H
+#define LYNX_BASE_MONO_TIME_H
+
+#include "lynx/base/timestamp.h"
+
+#include <cstdint>
+#include <ctime>
+
+namespace lynx {
+
+/**
+ * @class MonoTime
+ * @brief A point on the monotonic clock, in microseconds.
+ *
+ * Unlike Timestamp, it does not move when the wall clock is set or slewed by
+ * NTP, so timers and deadlines are kept in it. It means nothing across
+ * processes or reboots and is not for display.
+ *
+ * now() reads CLOCK_MONOTONIC and coarseNow() CLOCK_MONOTONIC_COARSE, both
+ * through the vDSO without a system call. The coarse clock is cheaper still
+ * but only moves once a scheduler tick, a few milliseconds.
+ */
+class MonoTime {
+public:
+  /// Constructs an invalid time.
+  MonoTime() : microsecs_(0) {}
+
+  /// Constructs a time from microseconds on the monotonic clock.
+  explicit MonoTime(int64_t microsecs) : microsecs_(microsecs) {}
+
+  /// Gets the microseconds on the monotonic clock.
+  int64_t microsecs() const { return microsecs_; }
+
+  /// Checks if the time is valid.
+  bool valid() const { return microsecs_ > 0; }
+
+  /// Creates a time for the current instant.
+  static MonoTime now() { return read(CLOCK_MONOTONIC); }
+
+  /// Creates a time for the current instant, to a scheduler tick.
+  static MonoTime coarseNow() { return read(CLOCK_MONOTONIC_COARSE); }
+
+  /// Creates an invalid time.
+  static MonoTime invalid() { return {}; }
+
+private:
+  static MonoTime read(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    int64_t seconds = ts.tv_sec;
+    return MonoTime(seconds * Timestamp::K_MICRO_SECS_PER_SEC +
+                    ts.tv_nsec / 1000);
+  }
+
+  int64_t microsecs_;
+};
+
+/// Compares two monotonic times for ordering.
+inline bool operator<(MonoTime lhs, MonoTime rhs) {
+  return lhs.microsecs() < rhs.microsecs();
+}
+
+/// Compares two monotonic times for equality.
+inline bool operator==(MonoTime lhs, MonoTime rhs) {
+  return lhs.microsecs() == rhs.microsecs();
+}
+
+/// Gets the seconds from `low` to `high`.
+inline double timeDiff(MonoTime high, MonoTime low) {
+  int64_t diff = high.microsecs() - low.microsecs();
+  return static_cast<double>(diff) / Timestamp::K_MICRO_SECS_PER_SEC;
+}
+
+/// Gets the time `seconds` after `time`.
+inline MonoTime addTime(MonoTime time, double seconds) {
+  auto delta = static_cast<int64_t>(seconds * Timestamp::K_MICRO_SECS_PER_SEC);
+  return MonoTime(time.microsecs() + delta);
+}
+
+} // namespace lynx
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef LYNX_BASE_MPSC_QUEUE_H
+#define LYNX_BASE_MPSC_QUEUE_H
+
+#include "lynx/base/noncopyable.h"
+
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <utility>
+
+namespace lynx {
+
+/**
+ * @class MpscQueue
+ * @brief A lock-free, unbounded, multi-producer single-consumer queue.
+ *
+ * Dmitry Vyukov's intrusive MPSC queue. The link lives in the node holding
+ * the value, so a push is one allocation and one atomic exchange, whatever
+ * the number of producers, and a pop takes no atomic read-modify-write at
+ * all.
+ *
+ * A producer is briefly between its exchange and its link. A pop in that
+ * window sees the queue as empty even though the push has begun, so a
+ * consumer that sleeps on an empty queue must be woken by the producer
+ * after push() returns (see EventLoop::queueInLoop()).
+ *
+ * @tparam T The value type, it must be movable.
+ */
+template <typename T> class MpscQueue : Noncopyable {
+public:
+  MpscQueue() : head_(&stub_), tail_(&stub_), size_(0) {}
+
+  ~MpscQueue() {
+    while (pop()) {
+    }
+  }
+
+  /// Enqueues `value`, may be called from any thread.
+  void push(T value) {
+    Node *node = new Node(std::move(value));
+    size_.fetch_add(1, std::memory_order_relaxed);
+    Node *prev = head_.exchange(node, std::memory_order_acq_rel);
+    /// seq_cst pairs with the consumer's check before it sleeps
+    prev->next_.store(node, std::memory_order_seq_cst);
+  }
+
+  /// Dequeues a value, only to be called from the consumer thread.
+  std::optional<T> pop() {
+    Node *tail = tail_;
+    Node *next = tail->next_.load(std::memory_order_acquire);
+    if (tail == &stub_) {
+      if (next == nullptr) {
+        return std::nullopt;
+      }
+      /// Step over the stub, it only keeps the list non-empty
+      tail_ = next;
+      tail = next;
+      next = next->next_.load(std::memory_order_acquire);
+    }
+    if (next != nullptr) {
+      tail_ = next;
+      return take(tail);
+    }
+    if (tail != head_.load(std::memory_order_acquire)) {
+      /// A producer is between its exchange and its link
+      return std::nullopt;
+    }
+    /// `tail` is the last node, put the stub behind it to detach it
+    pushNode(&stub_);
+    next = tail->next_.load(std::memory_order_acquire);
+    if (next != nullptr) {
+      tail_ = next;
+      return take(tail);
+    }
+    return std::nullopt;
+  }
+
+  /**
+   * @brief Returns true if no value is linked in, only to be called from the
+   * consumer thread.
+   *
+   * Sequentially consistent, so a consumer that publishes it is about to
+   * sleep and then finds the queue empty cannot miss a producer that pushes
+   * and then checks whether the consumer sleeps.
+   */
+  bool empty() const {
+    Node *tail = tail_;
+    Node *next = tail->next_.load(std::memory_order_seq_cst);
+    return tail == &stub_ && next == nullptr;
+  }
+
+  /// Returns the number of values, approximate while producers push.
+  size_t size() const { return size_.load(std::memory_order_relaxed); }
+
+private:
+  struct Node {
+    Node() : next_(nullptr) {}
+    explicit Node(T &&value) : next_(nullptr), value_(std::move(value)) {}
+
+    std::atomic<Node *> next_;
+    std::optional<T> value_;
+  };
+
+  void pushNode(Node *node) {
+    node->next_.store(nullptr, std::memory_order_relaxed);
+    Node *prev = head_.exchange(node, std::memory_order_acq_rel);
+    prev->next_.store(node, std::memory_order_seq_cst);
+  }
+
+  std::optional<T> take(Node *node) {
+    std::optional<T> value(std::move(node->value_));
+    delete node;
+    size_.fetch_sub(1, std::memory_order_relaxed);
+    return value;
+  }
+
+  std::atomic<Node *> head_; /// Last pushed, producers swap it
+  Node *tail_;               /// Next to pop, owned by the consumer
+  Node stub_;
+  std::atomic<size_t> size_;
+};
+
+} // namespace lynx
+
+#endif
@@ -0,0 +1,151 @@
+#ifndef LYNX_BASE_TASK_H
+#define LYNX_BASE_TASK_H
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace lynx {
+
+/**
+ * @class Task
+ * @brief A move-only `void()` callable with inline storage.
+ *
+ * A drop-in for std::function<void()> where the callable is handed over
+ * rather than shared: posted to an EventLoop, armed as a timer or queued in a
+ * ThreadPool. Callables up to K_INLINE_SIZE bytes (e.g. a lambda capturing a
+ * TcpConnectionPtr, a std::string and a pointer) are stored in the Task
+ * itself instead of on the heap, and since a Task is never copied its callable
+ * may capture move-only state such as a std::unique_ptr.
+ *
+ * Larger callables, over-aligned ones and ones whose move may throw are kept
+ * on the heap, moving the Task then only moves a pointer.
+ */
+class Task {
+public:
+  /// Keeps sizeof(Task) at 64 bytes, one cache line
+  static const size_t K_INLINE_SIZE = 56;
+
+  Task() noexcept : ops_(nullptr) {}
+  Task(std::nullptr_t) noexcept : ops_(nullptr) {}
+
+  /// Wraps `f`, stored inline if it fits.
+  template <typename F,
+            typename Fn = std::decay_t<F>,
+            typename = std::enable_if_t<!std::is_same_v<Fn, Task> &&
+                                        std::is_invocable_r_v<void, Fn &>>>
+  Task(F &&f) : ops_(nullptr) {
+    if (isNull<Fn>(f)) {
+      return;
+    }
+    if constexpr (isInline<Fn>()) {
+      ::new (static_cast<void *>(storage_)) Fn(std::forward<F>(f));
+      ops_ = &K_INLINE_OPS<Fn>;
+    } else {
+      ::new (static_cast<void *>(storage_)) Fn *(new Fn(std::forward<F>(f)));
+      ops_ = &K_HEAP_OPS<Fn>;
+    }
+  }
+
+  Task(Task &&other) noexcept : ops_(other.ops_) {
+    if (ops_ != nullptr) {
+      ops_->move_(other.storage_, storage_);
+      other.ops_ = nullptr;
+    }
+  }
+
+  Task &operator=(Task &&other) noexcept {
+    if (this != &other) {
+      reset();
+      if (other.ops_ != nullptr) {
+        other.ops_->move_(other.storage_, storage_);
+        ops_ = other.ops_;
+        other.ops_ = nullptr;
+      }
+    }
+    return *this;
+  }
+
+  Task &operator=(std::nullptr_t) noexcept {
+    reset();
+    return *this;
+  }
+
+  Task(const Task &) = delete;
+  Task &operator=(const Task &) = delete;
+
+  ~Task() { reset(); }
+
+  /// Runs the callable, the Task must not be empty.
+  void operator()() const { ops_->invoke_(storage_); }
+
+  explicit operator bool() const noexcept { return ops_ != nullptr; }
+
+  /// Returns whether a callable of type `Fn` is stored without allocating.
+  template <typename Fn> static constexpr bool isInline() {
+    return sizeof(Fn) <= K_INLINE_SIZE &&
+           alignof(Fn) <= alignof(std::max_align_t) &&
+           std::is_nothrow_move_constructible_v<Fn>;
+  }
+
+private:
+  struct Ops {
+    void (*invoke_)(void *storage);
+    /// Move-constructs into `to` and destroys what is left in `from`
+    void (*move_)(void *from, void *to) noexcept;
+    void (*destroy_)(void *storage) noexcept;
+  };
+
+  template <typename Fn> static Fn *inlineTarget(void *storage) {
+    return std::launder(static_cast<Fn *>(storage));
+  }
+
+  template <typename Fn> static Fn *&heapTarget(void *storage) {
+    return *std::launder(static_cast<Fn **>(storage));
+  }
+
+  template <typename Fn>
+  static constexpr Ops K_INLINE_OPS = {
+      [](void *storage) { (*inlineTarget<Fn>(storage))(); },
+      [](void *from, void *to) noexcept {
+        Fn *source = inlineTarget<Fn>(from);
+        ::new (to) Fn(std::move(*source));
+        source->~Fn();
+      },
+      [](void *storage) noexcept { inlineTarget<Fn>(storage)->~Fn(); }};
+
+  template <typename Fn>
+  static constexpr Ops K_HEAP_OPS = {
+      [](void *storage) { (*heapTarget<Fn>(storage))(); },
+      [](void *from, void *to) noexcept {
+        ::new (to) Fn *(heapTarget<Fn>(from));
+      },
+      [](void *storage) noexcept { delete heapTarget<Fn>(storage); }};
+
+  /// An empty function pointer or std::function makes an empty Task
+  template <typename Fn> static bool isNull(const Fn &f) {
+    if constexpr (std::is_pointer_v<Fn>) {
+      return f == nullptr;
+    } else if constexpr (std::is_same_v<Fn, std::function<void()>>) {
+      return !f;
+    } else {
+      return false;
+    }
+  }
+
+  void reset() noexcept {
+    if (ops_ != nullptr) {
+      ops_->destroy_(storage_);
+      ops_ = nullptr;
+    }
+  }
+
+  alignas(std::max_align_t) mutable unsigned char storage_[K_INLINE_SIZE];
+  const Ops *ops_;
+};
+
+} // namespace lynx
+
+#endif
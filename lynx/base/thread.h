@@ -1,6 +1,7 @@
 #ifndef LYNX_BASE_THREAD_H
 #define LYNX_BASE_THREAD_H
 
+#include "lynx/base/cpu_affinity.h"
 #include "lynx/base/noncopyable.h"
 
 #include <atomic>
@@ -52,6 +53,15 @@ public:
   /// Waits for the thread to finish.
   void join();
 
+  /**
+   * @brief Sets the CPUs the thread runs on, to be called before start().
+   *
+   * The thread pins itself before running its function, failing to only
+   * prints a warning and runs unpinned.
+   */
+  void setCpuAffinity(const CpuAffinity &affinity) { affinity_ = affinity; }
+  const CpuAffinity &cpuAffinity() const { return affinity_; }
+
   /// Returns whether the thread has started.
   bool started() const { return started_; }
 
@@ -73,6 +83,7 @@ private:
   ThreadFunc func_;  /// The function to be executed in the thread.
   std::string name_; /// The name of the thread.
   std::latch latch_; /// The latch used for synchronization.
+  CpuAffinity affinity_; /// The CPUs to run on, empty for any.
 
   /// The atomic counter for the number of Thread objects created.
   static std::atomic_int32_t num_created;
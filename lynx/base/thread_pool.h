@@ -1,6 +1,7 @@
 #ifndef LYNX_BASE_THREAD_POOL_H
 #define LYNX_BASE_THREAD_POOL_H
 
+#include "lynx/base/task.h"
 #include "lynx/base/thread.h"
 
 #include <condition_variable>
@@ -18,7 +19,7 @@ namespace lynx {
  */
 class ThreadPool : Noncopyable {
 public:
-  using Task = std::function<void()>;
+  using Task = ::lynx::Task;
 
   explicit ThreadPool(const std::string &name = std::string("ThreadPool"));
   ~ThreadPool();
@@ -46,7 +47,11 @@ public:
 
   /// Sets the callback to be executed by each thread before it starts
   /// processing tasks.
-  void setThreadInitCallback(const Task &cb) { thread_init_callback_ = cb; }
+  void setThreadInitCallback(Task cb) { thread_init_callback_ = std::move(cb); }
+
+  /// Pins the threads, one CPU of `affinity` each in turn, to be called before
+  /// start(). See CpuAffinity::cpuFor().
+  void setCpuAffinity(const CpuAffinity &affinity) { affinity_ = affinity; }
 
   /// Returns the name of the thread pool.
   const std::string &name() const { return name_; }
@@ -107,6 +112,7 @@ private:
   /// Callback that will be executed by each thread before it starts processing
   /// tasks.
   Task thread_init_callback_;
+  CpuAffinity affinity_; /// The CPUs of the threads, empty for any.
 
   std::vector<std::unique_ptr<Thread>> threads_; /// The threads in the pool.
   std::deque<Task> queue_;                       /// The task queue.
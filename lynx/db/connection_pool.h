@@ -86,6 +86,13 @@ public:
    */
   void start();
 
+  /// Pins the producer and recycler threads to `affinity`, to be called
+  /// before start().
+  void setCpuAffinity(const CpuAffinity &affinity) {
+    produce_thread_.setCpuAffinity(affinity);
+    recycle_thread_.setCpuAffinity(affinity);
+  }
+
   /**
    * @brief Stops the connection pool by joining the threads and deleting all
    * the connections in the queue.
@@ -0,0 +1,129 @@
+#ifndef LYNX_HTTP_HTTP_BODY_STREAM_H
+#define LYNX_HTTP_HTTP_BODY_STREAM_H
+
+#include "lynx/base/noncopyable.h"
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+
+namespace lynx {
+
+/**
+ * @class HttpBodyStream
+ * @brief Receives a request body as it arrives, instead of the input buffer
+ * holding all of it.
+ *
+ * Bytes are kept in memory up to a spill threshold, then everything moves to
+ * an anonymous temporary file, so the memory a connection holds is bounded
+ * whatever the size of the upload. A handler that wants the bytes as they
+ * arrive sets a chunk callback instead, and nothing is stored.
+ *
+ * A stored body is limited to the max size, which the body stream selector
+ * may raise for the routes that accept large uploads.
+ */
+class HttpBodyStream : Noncopyable {
+public:
+  using ChunkCallback = std::function<void(std::string_view)>;
+
+  /// The default spill threshold
+  static const size_t K_SPILL_THRESHOLD = 1024 * 1024;
+  /// The default of setMaxSize()
+  static const size_t K_MAX_SIZE = 1024 * 1024 * 1024;
+
+  explicit HttpBodyStream(size_t spillThreshold = K_SPILL_THRESHOLD);
+  ~HttpBodyStream();
+
+  /// Passes every piece of the body to `cb` as it arrives, nothing is stored.
+  void setChunkCallback(const ChunkCallback &cb) { chunk_callback_ = cb; }
+  bool hasChunkCallback() const { return static_cast<bool>(chunk_callback_); }
+  void setSpillThreshold(size_t bytes) { spill_threshold_ = bytes; }
+  /// Sets the longest body stored, a longer one fails the request with 413.
+  /// Not checked with a chunk callback.
+  void setMaxSize(size_t bytes) { max_size_ = bytes; }
+  size_t maxSize() const { return max_size_; }
+
+  /// Adds the next piece of the body.
+  void append(std::string_view data);
+
+  /// Returns the number of body bytes received so far.
+  size_t size() const { return size_; }
+
+  /// Checks if the body has moved to the temporary file.
+  bool spilled() const { return fd_ >= 0; }
+
+  /// Returns the body if it is still in memory, empty once spilled().
+  std::string_view memory() const { return memory_; }
+
+  /// Returns the temporary file descriptor, or -1 if not spilled().
+  int fd() const { return fd_; }
+
+  /**
+   * @brief Reads body bytes wherever they are stored.
+   *
+   * @param offset The offset in the body.
+   * @param buf The destination.
+   * @param len The maximum number of bytes to read.
+   * @return The number of bytes read, 0 at the end, -1 on error.
+   */
+  ssize_t read(size_t offset, char *buf, size_t len) const;
+
+  /// Checks if every byte was stored, false if writing the file failed.
+  bool ok() const { return !error_; }
+
+private:
+  bool spill();
+  void writeFile(const char *data, size_t len);
+
+  size_t spill_threshold_;
+  size_t max_size_;
+  std::string memory_;
+  int fd_;
+  size_t size_;
+  bool error_;
+  ChunkCallback chunk_callback_;
+};
+
+/**
+ * @class HttpChunkedDecoder
+ * @brief Decodes a "Transfer-Encoding: chunked" body incrementally.
+ *
+ * Chunk extensions and trailer fields are skipped.
+ */
+class HttpChunkedDecoder {
+public:
+  HttpChunkedDecoder() = default;
+
+  /**
+   * @brief Decodes as much of `data` as possible.
+   *
+   * A chunk size line or trailer line is only consumed once its CRLF has
+   * arrived, so the unconsumed bytes must be passed again with more data.
+   *
+   * @param data The encoded bytes.
+   * @param len The number of encoded bytes.
+   * @param sink Called with each piece of decoded data, views into `data`.
+   * @return The number of bytes consumed, or -1 if the encoding is malformed.
+   */
+  ssize_t decode(const char *data, size_t len,
+                 const std::function<void(std::string_view)> &sink);
+
+  /// Checks if the last chunk and the trailer have been decoded.
+  bool done() const { return state_ == DONE; }
+
+  void reset() { *this = HttpChunkedDecoder(); }
+
+private:
+  enum State { SIZE, DATA, DATA_CRLF, TRAILER, DONE };
+
+  /// A size or trailer line longer than this is rejected
+  static const size_t K_MAX_LINE = 4096;
+
+  State state_ = SIZE;
+  size_t remaining_ = 0;
+};
+
+} // namespace lynx
+
+#endif
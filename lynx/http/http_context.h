@@ -3,16 +3,57 @@
 
 #include "lynx/http/http_parser.h"
 #include "lynx/http/http_request.h"
+#include "lynx/http/http_stream_writer.h"
+
+#include <functional>
 
 namespace lynx {
 
+class Buffer;
+
 /**
  * @class HttpContext
  * @brief Represents the HTTP context, which includes the HTTP request and the
  * parser.
+ *
+ * A context lives as long as its connection. Bytes of an unfinished request
+ * are left in the input buffer and the parser resumes at its saved offset when
+ * more bytes arrive, so a request may be split across any number of reads.
+ * The fields of request() are views into those bytes.
+ *
+ * A body may instead be streamed: once the header is parsed it is copied out
+ * of the input buffer, and the body bytes are handed to an HttpBodyStream and
+ * retrieved as they arrive. Bodies the body stream selector asks for are
+ * streamed, and may spill to disk; a chunked body that is not selected is
+ * decoded into memory and ends up in body() like any other.
+ *
+ * A body stored by the server in memory, in the input buffer or decoded from
+ * chunks, is limited to the max body size; a longer one is an error with 413
+ * as its status. A selected stream is limited by its own max size instead,
+ * see HttpBodyStream::setMaxSize(), and one with a chunk callback, whose
+ * bytes are not stored, is not limited.
+ * Likewise a request with more than the max headers, or whose header is
+ * longer than the max header size, fails with 431.
  */
 class HttpContext {
 public:
+  /**
+   * @brief Decides, once the header of a request is parsed, whether its body
+   * is streamed.
+   *
+   * It may configure the stream, e.g. set a chunk callback, the spill
+   * threshold or the max size, before returning true.
+   */
+  using BodyStreamSelector =
+      std::function<bool(const HttpRequest &, HttpBodyStream *)>;
+
+  /// The default of setMaxBodySize()
+  static const size_t K_MAX_BODY_SIZE = 16 * 1024 * 1024;
+  /// The default of setMaxHeaders()
+  static const size_t K_MAX_HEADERS = 100;
+  /// The default of setMaxHeaderSize()
+  static const size_t K_MAX_HEADER_SIZE = 64 * 1024;
+
   HttpContext();
 
   /// Starts parsing the HTTP request.
@@ -21,11 +62,57 @@ public:
   /**
    * @brief Parses the HTTP request.
    *
+   * `data` must start at the first byte of the current request and may hold
+   * more bytes than the previous call; parsing resumes where it stopped.
+   *
    * @param data Pointer to the request data.
    * @param len Length of the request data.
-   * @return True if the request is parsed successfully, false otherwise.
+   * @return False if the request is malformed, true otherwise (including when
+   * more data is needed).
+   */
+  bool parseRequest(const char *data, size_t len);
+
+  /**
+   * @brief Parses the HTTP request from the readable bytes of a buffer.
+   *
+   * Nothing is retrieved from the buffer: once gotAll() the request refers to
+   * its first requestLength() bytes, which the caller retrieves after the
+   * request has been handled. A streamed body is the exception, its bytes
+   * and the header before it are retrieved as they are consumed.
+   *
+   * @param buf The connection input buffer.
+   * @return False if the request is malformed, true otherwise.
    */
-  bool parseRequest(char *data, size_t len);
+  bool parseRequest(Buffer *buf);
+
+  /// Checks if a whole request (header and body) has been parsed.
+  bool gotAll() const { return got_all_; }
+
+  /// Returns the number of bytes of the parsed request, valid if gotAll().
+  size_t requestLength() const {
+    return streaming_ ? body_offset_
+                      : parser_.body_start_ + parser_.content_len_;
+  }
+
+  void setBodyStreamSelector(const BodyStreamSelector &selector) {
+    body_stream_selector_ = selector;
+  }
+  /// Sets the spill threshold of the selected body streams, see
+  /// HttpBodyStream.
+  void setSpillThreshold(size_t bytes) { spill_threshold_ = bytes; }
+  /// Sets the longest body held in memory, that of a request not selected.
+  void setMaxBodySize(size_t bytes) { max_body_size_ = bytes; }
+  /// Sets the most header fields a request may have.
+  void setMaxHeaders(size_t count) { max_headers_ = count; }
+  /// Sets the longest request line and header block, in bytes.
+  void setMaxHeaderSize(size_t bytes) { max_header_size_ = bytes; }
+
+  /// Adds a parsed header field to the request, refusing the request with 431
+  /// once it has more than the max headers.
+  void addHeader(std::string_view field, std::string_view value);
+
+  /// Resets the context for the next request on the same connection.
+  void reset();
 
   /// Checks if the parsing of the HTTP request is finished.
   bool isFinished();
@@ -33,16 +120,53 @@ public:
   /// Checks if there is an error in parsing the HTTP request.
   bool hasError();
 
+  /// The status to answer a request that failed to parse with.
+  HttpStatus errorStatus() const {
+    return error_ != HttpStatus{} ? error_ : HttpStatus::BAD_REQUEST;
+  }
+
   /// Returns a reference to the HttpRequest object.
   HttpRequest &request() { return request_; }
 
   /// Returns a reference to the HttpParser object.
   HttpParser &parser() { return parser_; }
 
+  /// The streamed response in progress on the connection, if any.
+  const HttpStreamWriterPtr &stream() const { return stream_; }
+  void setStream(const HttpStreamWriterPtr &stream) { stream_ = stream; }
+
 private:
+  /// Checks the headers that frame the body, returns false and sets the
+  /// error if the body length is ambiguous or malformed.
+  bool checkFraming();
+  /// Starts streaming the body if it is chunked or selected, returns false if
+  /// it is too long to be stored.
+  bool startBodyStream();
+  /// Hands the body bytes of [data + body_offset_, data + len) to the stream.
+  bool feedBodyStream(const char *data, size_t len);
+
   HttpRequest request_;
   HttpParser parser_;
-  int error_;
+  const char *base_; /// Address of the request bytes in the last call
+  size_t base_len_;  /// Number of request bytes in the last call
+  size_t nparsed_;   /// Bytes of the current request consumed by the parser
+  bool got_all_;
+  HttpStatus error_; /// Set when the request is refused, not just malformed
+  HttpStreamWriterPtr stream_; /// Kept across reset() until the stream ends
+
+  BodyStreamSelector body_stream_selector_;
+  size_t spill_threshold_;
+  size_t max_body_size_;
+  size_t max_headers_;
+  size_t max_header_size_;
+  bool streaming_;
+  bool chunked_;
+  bool selected_;      /// The selector asked for the stream
+  bool header_owned_;  /// The header was copied out of the input buffer
+  size_t body_offset_; /// Offset of the first unconsumed body byte
+  size_t body_left_;   /// Bytes of a Content-Length body still to come
+  HttpChunkedDecoder decoder_;
+  std::shared_ptr<HttpBodyStream> body_stream_;
 };
 
 } // namespace lynx
@@ -0,0 +1,202 @@
+#ifndef LYNX_HTTP_HTTP_HEADERS_H
+#define LYNX_HTTP_HTTP_HEADERS_H
+
+#include <cstdint>
+#include <string_view>
+#include <strings.h>
+#include <utility>
+#include <vector>
+
+namespace lynx {
+
+/// Names must have distinct lengths, stringToHttpHeader() switches on it.
+#define HTTP_KNOWN_HEADER_MAP(XX)                                              \
+  XX(0, HOST, "Host")                                                          \
+  XX(1, CONTENT_LENGTH, "Content-Length")                                      \
+  XX(2, CONTENT_TYPE, "Content-Type")                                          \
+  XX(3, CONNECTION, "Connection")                                              \
+  XX(4, COOKIE, "Cookie")                                                      \
+  XX(5, ACCEPT_ENCODING, "Accept-Encoding")                                    \
+  XX(6, TRANSFER_ENCODING, "Transfer-Encoding")
+
+/// Headers that get a dedicated slot in HttpHeaders.
+enum class HttpHeader {
+#define XX(num, name, string) name = (num),
+  HTTP_KNOWN_HEADER_MAP(XX)
+#undef XX
+      UNKNOWN_HEADER
+};
+
+/// Classifies a header name case-insensitively, without allocating.
+HttpHeader stringToHttpHeader(std::string_view name);
+const char *httpHeaderToString(const HttpHeader &h);
+
+/// Checks if `name` is a non-empty RFC 7230 token, i.e. a valid field name.
+bool isHeaderName(std::string_view name);
+
+/// Checks if `value` can be written as a field value, i.e. has no CR or LF.
+bool isHeaderValue(std::string_view value);
+
+/// Compares two header names case-insensitively.
+inline bool equalsIgnoreCase(std::string_view lhs, std::string_view rhs) {
+  return lhs.size() == rhs.size() &&
+         strncasecmp(lhs.data(), rhs.data(), lhs.size()) == 0;
+}
+
+/**
+ * @class HttpHeaders
+ * @brief A compact, insertion-ordered header table.
+ *
+ * The first `N` fields live inline in the object and only further fields spill
+ * to a vector. Each known header (see HTTP_KNOWN_HEADER_MAP) has a slot with
+ * its field index, so looking it up is O(1); other names are found by a
+ * case-insensitive scan over the few remaining fields. No lookup allocates.
+ *
+ * @tparam String The string type of names and values, std::string_view for
+ * request headers that refer to the input buffer, std::string for response
+ * headers that own their bytes.
+ * @tparam N The number of inline fields.
+ */
+template <typename String, size_t N> class HttpHeaders {
+public:
+  using Field = std::pair<String, String>;
+
+  /// Forward iterator over the fields in insertion order.
+  class ConstIterator {
+  public:
+    ConstIterator(const HttpHeaders *headers, size_t idx)
+        : headers_(headers), idx_(idx) {}
+
+    const Field &operator*() const { return (*headers_)[idx_]; }
+    const Field *operator->() const { return &(*headers_)[idx_]; }
+    ConstIterator &operator++() {
+      ++idx_;
+      return *this;
+    }
+    bool operator==(const ConstIterator &rhs) const {
+      return idx_ == rhs.idx_;
+    }
+    bool operator!=(const ConstIterator &rhs) const {
+      return idx_ != rhs.idx_;
+    }
+
+  private:
+    const HttpHeaders *headers_;
+    size_t idx_;
+  };
+
+  HttpHeaders() : size_(0) { resetKnown(); }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  Field &operator[](size_t i) { return i < N ? inline_[i] : overflow_[i - N]; }
+  const Field &operator[](size_t i) const {
+    return i < N ? inline_[i] : overflow_[i - N];
+  }
+
+  ConstIterator begin() const { return {this, 0}; }
+  ConstIterator end() const { return {this, size_}; }
+
+  /**
+   * @brief Finds the value of a header.
+   *
+   * @param key The header name, compared case-insensitively.
+   * @return A pointer to the value, or nullptr if the header is absent.
+   */
+  const String *find(std::string_view key) const {
+    int idx = indexOf(key);
+    return idx < 0 ? nullptr : &(*this)[idx].second;
+  }
+
+  /// Finds the value of a known header through its slot.
+  const String *find(HttpHeader key) const {
+    int idx = known_[static_cast<int>(key)];
+    return idx < 0 ? nullptr : &(*this)[idx].second;
+  }
+
+  /// Sets a header, replacing the value of an existing field of that name.
+  void set(const String &key, const String &val) {
+    int idx = indexOf(key);
+    if (idx >= 0) {
+      (*this)[idx].second = val;
+      return;
+    }
+    HttpHeader known = stringToHttpHeader(key);
+    if (known != HttpHeader::UNKNOWN_HEADER) {
+      known_[static_cast<int>(known)] = static_cast<int>(size_);
+    }
+    if (size_ < N) {
+      inline_[size_] = Field(key, val);
+    } else {
+      overflow_.emplace_back(key, val);
+    }
+    ++size_;
+  }
+
+  /// Removes a header, returns false if it is absent.
+  bool erase(std::string_view key) {
+    int idx = indexOf(key);
+    if (idx < 0) {
+      return false;
+    }
+    for (size_t i = idx; i + 1 < size_; ++i) {
+      (*this)[i] = std::move((*this)[i + 1]);
+    }
+    if (size_ > N) {
+      overflow_.pop_back();
+    } else {
+      inline_[size_ - 1] = Field();
+    }
+    --size_;
+    /// Erasing is rare, rebuild the slots rather than patching them
+    resetKnown();
+    for (size_t i = 0; i < size_; ++i) {
+      HttpHeader known = stringToHttpHeader((*this)[i].first);
+      if (known != HttpHeader::UNKNOWN_HEADER) {
+        known_[static_cast<int>(known)] = static_cast<int>(i);
+      }
+    }
+    return true;
+  }
+
+  void clear() {
+    for (size_t i = 0; i < size_ && i < N; ++i) {
+      inline_[i] = Field();
+    }
+    overflow_.clear();
+    size_ = 0;
+    resetKnown();
+  }
+
+private:
+  static const int K_NUM_KNOWN = static_cast<int>(HttpHeader::UNKNOWN_HEADER);
+
+  void resetKnown() {
+    for (auto &slot : known_) {
+      slot = -1;
+    }
+  }
+
+  int indexOf(std::string_view key) const {
+    HttpHeader known = stringToHttpHeader(key);
+    if (known != HttpHeader::UNKNOWN_HEADER) {
+      return known_[static_cast<int>(known)];
+    }
+    for (size_t i = 0; i < size_; ++i) {
+      if (equalsIgnoreCase((*this)[i].first, key)) {
+        return static_cast<int>(i);
+      }
+    }
+    return -1;
+  }
+
+  Field inline_[N];
+  std::vector<Field> overflow_;
+  size_t size_;
+  int known_[K_NUM_KNOWN];
+};
+
+} // namespace lynx
+
+#endif
@@ -3,6 +3,8 @@
 
 #include "lynx/http/http_request.h"
 
+#include <cstdint>
+
 namespace lynx {
 
 using ElementCallback = void (*)(void *, const char *, size_t);
@@ -18,17 +20,17 @@ using FieldCallback = void (*)(void *, const char *, size_t, const char *,
  * provides callbacks for parsing different parts of the HTTP message.
  */
 struct HttpParser {
-  int cs_;             /// Current state of the parser
-  size_t body_start_;  /// Start position of the HTTP message body
-  int content_len_;    /// Length of the content
-  size_t nread_;       /// Total number of bytes read so far
-  size_t mark_;        /// Mark position for some operations
-  size_t field_start_; /// Start position of the field
-  size_t field_len_;   /// Length of the field
-  size_t query_start_; /// Start position of the query string
-  int xml_sent_;       /// Flag indicating whether XML has been sent
-  int json_sent_;      /// Flag indicating whether JSON has been sent
-  void *data_;         /// Pointer to additional data
+  int cs_;              /// Current state of the parser
+  size_t body_start_;   /// Start position of the HTTP message body
+  int64_t content_len_; /// Length of the content, -1 if malformed
+  size_t nread_;        /// Total number of bytes read so far
+  size_t mark_;         /// Mark position for some operations
+  size_t field_start_;  /// Start position of the field
+  size_t field_len_;    /// Length of the field
+  size_t query_start_;  /// Start position of the query string
+  int xml_sent_;        /// Flag indicating whether XML has been sent
+  int json_sent_;       /// Flag indicating whether JSON has been sent
+  void *data_;          /// Pointer to additional data
 
   int uri_relaxed_; /// Flag indicating whether the URI is relaxed
 
@@ -69,7 +71,9 @@ struct HttpParser {
   /**
    * @brief Executes the parser on a buffer.
    *
-   * Parses the buffer and updates the parser's state accordingly.
+   * Parses the buffer and updates the parser's state accordingly. To resume
+   * an unfinished message, call it again with a buffer that still starts at
+   * the first byte of the message and pass the bytes already parsed as `off`.
    *
    * @param buffer Pointer to the buffer.
    * @param len Length of the buffer.
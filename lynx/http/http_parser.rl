@@ -292,9 +292,13 @@ int HttpParser::finish() {
 size_t HttpParser::execute(const char *buffer, size_t len, size_t off) {
   if(len == 0) return 0;
   nread_ = 0;
-  mark_ = 0;
-  field_len_ = 0;
-  field_start_ = 0;
+  /// Marks are offsets from `buffer`, keep them when resuming at `off` so a
+  /// token split across two reads is still delivered in one piece.
+  if (off == 0) {
+    mark_ = 0;
+    field_len_ = 0;
+    field_start_ = 0;
+  }
  
   const char *p, *pe;
   int cs = cs_;
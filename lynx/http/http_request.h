@@ -2,11 +2,18 @@
 #define LYNX_HTTP_HTTP_REQUEST_H
 
 #include "lynx/base/timestamp.h"
+#include "lynx/http/http_body_stream.h"
+#include "lynx/http/http_headers.h"
 #include "lynx/http/http_status.h"
 
 #include <cassert>
+#include <charconv>
 #include <map>
+#include <memory>
+#include <string>
+#include <string_view>
 #include <strings.h>
+#include <type_traits>
 
 namespace lynx {
 
@@ -28,9 +35,19 @@ HttpMethod stringToHttpMethod(const std::string &m);
 HttpMethod charsToHttpMethod(const char *m);
 const char *methodToString(const HttpMethod &m);
 
+namespace detail {
+
+std::string urlDecode(std::string_view str, bool space_as_plus = true);
+
+} // namespace detail
+
 struct CaseInsensitiveLess {
-  bool operator()(const std::string &lhs, const std::string &rhs) const {
-    return strcasecmp(lhs.c_str(), rhs.c_str()) < 0;
+  using is_transparent = void;
+
+  bool operator()(std::string_view lhs, std::string_view rhs) const {
+    int ret = strncasecmp(lhs.data(), rhs.data(),
+                          std::min(lhs.size(), rhs.size()));
+    return ret < 0 || (ret == 0 && lhs.size() < rhs.size());
   }
 };
 
@@ -43,11 +60,23 @@ struct CaseInsensitiveLess {
  * parameter fields, cookie fields, and a buffer for storing the request body.
  * It provides methods for setting and getting these attributes, as well as
  * methods for setting, getting, and deleting headers, parameters, and cookies.
+ *
+ * The uri, path, query, fragment, body and headers are views into the bytes
+ * the request was parsed from (usually the connection input buffer) and are
+ * only valid while the handler runs. Call materialize() on a copy to keep
+ * them longer.
+ *
+ * Params (query string and url-encoded form body) and cookies are decoded on
+ * first access, so a handler that never looks at them pays nothing. The
+ * typed accessors parseParam() and parseCookie() go further and scan the raw
+ * bytes for a single key without building the maps at all.
  */
 class HttpRequest {
 public:
-  /// Uses a std::map with a custom comparison method to store header
+  /// Uses a std::map with a custom comparison method to store params
   using MapType = std::map<std::string, std::string, CaseInsensitiveLess>;
+  /// Headers refer to the request bytes, so no string is built per header
+  using HeaderMap = HttpHeaders<std::string_view, 16>;
 
   HttpRequest(uint8_t version = 0x11, bool close = true);
 
@@ -63,54 +92,134 @@ public:
   uint8_t version() const { return version_; }
   void setVersion(uint8_t v) { version_ = v; }
 
-  const std::string &path() const { return path_; }
-  void setPath(const std::string &p) { path_ = p; }
+  std::string_view path() const { return path_; }
+  void setPath(std::string_view p) { path_ = p; }
 
-  const std::string &query() const { return query_; }
-  void setQuery(const std::string &q) { query_ = q; }
+  std::string_view query() const { return query_; }
+  void setQuery(std::string_view q) { query_ = q; }
 
-  const std::string &uri() const { return uri_; }
-  void setUri(const std::string &u) { uri_ = u; }
+  std::string_view uri() const { return uri_; }
+  void setUri(std::string_view u) { uri_ = u; }
 
-  void setFragment(const std::string &f) { fragment_ = f; }
+  std::string_view fragment() const { return fragment_; }
+  void setFragment(std::string_view f) { fragment_ = f; }
 
-  const std::string &body() const { return body_; }
-  void setBody(const std::string &b) { body_ = b; }
+  std::string_view body() const { return body_; }
+  void setBody(std::string_view b) { body_ = b; }
 
-  const MapType &headers() const { return headers_; }
-  void setHeaders(const MapType &h) { headers_ = h; }
+  /**
+   * @brief Returns the streamed body, or nullptr if the body was not streamed.
+   *
+   * Set for chunked bodies and for the bodies chosen by
+   * HttpServer::setBodyStreamSelector(). A streamed body that stayed whole in
+   * memory is also in body(); otherwise read it from the stream.
+   */
+  const std::shared_ptr<HttpBodyStream> &bodyStream() const {
+    return body_stream_;
+  }
+  void setBodyStream(const std::shared_ptr<HttpBodyStream> &s) {
+    body_stream_ = s;
+  }
 
-  const MapType &params() const { return params_; }
-  void setParams(const MapType &p) { params_ = p; }
+  const HeaderMap &headers() const { return headers_; }
+  void setHeaders(const HeaderMap &h) { headers_ = h; }
 
-  const MapType &cookies() const { return cookies_; }
-  void setCookies(const MapType &c) { cookies_ = c; }
+  const MapType &params() const {
+    initParams();
+    return params_;
+  }
+  void setParams(const MapType &p) {
+    params_ = p;
+    parser_param_flag_ |= K_QUERY_PARSED | K_BODY_PARSED;
+  }
 
-  std::string getHeader(const std::string &key,
-                        const std::string &def = "") const;
+  const MapType &cookies() const {
+    initCookies();
+    return cookies_;
+  }
+  void setCookies(const MapType &c) {
+    cookies_ = c;
+    parser_param_flag_ |= K_COOKIES_PARSED;
+  }
+
+  std::string_view getHeader(std::string_view key,
+                             std::string_view def = {}) const;
+  std::string_view getHeader(HttpHeader key, std::string_view def = {}) const;
   std::string getParam(const std::string &key,
                        const std::string &def = "") const;
-  std::string getCookie(const std::string &key, const std::string &def = "");
+  std::string getCookie(const std::string &key,
+                        const std::string &def = "") const;
 
-  void setHeader(const std::string &key, const std::string &val);
+  /**
+   * @brief Reads a param as a `T` without decoding the other params.
+   *
+   * Until params() is called the query string and form body are scanned for
+   * `key` in place and only its value is url-decoded, only if it has escapes.
+   *
+   * @tparam T bool, from true/false or 1/0, another arithmetic type, parsed
+   * with std::from_chars, or a type constructible from std::string_view such
+   * as std::string.
+   * @param key The param name, compared case-insensitively.
+   * @param val Receives the value.
+   * @return False if the param is absent or not a valid `T`.
+   */
+  template <typename T> bool parseParam(std::string_view key, T *val) const {
+    std::string buf;
+    std::string_view raw;
+    return findParam(key, &raw, &buf) && parseValue(raw, val);
+  }
+
+  /// Reads a cookie as a `T`, see parseParam().
+  template <typename T> bool parseCookie(std::string_view key, T *val) const {
+    std::string buf;
+    std::string_view raw;
+    return findCookie(key, &raw, &buf) && parseValue(raw, val);
+  }
+
+  void setHeader(std::string_view key, std::string_view val);
   void setParam(const std::string &key, const std::string &val);
   void setCookie(const std::string &key, const std::string &val);
 
-  void delHeader(const std::string &key);
+  void delHeader(std::string_view key);
   void delParam(const std::string &key);
   void delCookie(const std::string &key);
 
-  bool hasHeader(const std::string &key, std::string *val = nullptr);
-  bool hasParam(const std::string &key, std::string *val = nullptr);
-  bool hasCookie(const std::string &key, std::string *val = nullptr);
+  bool hasHeader(std::string_view key, std::string *val = nullptr);
+  bool hasParam(const std::string &key, std::string *val = nullptr) const;
+  bool hasCookie(const std::string &key, std::string *val = nullptr) const;
 
   std::ostream &dump(std::ostream &os) const;
 
   std::string toString() const;
 
-  void initQueryParam();
-  void initBodyParam();
-  void initCookies();
+  /// Decodes the query string and form body params if not done yet.
+  void initParams() const {
+    initQueryParam();
+    initBodyParam();
+  }
+  void initQueryParam() const;
+  void initBodyParam() const;
+  void initCookies() const;
+
+  /**
+   * @brief Copies every viewed field into storage owned by the request.
+   *
+   * After this call the request no longer refers to the connection buffer and
+   * can be kept (or copied) after the handler returns.
+   */
+  void materialize();
+
+  /**
+   * @brief Moves the views from one copy of the request bytes to another.
+   *
+   * Used by HttpContext when the input buffer is reallocated or compacted
+   * between two reads of the same request.
+   *
+   * @param from The old address of the request bytes.
+   * @param len The number of request bytes at the old address.
+   * @param to The new address of the request bytes.
+   */
+  void rebase(const char *from, size_t len, const char *to);
 
   void swap(HttpRequest &other) {
     std::swap(method_, other.method_);
@@ -118,31 +227,73 @@ public:
     std::swap(close_, other.close_);
     std::swap(websocket_, other.websocket_);
     std::swap(parser_param_flag_, other.parser_param_flag_);
-    path_.swap(other.path_);
-    query_.swap(other.query_);
-    fragment_.swap(other.fragment_);
-    body_.swap(other.body_);
-    headers_.swap(other.headers_);
+    std::swap(path_, other.path_);
+    std::swap(query_, other.query_);
+    std::swap(uri_, other.uri_);
+    std::swap(fragment_, other.fragment_);
+    std::swap(body_, other.body_);
+    std::swap(headers_, other.headers_);
     params_.swap(other.params_);
     cookies_.swap(other.cookies_);
+    storage_.swap(other.storage_);
+    body_stream_.swap(other.body_stream_);
   }
 
 private:
+  static const uint8_t K_QUERY_PARSED = 0x1;
+  static const uint8_t K_BODY_PARSED = 0x2;
+  static const uint8_t K_COOKIES_PARSED = 0x4;
+
+  bool isFormBody() const;
+  bool findParam(std::string_view key, std::string_view *val,
+                 std::string *buf) const;
+  bool findCookie(std::string_view key, std::string_view *val,
+                  std::string *buf) const;
+
+  template <typename T>
+  static bool parseValue(std::string_view str, T *val) {
+    if constexpr (std::is_same_v<T, bool>) {
+      if (str == "1" || (str.size() == 4 &&
+                         ::strncasecmp(str.data(), "true", 4) == 0)) {
+        *val = true;
+        return true;
+      }
+      if (str == "0" || (str.size() == 5 &&
+                         ::strncasecmp(str.data(), "false", 5) == 0)) {
+        *val = false;
+        return true;
+      }
+      return false;
+    } else if constexpr (std::is_arithmetic_v<T>) {
+      const char *end = str.data() + str.size();
+      auto [ptr, ec] = std::from_chars(str.data(), end, *val);
+      return ec == std::errc() && ptr == end;
+    } else {
+      *val = T(str);
+      return true;
+    }
+  }
+
   HttpMethod method_;
   uint8_t version_;
   bool close_;
   bool websocket_;
 
-  uint8_t parser_param_flag_;
-
-  std::string path_;
-  std::string query_;
-  std::string uri_;
-  std::string fragment_;
-  std::string body_;
-  MapType headers_;
-  MapType params_;
-  MapType cookies_;
+  /// Which of the params and cookies have been decoded into the maps
+  mutable uint8_t parser_param_flag_;
+
+  std::string_view path_;
+  std::string_view query_;
+  std::string_view uri_;
+  std::string_view fragment_;
+  std::string_view body_;
+  HeaderMap headers_;
+  mutable MapType params_;
+  mutable MapType cookies_;
+
+  /// Owns the viewed bytes once materialize() was called
+  std::shared_ptr<const std::string> storage_;
+  std::shared_ptr<HttpBodyStream> body_stream_;
 };
 
 } // namespace lynx
@@ -1,14 +1,19 @@
 #ifndef LYNX_HTTP_HTTP_RESPONSE_H
 #define LYNX_HTTP_HTTP_RESPONSE_H
 
+#include "lynx/base/timestamp.h"
+#include "lynx/http/http_headers.h"
 #include "lynx/http/http_status.h"
+#include "lynx/http/http_stream_writer.h"
 
-#include <map>
+#include <memory>
 #include <string>
+#include <sys/types.h>
 
 namespace lynx {
 
 class Buffer;
+class ChainBuffer;
 
 /**
  * @class HttpResponse
@@ -37,18 +42,95 @@ public:
   }
 
   bool closeConnection() const { return close_connection_; }
+  HttpStatus statusCode() const { return status_; }
 
-  void addHeader(const std::string &key, const std::string &value) {
-    headers_[key] = value;
+  /// Returns the value of a header, empty if it is not set.
+  std::string_view getHeader(std::string_view key) const {
+    const std::string *value = headers_.find(key);
+    return value ? std::string_view(*value) : std::string_view();
   }
 
-  void appendToBuffer(Buffer *output) const;
+  /**
+   * @brief Streams the body with chunked encoding instead of sending body_.
+   *
+   * A body set with setBody() is sent as the first chunk. See
+   * HttpStreamWriter for when `cb` is called.
+   *
+   * @param cb Writes the body through the writer it is given.
+   */
+  void setStreamCallback(const HttpStreamWriter::StreamCallback &cb) {
+    stream_callback_ = cb;
+  }
+  /// Sets how a streamed body is framed, the server picks it for the request.
+  void setStreamFraming(HttpStreamWriter::Framing framing) {
+    stream_framing_ = framing;
+  }
+  HttpStreamWriter::Framing streamFraming() const { return stream_framing_; }
+  /**
+   * @brief Sends a file region as the body, with sendfile(2) (see
+   * TcpConnection::sendFile()), instead of body_.
+   *
+   * @param fd The file descriptor.
+   * @param offset The offset of the region in the file.
+   * @param length The length of the region, sent as Content-Length.
+   * @param owner Kept alive until the region is sent, e.g. the owner of `fd`.
+   */
+  void setFileBody(int fd, off_t offset, size_t length,
+                   std::shared_ptr<const void> owner) {
+    file_ = FileBody{fd, offset, length, std::move(owner)};
+  }
+  bool hasFileBody() const { return file_.fd_ >= 0; }
+
+  /// A file region sent as the body
+  struct FileBody {
+    int fd_ = -1;
+    off_t offset_ = 0;
+    size_t length_ = 0;
+    std::shared_ptr<const void> owner_;
+  };
+  const FileBody &fileBody() const { return file_; }
+
+  bool isStreaming() const { return static_cast<bool>(stream_callback_); }
+  const HttpStreamWriter::StreamCallback &streamCallback() const {
+    return stream_callback_;
+  }
+
+  /**
+   * @brief Adds a header, replacing an existing one of the same name.
+   *
+   * Headers with an invalid name or a value containing CR/LF are dropped so
+   * that a value taken from the request cannot inject a header or a response.
+   */
+  void addHeader(const std::string &key, const std::string &value);
+
+  /**
+   * @brief Serializes the response at the end of a buffer.
+   *
+   * The status line is precomputed, the Date header is formatted at most once
+   * per second per thread, and the buffer grows at most once, so this is a
+   * handful of memcpy calls.
+   *
+   * @param output The buffer to append to, usually the connection output
+   * buffer.
+   * @param now The current time, e.g. the receive time of the request.
+   */
+  void appendToBuffer(Buffer *output, Timestamp now) const;
+  void appendToBuffer(Buffer *output) const {
+    appendToBuffer(output, Timestamp::now());
+  }
+  void appendToBuffer(ChainBuffer *output, Timestamp now) const;
 
 private:
-  std::map<std::string, std::string> headers_;
+  template <typename Output>
+  void serialize(Output *output, Timestamp now) const;
+
+  HttpHeaders<std::string, 8> headers_;
   HttpStatus status_{};
   bool close_connection_;
   std::string body_;
+  HttpStreamWriter::StreamCallback stream_callback_;
+  HttpStreamWriter::Framing stream_framing_ = HttpStreamWriter::CHUNKED;
+  FileBody file_;
 };
 
 } // namespace lynx
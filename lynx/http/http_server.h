@@ -2,6 +2,7 @@
 #define LYNX_HTTP_HTTP_SERVER_H
 
 #include "lynx/base/noncopyable.h"
+#include "lynx/http/http_context.h"
 #include "lynx/net/event_loop.h"
 #include "lynx/net/inet_address.h"
 #include "lynx/net/tcp_server.h"
@@ -21,6 +22,9 @@ class HttpResponse;
  */
 class HttpServer : Noncopyable {
 public:
+  /// The default of setStreamHighWaterMark()
+  static const size_t K_STREAM_HIGH_WATER_MARK = 1024 * 1024;
+
   using HttpCallback = std::function<void(const HttpRequest &, HttpResponse *)>;
 
   /**
@@ -39,7 +43,56 @@ public:
   EventLoop *getLoop() const { return server_.getLoop(); }
 
   void setHttpCallback(const HttpCallback &cb) { http_callback_ = cb; }
+
+  /**
+   * @brief Sets how many bytes may wait in a connection output buffer before
+   * a streamed response (see HttpStreamWriter) is paused.
+   *
+   * Applies to connections accepted afterwards.
+   */
+  void setStreamHighWaterMark(size_t bytes) { stream_high_water_mark_ = bytes; }
+
+  /**
+   * @brief Selects the requests whose body is streamed instead of buffered.
+   *
+   * The selector runs once the header is parsed and may set a chunk callback
+   * on the HttpBodyStream to consume the body as it arrives; otherwise the
+   * body is stored and spills to a temporary file above the spill threshold,
+   * written from the loop thread. Bodies that are not selected, chunked ones
+   * included, stay in memory and are in HttpRequest::body(). The HTTP
+   * callback runs once the whole body has been received. Applies to
+   * connections accepted afterwards.
+   */
+  void setBodyStreamSelector(const HttpContext::BodyStreamSelector &selector) {
+    body_stream_selector_ = selector;
+  }
+  /// Sets the body size above which a selected body spills to disk.
+  void setSpillThreshold(size_t bytes) { spill_threshold_ = bytes; }
+  /// Sets the longest body held in memory, longer ones get 413 Payload Too
+  /// Large; see HttpContext::setMaxBodySize(). Selected bodies have their
+  /// own limit, see HttpBodyStream::setMaxSize(). Applies to new
+  /// connections.
+  void setMaxBodySize(size_t bytes) { max_body_size_ = bytes; }
+  /// Sets the most header fields a request may have, see
+  /// HttpContext::setMaxHeaders(). Applies to new connections.
+  void setMaxHeaders(size_t count) { max_headers_ = count; }
+  /// Sets the longest request header, see HttpContext::setMaxHeaderSize().
+  /// Applies to new connections.
+  void setMaxHeaderSize(size_t bytes) { max_header_size_ = bytes; }
   void setThreadNum(int numThreads) { server_.setThreadNum(numThreads); }
+  /// See TcpServer::setCpuAffinity(), to be called before start().
+  void setCpuAffinity(const CpuAffinity &affinity) {
+    server_.setCpuAffinity(affinity);
+  }
+  /// See TcpServer::setEdgeTriggered(), to be called before start().
+  void setEdgeTriggered(bool on) { server_.setEdgeTriggered(on); }
+  /// See TcpServer::setPlacementPolicy().
+  void setPlacementPolicy(EventLoopThreadPool::PlacementPolicy policy) {
+    server_.setPlacementPolicy(std::move(policy));
+  }
+
+  /// See TcpServer::setIdleTimeout(), e.g. for keep-alive connections.
+  void setIdleTimeout(double seconds) { server_.setIdleTimeout(seconds); }
 
   void start();
 
@@ -51,11 +104,37 @@ private:
   void onMessage(const TcpConnectionPtr &conn, Buffer *buf,
                  Timestamp receiveTime);
 
-  /// Called when an HTTP request is received on a TCP connection
-  void onRequest(const TcpConnectionPtr &conn, const HttpRequest &req);
+  /// Called when the output buffer of a connection has been drained
+  void onWriteComplete(const TcpConnectionPtr &conn);
+
+  /// Called when the output buffer of a connection reaches the high water mark
+  void onHighWaterMark(const TcpConnectionPtr &conn, size_t len);
+
+  /**
+   * @brief Called when an HTTP request is received on a TCP connection.
+   *
+   * The response is serialized into the connection output buffer. A streamed
+   * response is attached to the connection context.
+   *
+   * @param conn The connection the request was read from.
+   * @param req The parsed request.
+   * @param receiveTime When the request was read, used for the Date header.
+   * @return True if the connection should be closed after the response.
+   */
+  bool onRequest(const TcpConnectionPtr &conn, const HttpRequest &req,
+                 Timestamp receiveTime);
+
+  /// Called in the loop thread when the streamed response of `conn` ends
+  void onStreamEnd(const std::weak_ptr<TcpConnection> &weak_conn, bool close);
 
   TcpServer server_;
   HttpCallback http_callback_;
+  size_t stream_high_water_mark_;
+  HttpContext::BodyStreamSelector body_stream_selector_;
+  size_t spill_threshold_;
+  size_t max_body_size_;
+  size_t max_headers_;
+  size_t max_header_size_;
 };
 
 } // namespace lynx
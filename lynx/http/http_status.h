@@ -1,6 +1,8 @@
 #ifndef LYNX_HTTP_HTTP_STATUS_H
 #define LYNX_HTTP_HTTP_STATUS_H
 
+#include <string_view>
+
 namespace lynx {
 
 #define HTTP_STATUS_MAP(XX)                                                    \
@@ -72,6 +74,10 @@ enum class HttpStatus {
 
 const char *statusToString(const HttpStatus &s);
 
+/// Returns the precomputed "HTTP/1.1 <code> <reason>\r\n" line of a status,
+/// or an empty view for a status not in HTTP_STATUS_MAP.
+std::string_view statusLine(const HttpStatus &s);
+
 } // namespace lynx
 
 #endif
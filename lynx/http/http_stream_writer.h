@@ -0,0 +1,121 @@
+#ifndef LYNX_HTTP_HTTP_STREAM_WRITER_H
+#define LYNX_HTTP_HTTP_STREAM_WRITER_H
+
+#include "lynx/base/noncopyable.h"
+#include "lynx/net/buffer.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string_view>
+
+namespace lynx {
+
+class ChainBuffer;
+class HttpStreamWriter;
+class TcpConnection;
+
+using HttpStreamWriterPtr = std::shared_ptr<HttpStreamWriter>;
+
+/**
+ * @class HttpStreamWriter
+ * @brief Writes the body of a response as it is produced, with
+ * "Transfer-Encoding: chunked", or for an HTTP/1.0 client as raw bytes ended
+ * by closing the connection.
+ *
+ * A handler opts in with HttpResponse::setStreamCallback(). Once the response
+ * header is sent, the server calls the stream callback in the loop thread,
+ * and again every time the connection output buffer has drained, until end()
+ * is called. The callback writes while writable() and returns; when the output
+ * buffer reaches the connection high water mark the writer pauses and the
+ * callback is not called before the buffer is empty, so a slow client never
+ * makes the server buffer the whole body.
+ *
+ * write(), end() and writable() may also be called from other threads (keep
+ * the writer alive with its shared pointer). There writable() also counts
+ * what was written but not yet handed to the loop, and a producer that finds
+ * it false writes again once the stream callback runs. Later pipelined
+ * requests on the connection wait for end(). The loop is the one the
+ * connection is in at the time of each call, so the writer follows a
+ * connection that migrates.
+ */
+class HttpStreamWriter : Noncopyable,
+                         public std::enable_shared_from_this<HttpStreamWriter> {
+public:
+  using StreamCallback = std::function<void(const HttpStreamWriterPtr &)>;
+  using EndCallback = std::function<void()>;
+
+  /// How the body is framed on the wire
+  enum Framing {
+    CHUNKED,         ///< "Transfer-Encoding: chunked", from HTTP/1.1
+    CLOSE_DELIMITED, ///< Raw bytes ended by closing the connection, HTTP/1.0
+    NO_BODY,         ///< Nothing is written, the response to a HEAD request
+  };
+
+  HttpStreamWriter(const std::shared_ptr<TcpConnection> &conn,
+                   StreamCallback cb, Framing framing = CHUNKED);
+
+  /// Sends `data` as one chunk, an empty `data` is ignored.
+  void write(std::string_view data);
+
+  /// Sends the last chunk, after which nothing more is written.
+  void end();
+
+  /// Checks if more data can be written without exceeding the high water mark.
+  bool writable() const;
+
+  Framing framing() const { return framing_; }
+
+  /// Checks if the stream is over, by end() or because the peer went away.
+  bool ended() const { return ended_; }
+
+  /// The members below are used by HttpServer.
+
+  /// Sets the callback run in the loop thread after the last chunk.
+  void setEndCallback(EndCallback cb) { end_callback_ = std::move(cb); }
+
+  /// Stops calling the stream callback, the output buffer is full.
+  void pause() { paused_ = true; }
+
+  /// Calls the stream callback if the stream is not over and not full.
+  void resume();
+
+  /// Ends the stream without writing, the connection is gone.
+  void abort();
+
+  /// Appends `data` to `output` framed as a chunk.
+  static void appendChunk(Buffer *output, std::string_view data);
+  static void appendChunk(ChainBuffer *output, std::string_view data);
+
+private:
+  /// Appends `data` to `output` framed as the stream is.
+  template <typename Output> void append(Output *output, std::string_view data);
+
+  /// Queues what another thread wrote for the loop of `conn`.
+  void post(const std::shared_ptr<TcpConnection> &conn, std::string_view data,
+            bool last);
+  /// Writes what other threads queued, in the loop of the connection.
+  void drain();
+  void writeInLoop(std::string_view data);
+  /// Sends the output buffer of `conn`, pausing if it stays over the mark.
+  void flush(const std::shared_ptr<TcpConnection> &conn);
+  void endInLoop();
+
+  std::weak_ptr<TcpConnection> conn_;
+  StreamCallback stream_callback_;
+  EndCallback end_callback_;
+  const Framing framing_;
+  std::atomic<bool> ended_;
+  std::atomic<bool> paused_;
+
+  /// Written by other threads and not yet in the connection, in order
+  mutable std::mutex mutex_;
+  Buffer pending_;
+  bool pending_end_;
+  bool drain_queued_;
+};
+
+} // namespace lynx
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef LYNX_HTTP_STATIC_FILE_HANDLER_H
+#define LYNX_HTTP_STATIC_FILE_HANDLER_H
+
+#include "lynx/base/noncopyable.h"
+#include "lynx/base/mono_time.h"
+
+#include <atomic>
+#include <ctime>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <sys/stat.h>
+#include <unordered_map>
+
+namespace lynx {
+
+class HttpRequest;
+class HttpResponse;
+
+/**
+ * @class StaticFileHandler
+ * @brief Serves the files under a directory.
+ *
+ * Bodies are sent with sendfile(2), never read into user space. Open file
+ * descriptors and their stat results are kept in an LRU cache and checked
+ * against the file system at most once per second, so a hot asset costs no
+ * system call besides the send. Responses carry ETag and Last-Modified, a
+ * matching If-None-Match or If-Modified-Since gets 304 Not Modified, and a
+ * single "Range: bytes=..." gets 206 Partial Content.
+ *
+ * It is an HttpServer::HttpCallback and may be called from several loops at
+ * once.
+ */
+class StaticFileHandler : Noncopyable {
+public:
+  /**
+   * @brief Constructs a handler.
+   *
+   * @param root The directory the files are served from.
+   * @param prefix The URL path prefix removed before looking up a file, e.g.
+   * "/static" serves "/static/app.js" from "<root>/app.js".
+   * @param cacheCapacity The maximum number of cached open files.
+   */
+  explicit StaticFileHandler(const std::string &root,
+                             const std::string &prefix = "",
+                             size_t cacheCapacity = 1024);
+
+  void operator()(const HttpRequest &req, HttpResponse *resp);
+
+  /// An open file and what the responses need to know about it
+  struct File : Noncopyable {
+    File(int fd, const struct stat &st, const std::string &path,
+         MonoTime checked);
+    ~File();
+
+    int fd_;
+    off_t size_;
+    time_t mtime_;
+    ino_t ino_;
+    std::string etag_;
+    std::string last_modified_;
+    const char *content_type_;
+    /// When the stat result was last checked, in MonoTime microseconds
+    mutable std::atomic<int64_t> checked_;
+  };
+  using FilePtr = std::shared_ptr<const File>;
+
+private:
+  /// Returns the file at `path`, from the cache if it is still current
+  FilePtr open(const std::string &path, MonoTime now);
+
+  /// Maps the URL path to a file path, empty if it escapes the root
+  std::string resolve(std::string_view path) const;
+
+  using LruList = std::list<std::pair<std::string, FilePtr>>;
+
+  const std::string root_;
+  const std::string prefix_;
+  const size_t capacity_;
+
+  std::mutex mutex_;
+  LruList lru_; /// Most recently used first
+  std::unordered_map<std::string, LruList::iterator> index_;
+};
+
+} // namespace lynx
+
+#endif
@@ -50,6 +50,11 @@ public:
    */
   void append(const char *logline, size_t len);
 
+  /// Pins the background thread to `affinity`, to be called before start().
+  void setCpuAffinity(const CpuAffinity &affinity) {
+    thread_.setCpuAffinity(affinity);
+  }
+
   /**
    * @brief Starts the background thread if it's not already running.
    */
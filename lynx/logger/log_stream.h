@@ -5,6 +5,7 @@
 
 #include <cstring>
 #include <string>
+#include <string_view>
 
 namespace lynx {
 
@@ -111,6 +112,7 @@ public:
   LogStream &operator<<(const char *);
   LogStream &operator<<(const unsigned char *);
   LogStream &operator<<(const std::string &);
+  LogStream &operator<<(std::string_view);
   LogStream &operator<<(const Buffer &);
 
   /**
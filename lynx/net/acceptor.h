@@ -36,6 +36,18 @@ public:
 
   bool listening() const { return listening_; }
 
+  /**
+   * @brief Accepts edge-triggered, to be set before listen().
+   *
+   * Each readiness edge then accepts until the backlog is drained, at most
+   * K_ACCEPT_BUDGET connections before the other channels of the loop get
+   * their turn.
+   */
+  void setEdgeTriggered(bool on) { accept_channel_.setEdgeTriggered(on); }
+
+  /// The connections accepted per edge-triggered event
+  static const int K_ACCEPT_BUDGET = 64;
+
   void setNewConnectionCallback(const NewConnectionCallback &cb) {
     new_connection_callback_ = cb;
   }
@@ -43,6 +55,8 @@ public:
 private:
   /// Handles incoming connections.
   void handleRead();
+  /// Accepts one connection, returns false once the backlog is empty.
+  bool acceptOne();
 
   EventLoop *loop_;
   Socket accept_socket_;
@@ -1,6 +1,8 @@
 #ifndef LYNX_NET_BUFFER_H
 #define LYNX_NET_BUFFER_H
 
+#include "lynx/net/byte_scan.h"
+
 #include <algorithm>
 #include <cassert>
 #include <cstring>
@@ -66,10 +68,7 @@ public:
    *
    * @return A pointer to the CRLF if found, otherwise nullptr.
    */
-  const char *findCRLF() const {
-    const char *crlf = std::search(peek(), beginWrite(), K_CRLF, K_CRLF + 2);
-    return crlf == beginWrite() ? nullptr : crlf;
-  }
+  const char *findCRLF() const { return findCRLF(peek()); }
 
   /**
    * @brief Finds the first occurrence of CRLF starting from a given position.
@@ -81,7 +80,22 @@ public:
   const char *findCRLF(const char *start) const {
     assert(peek() <= start);
     assert(start <= beginWrite());
-    const char *crlf = std::search(start, beginWrite(), K_CRLF, K_CRLF + 2);
+    const char *crlf = lynx::findCRLF(start, beginWrite());
+    return crlf == beginWrite() ? nullptr : crlf;
+  }
+
+  /**
+   * @brief Finds the first occurrence of CRLFCRLF starting from a given
+   * position, i.e. the end of an HTTP header block.
+   *
+   * @param start The starting position.
+   *
+   * @return A pointer to the CRLFCRLF if found, otherwise nullptr.
+   */
+  const char *findCRLFCRLF(const char *start) const {
+    assert(peek() <= start);
+    assert(start <= beginWrite());
+    const char *crlf = lynx::findCRLFCRLF(start, beginWrite());
     return crlf == beginWrite() ? nullptr : crlf;
   }
 
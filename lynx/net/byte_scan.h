@@ -0,0 +1,58 @@
+#ifndef LYNX_NET_BYTE_SCAN_H
+#define LYNX_NET_BYTE_SCAN_H
+
+#include <cstdint>
+
+namespace lynx {
+
+/**
+ * @class ByteSet
+ * @brief A set of ASCII bytes laid out for a vectorized membership test.
+ *
+ * Bit `h` of `rows_[l]` is set if the byte `h << 4 | l` is in the set, so a
+ * 16-byte block is classified with two table shuffles (one per nibble) instead
+ * of one lookup per byte. Bytes >= 0x80 are never members.
+ */
+class ByteSet {
+public:
+  /// Builds the set of ASCII bytes `c` for which `pred(c)` is true.
+  template <typename Pred> constexpr explicit ByteSet(Pred pred) : rows_() {
+    for (int c = 0; c < 0x80; ++c) {
+      if (pred(static_cast<char>(c))) {
+        rows_[c & 0x0F] |= static_cast<uint8_t>(1 << (c >> 4));
+      }
+    }
+  }
+
+  constexpr bool contains(char c) const {
+    auto u = static_cast<uint8_t>(c);
+    return u < 0x80 && (rows_[u & 0x0F] >> (u >> 4) & 1);
+  }
+
+  const uint8_t *rows() const { return rows_; }
+
+private:
+  uint8_t rows_[16];
+};
+
+/**
+ * The kernels below scan [begin, end) with AVX2 or SSE2/SSSE3 when the build
+ * targets them (the build uses -march=native) and fall back to a byte loop
+ * otherwise. Each returns `end` when nothing is found.
+ */
+
+/// Finds the first "\r\n".
+const char *findCRLF(const char *begin, const char *end);
+
+/// Finds the first "\r\n\r\n", the end of an HTTP header block.
+const char *findCRLFCRLF(const char *begin, const char *end);
+
+/// Finds the first byte equal to `a` or `b`.
+const char *findEither(const char *begin, const char *end, char a, char b);
+
+/// Finds the first byte that is not in `set`.
+const char *findNotIn(const char *begin, const char *end, const ByteSet &set);
+
+} // namespace lynx
+
+#endif
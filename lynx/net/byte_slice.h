@@ -0,0 +1,64 @@
+#ifndef LYNX_NET_BYTE_SLICE_H
+#define LYNX_NET_BYTE_SLICE_H
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace lynx {
+
+/**
+ * @class ByteSlice
+ * @brief A refcounted, immutable run of bytes.
+ *
+ * Copying a slice copies a pointer and bumps a reference count, never the
+ * bytes, so one payload can be handed to many connections (e.g. a broadcast)
+ * and queued behind their output without a copy per connection. The bytes
+ * live as long as the last slice referring to them.
+ */
+class ByteSlice {
+public:
+  ByteSlice() : data_(nullptr), size_(0) {}
+
+  /// Takes over `str` without copying its bytes.
+  explicit ByteSlice(std::string str) {
+    auto owner = std::make_shared<const std::string>(std::move(str));
+    data_ = owner->data();
+    size_ = owner->size();
+    owner_ = std::move(owner);
+  }
+
+  /**
+   * @brief Refers to bytes kept alive by `owner`.
+   *
+   * @param data The bytes, they must not change while `owner` lives.
+   * @param size The number of bytes.
+   * @param owner Owns the bytes, e.g. a std::shared_ptr<const Buffer>.
+   */
+  ByteSlice(const char *data, size_t size, std::shared_ptr<const void> owner)
+      : data_(data), size_(size), owner_(std::move(owner)) {}
+
+  const char *data() const { return data_; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  const std::shared_ptr<const void> &owner() const { return owner_; }
+  std::string_view view() const { return {data_, size_}; }
+
+  /// Returns the slice of `len` bytes at `pos`, sharing the same owner.
+  ByteSlice slice(size_t pos, size_t len = std::string_view::npos) const {
+    assert(pos <= size_);
+    len = std::min(len, size_ - pos);
+    return {data_ + pos, len, owner_};
+  }
+
+private:
+  const char *data_;
+  size_t size_;
+  std::shared_ptr<const void> owner_;
+};
+
+} // namespace lynx
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef LYNX_NET_CHAIN_BUFFER_H
+#define LYNX_NET_CHAIN_BUFFER_H
+
+#include "lynx/base/noncopyable.h"
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+
+namespace lynx {
+
+/**
+ * @class ChainBuffer
+ * @brief An output buffer made of a chain of segments.
+ *
+ * A segment is either a fixed-size slab the buffer owns or a slice of memory
+ * owned by someone else, kept alive by a shared owner until it is sent.
+ * Appending never moves bytes already in the buffer: a full slab is followed
+ * by a new one, so a large response costs no reallocation and no copy of what
+ * was appended before it. writeFd() sends many segments with one writev(2)
+ * and retrieving only touches the segments that are partially sent.
+ *
+ * The write side mirrors Buffer (append(), ensureWritableBytes(),
+ * beginWrite(), hasWritten()) so serializers can target either. There is no
+ * peek(), the readable bytes are not contiguous.
+ */
+class ChainBuffer : Noncopyable {
+public:
+  static const size_t K_SLAB_SIZE = 16 * 1024;
+  /// Slices shorter than this are copied, an iovec per tiny slice costs more
+  static const size_t K_MIN_SLICE = 512;
+  /// The segments gathered by one writev(2)
+  static const int K_MAX_IOVECS = 64;
+
+  ChainBuffer() = default;
+
+  size_t readableBytes() const { return readable_; }
+  size_t segmentCount() const { return segments_.size(); }
+
+  /// Returns the writable bytes contiguous at the end of the last slab.
+  size_t writableBytes() const;
+
+  void append(const char *data, size_t len);
+  void append(const void *data, size_t len) {
+    append(static_cast<const char *>(data), len);
+  }
+  void append(std::string_view str) { append(str.data(), str.size()); }
+
+  /**
+   * @brief Appends memory owned by someone else without copying it.
+   *
+   * @param data The slice, it must not change until it is sent.
+   * @param len The length of the slice.
+   * @param owner Kept alive until the slice is sent or retrieved.
+   */
+  void appendSlice(const char *data, size_t len,
+                   std::shared_ptr<const void> owner);
+
+  /**
+   * @brief Ensures `len` contiguous writable bytes at beginWrite(), starting a
+   * new slab if the last one is too full.
+   */
+  void ensureWritableBytes(size_t len);
+  char *beginWrite();
+  void hasWritten(size_t len);
+
+  /// Consumes `len` bytes, dropping the segments they empty.
+  void retrieve(size_t len);
+  void retrieveAll();
+  std::string retrieveAllAsString();
+  std::string toString() const;
+
+  /**
+   * @brief Writes up to `maxBytes` readable bytes to `fd` with writev(2) and
+   * retrieves what was written.
+   *
+   * @return The number of bytes written, less than `maxBytes` if `fd` would
+   * block or failed, or -1 if nothing was written. `*savedErrno` is set on
+   * failure.
+   */
+  ssize_t writeFd(int fd, size_t maxBytes, int *savedErrno);
+
+private:
+  struct Segment {
+    const char *data_;
+    size_t begin_;    /// First readable byte
+    size_t end_;      /// Past the last readable byte
+    size_t capacity_; /// Writable up to here, equal to end_ for a slice
+    std::unique_ptr<char[]> slab_;
+    std::shared_ptr<const void> owner_;
+
+    size_t readable() const { return end_ - begin_; }
+  };
+
+  void addSlab(size_t capacity);
+  void popFront();
+
+  std::deque<Segment> segments_;
+  std::unique_ptr<char[]> spare_; /// A drained slab kept for the next one
+  size_t readable_ = 0;
+};
+
+} // namespace lynx
+
+#endif
@@ -4,8 +4,12 @@
 #include "lynx/base/noncopyable.h"
 #include "lynx/base/timestamp.h"
 
+#include <cassert>
 #include <functional>
 #include <memory>
+#include <string>
+#include <sys/types.h>
+#include <vector>
 
 namespace lynx {
 
@@ -33,6 +37,12 @@ class Channel : Noncopyable {
 public:
   using EventCallback = std::function<void()>;
   using ReadEventCallback = std::function<void(Timestamp)>;
+  /// Bytes a poller received for the channel: `n` bytes, 0 at the end of the
+  /// stream or -errno on failure
+  using ReceiveCallback =
+      std::function<void(const char *data, ssize_t n, Timestamp)>;
+  /// Gets the bytes the poller had read for a detached channel, see detach()
+  using DetachCallback = std::function<void(std::string received)>;
 
   /**
    * @brief Constructs a Channel with the given EventLoop and file descriptor.
@@ -54,6 +64,25 @@ public:
   void setCloseCallback(EventCallback cb) { close_callback_ = std::move(cb); }
   void setErrorCallback(EventCallback cb) { error_callback_ = std::move(cb); }
 
+  /**
+   * @brief Lets a poller that reads sockets itself (UringPoller) receive for
+   * this channel.
+   *
+   * While reading is enabled such a poller reads the fd as bytes arrive and
+   * hands them to `cb` instead of reporting the fd readable. Other pollers
+   * ignore it and the read callback is called as usual.
+   */
+  void setReceiveCallback(ReceiveCallback cb) {
+    receive_callback_ = std::move(cb);
+  }
+  bool receives() const { return static_cast<bool>(receive_callback_); }
+
+  /// Queues bytes received by the poller for the next handleEvent(), they
+  /// must stay valid until then.
+  void addReceived(const char *data, ssize_t n) {
+    received_.push_back({data, n});
+  }
+
   /**
    * @brief Ties this Channel to a shared object to prevent the object from
    * being destructed.
@@ -87,6 +116,25 @@ public:
     events_ = K_NONE_EVENT;
     update();
   }
+  /**
+   * @brief Registers the channel edge-triggered (EPOLLET), to be set before
+   * the channel is first enabled.
+   *
+   * The poller then reports the fd only when it becomes ready, not for as
+   * long as it is ready, so the callbacks must read or write until EAGAIN or
+   * call rearm().
+   */
+  void setEdgeTriggered(bool on) { edge_triggered_ = on; }
+  bool edgeTriggered() const { return edge_triggered_; }
+
+  /// Has an edge-triggered channel reported again if it is still ready, for
+  /// a callback that stops before EAGAIN.
+  void rearm() {
+    if (!isNoneEvent()) {
+      update();
+    }
+  }
+
   bool isWriting() const { return (events_ & K_WRITE_EVENT) != 0; }
   bool isReading() const { return (events_ & K_READ_EVENT) != 0; }
 
@@ -102,6 +150,22 @@ public:
   /// Removes this channel from the EventLoop.
   void remove();
 
+  /**
+   * @brief Removes this channel from the EventLoop, to hand it to another.
+   *
+   * `cb` runs in this loop once the poller is done with the fd, with what it
+   * had received for it and not handed over (see UringPoller); nothing else
+   * may watch the fd before. The channel may then be moved with
+   * setOwnerLoop().
+   */
+  void detach(DetachCallback cb);
+
+  /// Moves a channel that is in no loop to `loop`, see detach().
+  void setOwnerLoop(EventLoop *loop) {
+    assert(!added_to_loop_);
+    loop_ = loop;
+  }
+
 private:
   static std::string eventsToString(int fd, int ev);
 
@@ -119,12 +183,20 @@ private:
   int revents_;     // Events that are returned after poll
   int index_;       // Used by Epoller
   bool log_hup_;    // Flag to control logging of HUP event
+  bool edge_triggered_;
 
   std::weak_ptr<void> tie_; // Weak pointer to tie the channel to an object
   bool tied_;
   bool event_handling_;
   bool added_to_loop_;
+  struct Received {
+    const char *data_;
+    ssize_t n_;
+  };
+
   ReadEventCallback read_callback_;
+  ReceiveCallback receive_callback_;
+  std::vector<Received> received_;
   EventCallback write_callback_;
   EventCallback close_callback_;
   EventCallback error_callback_;
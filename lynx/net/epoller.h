@@ -1,15 +1,12 @@
 #ifndef LYNX_NET_EPOLLER_H
 #define LYNX_NET_EPOLLER_H
 
-#include "lynx/net/event_loop.h"
+#include "lynx/net/poller.h"
 
-#include <map>
 #include <sys/epoll.h>
 
 namespace lynx {
 
-class Channel;
-
 /**
  * @class Epoller
  * @brief A wrapper around the epoll system call for multiplexing IO events.
@@ -18,17 +15,15 @@ class Channel;
  * using the epoll API. It monitors multiple file descriptors to see if I/O
  * operations can be performed on any of them.
  */
-class Epoller : Noncopyable {
+class Epoller : public Poller {
 public:
-  using ChannelList = std::vector<Channel *>;
-
   /**
    * @brief Constructs an Epoller associated with the given EventLoop.
    *
    * @param loop The EventLoop that manages this Epoller.
    */
-  Epoller(EventLoop *loop);
-  ~Epoller();
+  explicit Epoller(EventLoop *loop);
+  ~Epoller() override;
 
   /**
    * @brief Polls the epoll file descriptor for events.
@@ -38,24 +33,15 @@ public:
    *
    * @return The current time when polling returns.
    */
-  Timestamp poll(int timeoutMs, ChannelList *activeChannels);
+  MonoTime poll(int timeoutMs, ChannelList *activeChannels) override;
 
   /// Updates or adds a channel to the epoll interest list.
-  void updateChannel(Channel *channel);
+  void updateChannel(Channel *channel) override;
 
   /// Removes a channel from the epoll interest list.
-  void removeChannel(Channel *channel);
-
-  /**
-   * @brief Checks if a channel is in the epoll interest list.
-   *
-   * @param channel The channel to check.
-   *
-   * @return True if the channel is in the list, otherwise false.
-   */
-  bool hasChannel(Channel *channel) const;
+  void removeChannel(Channel *channel) override;
 
-  void assertInLoopThread() const { owner_loop_->assertInLoopThread(); }
+  const char *name() const override { return "epoll"; }
 
 private:
   static const int K_INIT_EVENT_LIST_SIZE = 16;
@@ -78,13 +64,10 @@ private:
    */
   void update(int operation, Channel *channel);
 
-  using ChannelMap = std::map<int, Channel *>;
   using EventList = std::vector<struct epoll_event>;
 
-  EventLoop *owner_loop_;
   int epollfd_;
   EventList events_;
-  ChannelMap channels_;
 };
 
 } // namespace lynx
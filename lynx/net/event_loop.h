@@ -2,18 +2,24 @@
 #define LYNX_NET_EVENT_LOOP_H
 
 #include "lynx/base/current_thread.h"
+#include "lynx/base/mono_time.h"
+#include "lynx/base/mpsc_queue.h"
 #include "lynx/base/noncopyable.h"
+#include "lynx/base/task.h"
 #include "lynx/base/timestamp.h"
+#include "lynx/net/channel.h"
 #include "lynx/timer/timer_id.h"
 
 #include <atomic>
+#include <functional>
 #include <memory>
+#include <vector>
 
 namespace lynx {
 
-class Channel;
-class Epoller;
+class Poller;
 class TimerQueue;
+class TimingWheel;
 
 /**
  * @class EventLoop
@@ -25,7 +31,7 @@ class TimerQueue;
  */
 class EventLoop : Noncopyable {
 public:
-  using Functor = std::function<void()>;
+  using Functor = Task;
 
   EventLoop();
   ~EventLoop();
@@ -47,10 +53,21 @@ public:
   /**
    * @brief Gets the time when poll() returned.
    *
+   * Derived from loopNow() rather than read, it follows a change of the wall
+   * clock within K_BUSY_WINDOW_US.
+   *
    * @return The timestamp of the last poll() return.
    */
   Timestamp pollReturnTime() const { return poll_return_time_; }
 
+  /**
+   * @brief Gets the monotonic time poll() last returned at.
+   *
+   * Read once per iteration, so hot paths in the loop thread get a current
+   * enough time for free; it lags by however long the iteration has run.
+   */
+  MonoTime loopNow() const { return loop_now_; }
+
   /**
    * @brief Runs a callback immediately in the event loop.
    *
@@ -61,6 +78,10 @@ public:
   /**
    * @brief Queues a callback to be run in the event loop.
    *
+   * Lock-free. The loop is woken through its eventfd only by the first
+   * callback queued after it went to sleep; callbacks queued while it is
+   * awake, or from its own thread, cost no system call.
+   *
    * @param cb The callback to queue.
    */
   void queueInLoop(Functor cb);
@@ -72,9 +93,36 @@ public:
    */
   size_t queueSize() const;
 
+  /**
+   * @name Load counters
+   * Cheap, relaxed counters that may be read from any thread, e.g. by the
+   * placement policies of EventLoopThreadPool. They are approximate.
+   */
+  ///@{
+  /// The TcpConnections that live on this loop.
+  int connectionCount() const {
+    return connection_count_.load(std::memory_order_relaxed);
+  }
+  void addConnectionCount(int delta) {
+    connection_count_.fetch_add(delta, std::memory_order_relaxed);
+  }
+
+  /// The share, from 0 to 1, of the last K_BUSY_WINDOW_US the loop spent
+  /// handling events, timers and functors rather than waiting in poll().
+  /// Updated when the loop wakes up.
+  double busyRatio() const {
+    return busy_ratio_.load(std::memory_order_relaxed);
+  }
+  static const int64_t K_BUSY_WINDOW_US = 1000 * 1000;
+  ///@}
+
   /**
    * @brief Runs a callback at a specific time.
    *
+   * Timers run on the monotonic clock: the wall clock time is turned into
+   * a delay when the timer is added, and later changes of the wall clock do
+   * not move it.
+   *
    * @param time The time to run the callback.
    * @param cb The callback to run.
    *
@@ -82,6 +130,9 @@ public:
    */
   TimerId runAt(Timestamp time, TimerCallback cb);
 
+  /// Runs a callback at a time on the monotonic clock, e.g. a deadline.
+  TimerId runAt(MonoTime time, TimerCallback cb);
+
   /**
    * @brief Runs a callback after a delay.
    *
@@ -109,6 +160,15 @@ public:
    */
   void cancel(TimerId timerId);
 
+  /**
+   * @brief Returns the loop's timing wheel, created on first use.
+   *
+   * For the timeouts of many objects that keep pushing them back, such as
+   * idle connections, cheaper than one timer each. Ticks once a second, to
+   * be used in the loop thread.
+   */
+  TimingWheel *timingWheel();
+
   /// Wakes up the event loop.
   void wakeup();
 
@@ -116,6 +176,8 @@ public:
   void updateChannel(Channel *channel);
   /// Removes a channel.
   void removeChannel(Channel *channel);
+  /// Removes a channel for another loop to take, see Channel::detach().
+  void detachChannel(Channel *channel, Channel::DetachCallback cb);
 
   /**
    * @brief Checks if the event loop has a specific channel.
@@ -144,25 +206,38 @@ private:
   void doPendingFunctors();
 
   void printActiveChannels() const;
+  /// Accounts the time from poll() returning to `now` as busy.
+  void updateBusyRatio(MonoTime now);
+  /// Reads the wall clock minus the monotonic clock, in microseconds.
+  static int64_t wallOffset();
 
   using ChannelList = std::vector<Channel *>;
 
   bool looping_;
   std::atomic_bool quit_;
   bool event_handling_;
-  bool calling_pending_functors_;
   const pid_t thread_id_;
   Timestamp poll_return_time_;
-  std::unique_ptr<Epoller> poller_;
+  MonoTime loop_now_; /// When poll() returned, on the monotonic clock
+  std::unique_ptr<Poller> poller_;
   std::unique_ptr<TimerQueue> timer_queue_;
+  std::unique_ptr<TimingWheel> timing_wheel_;
   int wakeup_fd_;
   std::unique_ptr<Channel> wakeup_channel_;
 
   ChannelList active_channels_;
   Channel *current_active_channel_;
 
-  mutable std::mutex mutex_;
-  std::vector<Functor> pending_functors_;
+  MpscQueue<Functor> pending_functors_;
+  /// Set while the loop is, or is about to be, blocked in poll()
+  std::atomic<bool> needs_wakeup_;
+
+  std::atomic<int> connection_count_;
+  std::atomic<double> busy_ratio_;
+  MonoTime busy_window_start_;
+  int64_t busy_us_; /// Busy so far in the current window
+  /// Added to loopNow() for pollReturnTime(), refreshed once a window
+  int64_t wall_offset_us_;
 };
 
 } // namespace lynx
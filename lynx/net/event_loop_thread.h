@@ -45,6 +45,11 @@ public:
    */
   EventLoop *startLoop();
 
+  /// Sets the CPUs the loop runs on, to be called before startLoop().
+  void setCpuAffinity(const CpuAffinity &affinity) {
+    thread_.setCpuAffinity(affinity);
+  }
+
 private:
   /**
    * @brief The function that runs in the thread.
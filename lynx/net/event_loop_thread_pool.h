@@ -1,15 +1,19 @@
 #ifndef LYNX_NET_EVENT_LOOP_THREAD_POOL_H
 #define LYNX_NET_EVENT_LOOP_THREAD_POOL_H
 
+#include "lynx/base/cpu_affinity.h"
 #include "lynx/base/noncopyable.h"
 
 #include <functional>
 #include <memory>
+#include <string>
+#include <vector>
 
 namespace lynx {
 
 class EventLoop;
 class EventLoopThread;
+class InetAddress;
 
 /**
  * @class EventLoopThreadPool
@@ -22,6 +26,12 @@ class EventLoopThread;
 class EventLoopThreadPool : Noncopyable {
 public:
   using ThreadInitCallback = std::function<void(EventLoop *)>;
+  /**
+   * Picks the loop a new connection from `peerAddr` goes to, among `loops`
+   * (never empty). Called in the base loop only, so it may keep state.
+   */
+  using PlacementPolicy = std::function<EventLoop *(
+      const std::vector<EventLoop *> &loops, const InetAddress &peerAddr)>;
 
   /**
    * @brief Constructs an EventLoopThreadPool with a base EventLoop and a name.
@@ -39,6 +49,15 @@ public:
    */
   void setThreadNum(int numThreads) { num_threads_ = numThreads; }
 
+  /**
+   * @brief Pins the loop threads, to be called before start().
+   *
+   * Each thread gets one CPU of `affinity` in turn (see
+   * CpuAffinity::cpuFor()), so that a loop and the connections it serves stay
+   * in the caches of one core. The base loop is left where it is.
+   */
+  void setCpuAffinity(const CpuAffinity &affinity) { affinity_ = affinity; }
+
   /**
    * @brief Starts the thread pool with an optional initialization callback.
    *
@@ -54,6 +73,37 @@ public:
    */
   EventLoop *getNextLoop();
 
+  /**
+   * @brief Gets the EventLoop a new connection from `peerAddr` is placed on.
+   *
+   * Asks the placement policy if one is set, round-robin like getNextLoop()
+   * otherwise.
+   */
+  EventLoop *getLoopForPeer(const InetAddress &peerAddr);
+
+  /// Sets how getLoopForPeer() chooses, empty for round-robin.
+  void setPlacementPolicy(PlacementPolicy policy) {
+    placement_policy_ = std::move(policy);
+  }
+
+  /**
+   * @name Placement policies
+   * The loads are read from the counters of the loops (see
+   * EventLoop::connectionCount()), ties go round-robin so that idle loops
+   * fill up evenly.
+   */
+  ///@{
+  /// The loop serving the fewest connections.
+  static PlacementPolicy leastConnections();
+  /// The loop with the fewest functors waiting, see EventLoop::queueSize().
+  static PlacementPolicy leastQueued();
+  /// The loop that was the least busy of late, see EventLoop::busyRatio().
+  static PlacementPolicy leastBusy();
+  /// The same loop for every connection from an IP address, so that what
+  /// the loop caches for a client stays useful.
+  static PlacementPolicy peerHash();
+  ///@}
+
   /**
    * @brief Gets all the EventLoops in the pool.
    *
@@ -72,6 +122,8 @@ private:
   int next_;
   std::vector<std::unique_ptr<EventLoopThread>> threads_;
   std::vector<EventLoop *> loops_;
+  PlacementPolicy placement_policy_;
+  CpuAffinity affinity_;
 };
 
 } // namespace lynx
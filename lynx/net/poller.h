@@ -0,0 +1,82 @@
+#ifndef LYNX_NET_POLLER_H
+#define LYNX_NET_POLLER_H
+
+#include "lynx/net/event_loop.h"
+
+#include <map>
+#include <vector>
+
+namespace lynx {
+
+/**
+ * @class Poller
+ * @brief The I/O multiplexing backend of an EventLoop.
+ *
+ * A poller watches the channels of one loop and reports those with events.
+ * Epoller, built on epoll(7), is the default; UringPoller runs the same
+ * channels on an io_uring. The backend of new loops is chosen by the
+ * LYNX_POLLER environment variable, see newDefaultPoller().
+ */
+class Poller : Noncopyable {
+public:
+  using ChannelList = std::vector<Channel *>;
+
+  explicit Poller(EventLoop *loop) : owner_loop_(loop) {}
+  virtual ~Poller() = default;
+
+  /**
+   * @brief Waits for events on the channels.
+   *
+   * @param timeoutMs The timeout in milliseconds, -1 to wait indefinitely.
+   * @param activeChannels The list to store the channels with events.
+   *
+   * @return The monotonic time when polling returns, the only clock read of
+   * the poll.
+   */
+  virtual MonoTime poll(int timeoutMs, ChannelList *activeChannels) = 0;
+
+  /// Adds a channel or applies the change of its events.
+  virtual void updateChannel(Channel *channel) = 0;
+
+  /// Removes a channel, it must have no events left.
+  virtual void removeChannel(Channel *channel) = 0;
+
+  /**
+   * @brief Removes a channel for another loop to watch, see
+   * Channel::detach().
+   *
+   * The default removes it and runs `cb` at once with nothing received, for
+   * pollers that do not read the fds themselves.
+   */
+  virtual void detachChannel(Channel *channel, Channel::DetachCallback cb);
+
+  /// Checks if a channel is watched by this poller.
+  virtual bool hasChannel(Channel *channel) const;
+
+  /// Returns the name of the backend, for logging.
+  virtual const char *name() const = 0;
+
+  /**
+   * @brief Creates the backend for a new loop.
+   *
+   * LYNX_POLLER=io_uring selects UringPoller when the kernel allows it, and
+   * falls back to Epoller with a warning otherwise. Anything else, or
+   * nothing, selects Epoller.
+   */
+  static Poller *newDefaultPoller(EventLoop *loop);
+
+  void assertInLoopThread() const { owner_loop_->assertInLoopThread(); }
+
+protected:
+  EventLoop *ownerLoop() const { return owner_loop_; }
+
+  using ChannelMap = std::map<int, Channel *>;
+  ChannelMap channels_;
+
+private:
+  EventLoop *owner_loop_;
+};
+
+} // namespace lynx
+
+#endif
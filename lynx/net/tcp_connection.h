@@ -2,13 +2,22 @@
 #define LYNX_NET_TCP_CONNECTION_H
 
 #include "lynx/base/noncopyable.h"
+#include "lynx/base/task.h"
 #include "lynx/base/timestamp.h"
 #include "lynx/net/buffer.h"
+#include "lynx/net/byte_slice.h"
+#include "lynx/net/chain_buffer.h"
 #include "lynx/net/inet_address.h"
+#include "lynx/timer/timing_wheel.h"
 
+#include <any>
+#include <atomic>
+#include <deque>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <netinet/tcp.h>
+#include <vector>
 
 namespace lynx {
 
@@ -51,7 +60,8 @@ public:
                 const InetAddress &localAddr, const InetAddress &peerAddr);
   ~TcpConnection();
 
-  EventLoop *getLoop() const { return loop_; }
+  /// The loop the connection is in, from any thread; migrateTo() changes it.
+  EventLoop *getLoop() const { return loop_.load(std::memory_order_acquire); }
   const std::string &name() const { return name_; }
   const InetAddress &localAddress() const { return local_addr_; }
   const InetAddress &peerAddress() const { return peer_addr_; }
@@ -61,9 +71,71 @@ public:
   bool getTcpInfo(struct tcp_info *) const;
   std::string getTcpInfoString() const;
 
+  /**
+   * The send() overloads may be called from any thread. From another thread
+   * the bytes reach the loop without being copied on the way, but only the
+   * overloads taking ownership avoid the initial copy.
+   */
   void send(const void *data, int len);
   void send(const std::string &message);
+  void send(std::string &&message);
   void send(Buffer *buf);
+  void send(Buffer &&buf);
+
+  /**
+   * @brief Sends a shared payload.
+   *
+   * What the socket does not take at once is queued as a reference to the
+   * slice, not a copy, so one slice can be sent to many connections (e.g. a
+   * broadcast) at the cost of one payload.
+   */
+  void send(const ByteSlice &slice);
+
+  /**
+   * @brief Returns the output buffer, for serializing straight into it.
+   *
+   * Only to be used in the loop thread, e.g. in the message callback; bytes
+   * appended to it are sent by the next flushOutputBuffer(). It is a chain of
+   * slabs, so a large response never reallocates it.
+   */
+  ChainBuffer *outputBuffer() { return &output_buffer_; }
+
+  /// Returns the input buffer, only to be used in the loop thread.
+  Buffer *inputBuffer() { return &input_buffer_; }
+
+  /// Starts sending the bytes appended to outputBuffer(), in the loop thread.
+  void flushOutputBuffer();
+
+  /// Length for sendFile() meaning up to the end of the file or pipe
+  static constexpr size_t K_TO_EOF = static_cast<size_t>(-1);
+
+  /**
+   * @brief Sends a region of a file without copying it through user space.
+   *
+   * The region goes out after the bytes already queued and before any sent
+   * later. A regular file is sent with sendfile(2), a pipe is spliced to the
+   * socket with splice(2) as its writer fills it. The region counts toward
+   * the high water mark until it is sent, and the write complete callback
+   * runs once it and the bytes around it are all sent. May be called from any
+   * thread.
+   *
+   * @param fd The file descriptor, it must stay open until the region is sent.
+   * @param offset The offset of the region in the file, ignored for a pipe.
+   * @param len The length of the region, or K_TO_EOF.
+   * @param owner Kept alive until the region is sent, e.g. the owner of `fd`.
+   */
+  void sendFile(int fd, off_t offset, size_t len,
+                std::shared_ptr<const void> owner = nullptr);
+
+  /**
+   * @brief Returns the bytes queued but not yet sent, file regions included.
+   *
+   * Only to be used in the loop thread. A pipe read to its end counts as
+   * nothing.
+   */
+  size_t pendingBytes() const {
+    return output_buffer_.readableBytes() + pending_file_bytes_;
+  }
 
   void shutdown();
   void forceClose();
@@ -75,6 +147,33 @@ public:
    */
   void setTcpNoDelay(bool on);
 
+  /// Bytes read per edge-triggered event before other channels get a turn
+  static const size_t K_DEFAULT_READ_BUDGET = 256 * 1024;
+
+  /**
+   * @brief Registers the socket edge-triggered, to be called before
+   * connectEstablished().
+   *
+   * A readable event then reads until EAGAIN and hands everything read to
+   * the message callback at once, and a writable event writes until EAGAIN,
+   * saving the epoll wakeups a busy connection costs level-triggered. Once
+   * `readBudget` bytes are read the socket is re-armed instead, so it is
+   * served again after the other ready connections.
+   */
+  void setEdgeTriggered(bool on, size_t readBudget = K_DEFAULT_READ_BUDGET);
+
+  /**
+   * @brief Closes the connection once `seconds` pass without the peer
+   * sending or taking any bytes, 0 for never. To be called before
+   * connectEstablished().
+   *
+   * Kept on the timing wheel of the loop (see EventLoop::timingWheel()), so
+   * traffic only records the time, and the connection is closed up to a
+   * second late.
+   */
+  void setIdleTimeout(double seconds) { idle_timeout_ = seconds; }
+  double idleTimeout() const { return idle_timeout_; }
+
   /// Starts reading from the connection.
   void startRead();
 
@@ -88,6 +187,36 @@ public:
    */
   bool isReading() const { return reading_; }
 
+  /**
+   * @brief Moves the connection to `loop`, which serves it from then on.
+   *
+   * At the next safe point of its current loop the socket is unregistered
+   * there, the bytes the poller had already received for it are added to the
+   * input buffer, and it is registered in `loop` with the events it had.
+   * Buffers, queued file regions, context and callbacks move with the
+   * connection; calls made meanwhile take effect once it is moved, and the
+   * message callback is called in `loop` for bytes carried over. Functors
+   * queued in the old loop for it follow it, and what other threads send
+   * keeps its order across the move, but state the application keeps per
+   * loop does not.
+   *
+   * A connection that is not connected, already moving, or sending from a
+   * pipe that was found empty stays where it is. Not for the connections of a
+   * TcpServer with SHARDED_REUSE_PORT, which must be torn down where they were
+   * accepted. May be called from any thread.
+   */
+  void migrateTo(EventLoop *loop);
+
+  /// Bytes read from the socket so far, may be read from any thread.
+  uint64_t bytesReceived() const {
+    return bytes_received_.load(std::memory_order_relaxed);
+  }
+
+  /// Attaches per-connection state (e.g. a protocol parser) to the connection.
+  void setContext(const std::any &context) { context_ = context; }
+  const std::any &getContext() const { return context_; }
+  std::any *getMutableContext() { return &context_; }
+
   void setConnectionCallback(const ConnectionCallback &cb) {
     connection_callback_ = cb;
   }
@@ -101,6 +230,7 @@ public:
     high_water_mark_callback_ = cb;
     high_water_mark_ = highWaterMark;
   }
+  size_t highWaterMark() const { return high_water_mark_; }
 
   /// Establishes the connection.
   void connectEstablished();
@@ -120,21 +250,88 @@ private:
   const char *stateToString() const;
 
   void handleRead(Timestamp receiveTime);
+  void handleReadEdge(Timestamp receiveTime);
+  /// Bytes the poller received for the socket (see UringPoller)
+  void handleReceived(const char *data, ssize_t n, Timestamp receiveTime);
   void handleWrite();
   void handleClose();
   void handleError();
+  /// The idle timeout expired
+  void handleIdle();
+
+  /// A file region queued by sendFile()
+  struct PendingFile {
+    int fd_;
+    off_t offset_;
+    size_t remaining_; /// K_TO_EOF if it is sent up to the end
+    size_t before_;    /// Output buffer bytes to send before this region
+    bool pipe_;
+    std::shared_ptr<const void> owner_;
+    /// Watches a pipe that was found empty, the socket waits meanwhile
+    std::unique_ptr<Channel> source_;
+  };
+
+  /// Writes output buffer bytes and file regions in order until the socket is
+  /// full, returns false on a fatal error. Progress counts as activity.
+  bool writeOutput();
+  /// Sends from the front region, returns the bytes sent, 0 at its end
+  ssize_t writeFile(PendingFile *file);
+  void popFile();
+  void clearFiles();
+  bool outputEmpty() const {
+    return output_buffer_.readableBytes() == 0 && pending_files_.empty();
+  }
+  /// True while the front region is a pipe with nothing to splice yet
+  bool waitingForSource() const;
+  void waitForSource(PendingFile *file);
 
-  void sendInLoop(const std::string &message);
-  void sendInLoop(const void *data, size_t len);
+  /**
+   * Runs `call` in the loop of the connection: at once from that loop,
+   * otherwise queued after the calls other threads made before. One functor
+   * runs the queue and follows the connection if it migrates, so the calls
+   * keep their order, and it holds the connection until they ran.
+   */
+  void runInOwnLoop(Task call);
+  void runQueuedCalls();
+  /// Checks if this is the loop of the connection, and if so first runs the
+  /// calls other threads queued.
+  bool inOwnLoop();
+
+  void sendFileInLoop(int fd, off_t offset, size_t len,
+                      std::shared_ptr<const void> owner);
+  /// Queues what the socket does not take, as a slice of `owner` if given
+  void sendInLoop(const void *data, size_t len,
+                  const std::shared_ptr<const void> &owner = nullptr);
   void shutdownInLoop();
   void forceCloseInLoop();
   void startReadInLoop();
   void stopReadInLoop();
+  void migrateInLoop(EventLoop *loop);
+  /// Registers the socket in the loop the connection moved to
+  void adoptInLoop(bool received);
+  /// Only the socket's own thread writes it
+  void countReceived(size_t n) {
+    bytes_received_.store(bytes_received_.load(std::memory_order_relaxed) + n,
+                          std::memory_order_relaxed);
+    idle_entry_.touch();
+  }
 
-  EventLoop *loop_;
+  /// Written by the old loop when a migration hands over, read anywhere
+  std::atomic<EventLoop *> loop_;
   const std::string name_;
   StateE state_;
   bool reading_;
+  /// Between migrateTo() taking effect and the new loop registering the
+  /// socket, when the channel is in no loop
+  bool migrating_;
+  bool close_after_migration_; /// forceClose() came meanwhile
+  bool unread_input_;          /// Carried over while reading was stopped
+  std::atomic<uint64_t> bytes_received_;
+
+  /// Calls from other threads, see runInOwnLoop()
+  std::mutex calls_mutex_;
+  std::vector<Task> queued_calls_;
+  std::atomic<bool> calls_queued_; /// A functor to run them is queued
 
   std::unique_ptr<Socket> socket_;
   std::unique_ptr<Channel> channel_;
@@ -148,9 +345,16 @@ private:
   CloseCallback close_callback_;
   HighWaterMarkCallback high_water_mark_callback_;
   size_t high_water_mark_;
+  size_t read_budget_; /// Per edge-triggered read event
 
   Buffer input_buffer_;
-  Buffer output_buffer_;
+  ChainBuffer output_buffer_;
+  std::deque<PendingFile> pending_files_;
+  size_t pending_file_bytes_; /// Bytes of the regions of known length
+  std::any context_;
+
+  double idle_timeout_;
+  TimingWheel::Entry idle_entry_; /// On the wheel of loop_ while connected
 };
 
 void defaultConnectionCallback(const TcpConnectionPtr &conn);
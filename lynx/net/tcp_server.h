@@ -1,17 +1,19 @@
 #ifndef LYNX_NET_TCP_SERVER_H
 #define LYNX_NET_TCP_SERVER_H
 
+#include "lynx/net/event_loop_thread_pool.h"
 #include "lynx/net/inet_address.h"
 #include "lynx/net/tcp_connection.h"
+#include "lynx/timer/timer_id.h"
 
 #include <atomic>
 #include <map>
+#include <vector>
 
 namespace lynx {
 
 class Acceptor;
 class EventLoop;
-class EventLoopThreadPool;
 
 /**
  * @class TcpServer
@@ -27,6 +29,9 @@ public:
   enum Option {
     NO_REUSE_PORT,
     REUSE_PORT,
+    /// Every IO loop listens on its own SO_REUSEPORT socket and keeps its
+    /// own connections, see start()
+    SHARDED_REUSE_PORT,
   };
 
   /**
@@ -41,15 +46,72 @@ public:
             const std::string &name, Option option = NO_REUSE_PORT);
   ~TcpServer();
 
+  /**
+   * @brief Starts the IO threads and listening.
+   *
+   * With SHARDED_REUSE_PORT each IO loop (the base loop if there are no IO
+   * threads) gets its own listening socket bound to the address. The kernel
+   * spreads new connections over them, and a connection is accepted, served,
+   * registered and torn down in the loop that accepted it, so connection
+   * storms do not funnel through the base loop.
+   */
   void start();
 
   void setThreadNum(int numThreads);
 
+  /// Pins the IO loop threads, one CPU each, to be called before start().
+  /// See EventLoopThreadPool::setCpuAffinity().
+  void setCpuAffinity(const CpuAffinity &affinity);
+
   EventLoop *getLoop() const { return loop_; }
 
   const std::string &ipPort() const { return ip_port_; }
   const std::string &name() const { return name_; }
 
+  /**
+   * @brief Registers the listening socket and the connections accepted
+   * afterwards edge-triggered (EPOLLET), to be called before start().
+   *
+   * Sockets are then read, written and accepted until EAGAIN, each read event
+   * taking at most `readBudget` bytes before the loop moves on to the other
+   * ready connections. See TcpConnection::setEdgeTriggered().
+   */
+  void setEdgeTriggered(bool on, size_t readBudget =
+                                     TcpConnection::K_DEFAULT_READ_BUDGET);
+
+  /**
+   * @brief Sets how new connections are spread over the IO loops, see
+   * EventLoopThreadPool::setPlacementPolicy(). Round-robin by default.
+   *
+   * Has no effect with SHARDED_REUSE_PORT, where the kernel places them.
+   */
+  void setPlacementPolicy(EventLoopThreadPool::PlacementPolicy policy);
+
+  /**
+   * @brief Moves hot connections off busy IO loops, to be called before
+   * start().
+   *
+   * Every `interval` seconds the base loop compares the busy ratios of the IO
+   * loops (EventLoop::busyRatio()). When the busiest is busier than the
+   * idlest by more than `imbalance`, the connection of the busiest that
+   * received the most bytes since the last check moves to the idlest (see
+   * TcpConnection::migrateTo()). That is, if another connection of the
+   * busiest received some too: moving the only active one would just move
+   * the hot spot. At most one connection moves per check.
+   *
+   * Not with SHARDED_REUSE_PORT.
+   */
+  void setRebalancing(double interval, double imbalance = 0.25);
+
+  /**
+   * @brief Closes connections that see no traffic for `seconds`, 0 for
+   * never. Applies to connections accepted afterwards.
+   *
+   * See TcpConnection::setIdleTimeout(): a timing wheel per IO loop rather
+   * than a timer per connection, so activity costs no timer update.
+   */
+  void setIdleTimeout(double seconds) { idle_timeout_ = seconds; }
+
   void setThreadInitCallback(const ThreadInitCallback &cb) {
     thread_init_callback_ = cb;
   }
@@ -62,16 +124,36 @@ public:
   }
 
 private:
+  using ConnectionMap = std::map<std::string, TcpConnectionPtr>;
+
+  /// The acceptor and the connections of one IO loop, with
+  /// SHARDED_REUSE_PORT. Only touched in that loop.
+  struct Shard {
+    EventLoop *loop_;
+    std::unique_ptr<Acceptor> acceptor_;
+    ConnectionMap connections_;
+    int next_conn_id_;
+    int id_stride_;
+  };
+
   void newConnection(int sockfd, const InetAddress &peerAddr);
   void removeConnection(const TcpConnectionPtr &conn);
   void removeConnectionInLoop(const TcpConnectionPtr &conn);
-
-  using ConnectionMap = std::map<std::string, TcpConnectionPtr>;
+  void startShards();
+  void rebalance();
+  void newShardConnection(Shard *shard, int sockfd,
+                          const InetAddress &peerAddr);
+  /// Sets the callbacks of a connection accepted by this server.
+  TcpConnectionPtr makeConnection(EventLoop *ioLoop, int id, int sockfd,
+                                  const InetAddress &peerAddr);
 
   EventLoop *loop_;
+  const InetAddress listen_addr_;
   const std::string ip_port_;
   const std::string name_;
-  std::unique_ptr<Acceptor> acceptor_;
+  const bool sharded_;
+  std::unique_ptr<Acceptor> acceptor_; /// Unless sharded
+  std::vector<std::unique_ptr<Shard>> shards_;
 
   std::shared_ptr<EventLoopThreadPool> thread_pool_;
 
@@ -80,10 +162,19 @@ private:
   WriteCompleteCallback write_complete_callback_;
 
   ThreadInitCallback thread_init_callback_;
+  bool edge_triggered_;
+  size_t read_budget_;
+  std::atomic<double> idle_timeout_;
   std::atomic_int32_t started_;
 
   int next_conn_id_;
   ConnectionMap connections_;
+
+  double rebalance_interval_; /// 0 if off
+  double rebalance_imbalance_;
+  TimerId rebalance_timer_;
+  /// bytesReceived() of the connections at the last check
+  std::map<std::string, uint64_t> received_marks_;
 };
 
 } // namespace lynx
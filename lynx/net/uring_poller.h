@@ -0,0 +1,164 @@
+#ifndef LYNX_NET_URING_POLLER_H
+#define LYNX_NET_URING_POLLER_H
+
+#include "lynx/net/poller.h"
+
+#include <deque>
+#include <linux/io_uring.h>
+#include <string>
+#include <unordered_map>
+
+namespace lynx {
+
+/**
+ * @class UringPoller
+ * @brief A poller running the channels of a loop on an io_uring.
+ *
+ * Every watch is a request in one ring, the loop's eventfd and timerfd
+ * included, and the requests queued by a loop iteration are submitted by the
+ * same io_uring_enter(2) that waits for the next events. Changing what a
+ * channel watches therefore costs no system call of its own, unlike
+ * epoll_ctl(2).
+ *
+ * Readiness is watched with poll requests, one-shot and re-armed after each
+ * event for level-triggered channels, multishot for edge-triggered ones. A
+ * channel with a receive callback (see Channel::setReceiveCallback()) is not
+ * told that its socket is readable: a multishot recv fills buffers of a
+ * provided buffer ring as bytes arrive and the poller hands them over, which
+ * saves the read(2) that would follow.
+ *
+ * Uses the raw system calls, no liburing. available() probes whether the
+ * kernel has what is needed.
+ */
+class UringPoller : public Poller {
+public:
+  explicit UringPoller(EventLoop *loop);
+  ~UringPoller() override;
+
+  MonoTime poll(int timeoutMs, ChannelList *activeChannels) override;
+  void updateChannel(Channel *channel) override;
+  void removeChannel(Channel *channel) override;
+  /// Waits for the recv requests of the channel to end before running `cb`,
+  /// the bytes they still bring are part of what it gets.
+  void detachChannel(Channel *channel, Channel::DetachCallback cb) override;
+  const char *name() const override { return "io_uring"; }
+
+  /// Returns whether io_uring can be used, probed once per process.
+  static bool available();
+
+  /// Whether sockets are received through the buffer ring
+  bool receiving() const { return buf_ring_ != nullptr; }
+
+  static const unsigned K_RING_ENTRIES = 256;
+  static const unsigned K_BUFFER_COUNT = 128;
+  static const unsigned K_BUFFER_SIZE = 16 * 1024;
+
+private:
+  enum RequestKind : uint64_t {
+    K_POLL = 0,
+    K_RECV = 1,
+    K_CANCEL = 2,
+  };
+
+  /// What the ring does for one watched fd
+  struct Entry {
+    Channel *channel_ = nullptr;
+    uint32_t instance_ = 0; /// Serial when added, older requests are stale
+    uint32_t poll_serial_ = 0;
+    uint32_t recv_serial_ = 0;
+    uint32_t poll_events_ = 0; /// What the armed poll watches
+    bool poll_armed_ = false;
+    bool recv_armed_ = false;
+    bool dirty_ = false;   /// To be compared with the channel before waiting
+    bool rearm_ = false;   /// Re-arm even if the events did not change
+    bool active_ = false;  /// Already in this batch's active channels
+    uint32_t revents_ = 0; /// Accumulated for this batch
+    /// Bytes received while reading was disabled or before those were
+    /// delivered, handed over once reading is enabled again
+    std::string stash_;
+    /// How the stream ended: 1 if it did not, 0 at its end, -errno on failure
+    int end_ = 1;
+    bool end_delivered_ = false;
+    int recv_live_ = 0; /// Recv requests whose last completion is to come
+    /// Set once the channel is detached, the entry stays until recv_live_
+    /// drops to 0
+    Channel::DetachCallback detach_callback_;
+  };
+
+  bool setupRing(unsigned entries);
+  bool setupBufferRing();
+
+  struct io_uring_sqe *getSqe();
+  void prepPoll(int fd, Entry *entry, uint32_t events, bool multishot);
+  void prepRecv(int fd, Entry *entry);
+  void prepCancel(int fd, uint64_t userData);
+
+  /// Brings the requests of the dirty entries in line with their channels
+  void armDirty(ChannelList *activeChannels);
+  void markDirty(int fd, Entry *entry);
+  /// Whether reading the channel is left to the recv requests
+  bool receivesFor(const Entry &entry) const;
+  uint32_t wantedPollEvents(const Entry &entry) const;
+  bool wantsRecv(const Entry &entry) const;
+  /// Submits the queued requests, then waits for `minComplete` completions
+  /// for at most `timeoutMs` (-1 for no limit)
+  int enter(unsigned minComplete, unsigned flags, int timeoutMs);
+  void reap(ChannelList *activeChannels);
+  void handleCompletion(const struct io_uring_cqe &cqe,
+                        ChannelList *activeChannels);
+  void handleRecv(Entry *entry, uint32_t serial,
+                  const struct io_uring_cqe &cqe, ChannelList *activeChannels);
+  void activate(Entry *entry, ChannelList *activeChannels);
+  /// Drops the entry of a detached channel and hands over its stash
+  void finishDetach(Entry *entry);
+  void deliverStash(Entry *entry, ChannelList *activeChannels);
+  void addBuffer(uint16_t bid);
+  /// Hands the buffers delivered by the last batch back to the kernel
+  void recycleBuffers();
+
+  static uint64_t userData(int fd, RequestKind kind, uint32_t serial);
+  uint32_t nextSerial();
+
+  int ring_fd_;
+  struct io_uring_params params_;
+
+  /// Both queues, mapped at once
+  void *ring_;
+  size_t ring_size_;
+
+  /// Submission queue
+  unsigned *sq_head_;
+  unsigned *sq_tail_;
+  unsigned sq_mask_;
+  unsigned *sq_array_;
+  struct io_uring_sqe *sqes_;
+  size_t sqes_size_;
+  unsigned *sq_flags_;
+  unsigned sq_local_tail_; /// Filled but not yet published
+
+  /// Completion queue
+  unsigned *cq_head_;
+  unsigned *cq_tail_;
+  unsigned cq_mask_;
+  struct io_uring_cqe *cqes_;
+
+  /// Provided buffer ring the multishot receives fill, as its slots: in C++
+  /// the flexible array of io_uring_buf_ring is not at offset 0. The tail
+  /// overlays `resv` of the first slot.
+  struct io_uring_buf *buf_ring_;
+  size_t buf_ring_size_;
+  char *buffers_;
+  uint16_t buf_tail_;
+  std::vector<uint16_t> used_buffers_;
+
+  std::unordered_map<int, Entry> entries_;
+  std::vector<int> dirty_fds_;
+  std::vector<Entry *> active_entries_;
+  /// Stashes handed to channels by this batch, a deque keeps them in place
+  std::deque<std::string> delivered_stashes_;
+  uint32_t serial_;
+};
+
+} // namespace lynx
+
+#endif
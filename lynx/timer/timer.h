@@ -1,8 +1,8 @@
 #ifndef LYNX_TIMER_TIMER_H
 #define LYNX_TIMER_TIMER_H
 
+#include "lynx/base/mono_time.h"
 #include "lynx/base/noncopyable.h"
-#include "lynx/base/timestamp.h"
 #include "lynx/timer/timer_id.h"
 
 #include <atomic>
@@ -21,6 +21,9 @@ namespace lynx {
  */
 class Timer : Noncopyable {
 public:
+  /// An unused timer, for pools to hand out with reset().
+  Timer() : interval_(0.0), repeat_(false), sequence_(-1) {}
+
   /**
    * @brief Constructs a Timer object.
    *
@@ -30,36 +33,48 @@ public:
    * repeated. If the interval is non-positive, the timer will be a one-shot
    * timer.
    */
-  Timer(TimerCallback cb, Timestamp when, double interval)
+  Timer(TimerCallback cb, MonoTime when, double interval)
       : callback_(std::move(cb)), expiration_(when), interval_(interval),
         repeat_(interval > 0.0), sequence_(num_created.fetch_add(1)) {}
 
+  /// Makes the timer a new one, with a new sequence number.
+  void reset(TimerCallback cb, MonoTime when, double interval);
+
   /// Executes the callback function associated with this timer.
   void run() const { callback_(); }
 
   /// Returns the time at which this timer is scheduled to execute.
-  Timestamp expiration() const { return expiration_; }
+  MonoTime expiration() const { return expiration_; }
 
   /// Returns whether this timer is a repeating timer.
   bool repeat() const { return repeat_; }
 
-  /// Returns the sequence number of this timer.
-  int64_t sequence() const { return sequence_; }
+  /// Returns the sequence number of this timer, -1 for an unused one.
+  int64_t sequence() const { return sequence_.load(std::memory_order_relaxed); }
 
   /// Restarts the timer with a new expiration time.
-  void restart(Timestamp now);
+  void restart(MonoTime now);
 
   /// Returns the total number of Timer objects created.
   static int64_t numCreated() { return num_created; }
 
 private:
-  const TimerCallback callback_; /// The callback function to be executed when
-                                 /// the timer expires.
-  Timestamp expiration_;         /// The time at which the timer should expire.
-  const double
-      interval_;      /// The interval at which the timer should be repeated.
-  const bool repeat_; /// Whether this timer is a repeating timer.
-  const int64_t sequence_; /// The sequence number of the timer.
+  friend class WheelTimerQueue;
+
+  TimerCallback callback_; /// The callback function to be executed when the
+                           /// timer expires.
+  MonoTime expiration_;    /// The time at which the timer should expire.
+  double interval_; /// The interval at which the timer should be repeated.
+  bool repeat_;     /// Whether this timer is a repeating timer.
+  /// The sequence number of the timer. Atomic since a pooled timer may be
+  /// reset in one thread while a stale TimerId is checked in the loop.
+  std::atomic_int64_t sequence_;
+
+  /// Kept by WheelTimerQueue: the list the timer is on and its neighbours
+  Timer *prev_ = nullptr;
+  Timer *next_ = nullptr;
+  int64_t tick_ = 0;
+  int slot_ = -1;
 
   // The atomic counter for generating unique sequence numbers for each timer.
   static std::atomic_int64_t num_created;
@@ -1,13 +1,15 @@
 #ifndef LYNX_TIMER_TIMER_ID_H
 #define LYNX_TIMER_TIMER_ID_H
 
-#include <functional>
+#include "lynx/base/task.h"
+
+#include <cstdint>
 
 namespace lynx {
 
 class Timer;
 
-using TimerCallback = std::function<void()>;
+using TimerCallback = Task;
 
 /**
  * @class TimerId
@@ -1,11 +1,11 @@
 #ifndef LYNX_TIMER_TIMER_QUEUE_H
 #define LYNX_TIMER_TIMER_QUEUE_H
 
-#include "lynx/base/timestamp.h"
+#include "lynx/base/mono_time.h"
 #include "lynx/net/channel.h"
 #include "lynx/timer/timer_id.h"
 
-#include <set>
+#include <memory>
 
 namespace lynx {
 
@@ -15,11 +15,22 @@ class TimerId;
 
 /**
  * @class TimerQueue
- * @brief A timer queue that manages a set of timers and their expiration times.
+ * @brief The timers of an EventLoop.
  *
- * The TimerQueue class is responsible for scheduling and executing timers.
- * It uses a timerfd to handle the underlying timer events and dispatches
- * callbacks to the appropriate timers.
+ * A timer queue keeps the timers of one loop and runs those that are due
+ * when its timerfd fires; how it stores them is up to the backend.
+ * TreeTimerQueue, ordered sets of timers, is the default; WheelTimerQueue
+ * is a hierarchical timing wheel with pooled timers. The backend of new loops
+ * is chosen by the LYNX_TIMER_QUEUE environment variable, see
+ * newDefaultTimerQueue().
+ *
+ * Expirations are on the monotonic clock, so setting the wall clock moves
+ * no timer. The timerfd is on CLOCK_MONOTONIC too.
+ *
+ * Without a timerfd, the queue only records its next expiration: the loop
+ * sleeps in poll() no longer than pollTimeout() and then calls expireDue().
+ * That saves the timerfd_settime() of every re-arm and the read() of every
+ * expiry, at the cost of a millisecond resolution.
  */
 class TimerQueue : Noncopyable {
 public:
@@ -27,12 +38,13 @@ public:
    * @brief Constructs a TimerQueue object.
    *
    * @param loop The event loop associated with this timer queue.
+   * @param useTimerfd Whether a timerfd wakes the loop, or the poll timeout.
    */
-  explicit TimerQueue(EventLoop *loop);
-  ~TimerQueue();
+  TimerQueue(EventLoop *loop, bool useTimerfd);
+  virtual ~TimerQueue();
 
   /**
-   * @brief Adds a timer to the timer queue.
+   * @brief Adds a timer to the timer queue, from any thread.
    *
    * @param cb The callback function to be executed when the timer expires.
    * @param when The time at which the timer should expire.
@@ -40,72 +52,66 @@ public:
    *
    * @return The TimerId of the added timer.
    */
-  TimerId addTimer(TimerCallback cb, Timestamp when, double interval);
+  TimerId addTimer(TimerCallback cb, MonoTime when, double interval);
 
   /**
-   * @brief Cancels a timer.
+   * @brief Cancels a timer, from any thread.
    *
    * @param timerId The TimerId of the timer to be cancelled.
    */
   void cancel(TimerId timerId);
 
-private:
-  using Entry = std::pair<Timestamp, Timer *>;
-  using TimerList = std::set<Entry>;
-  using ActiveTimer = std::pair<Timer *, int64_t>;
-  using ActiveTimerSet = std::set<ActiveTimer>;
+  /// Returns the name of the backend, for logging.
+  virtual const char *name() const = 0;
 
-  /**
-   * @brief Adds a timer to the timer queue.
-   *
-   * @param timer The timer to be added.
-   */
-  void addTimerInLoop(Timer *timer);
+  bool usesTimerfd() const { return timerfd_ >= 0; }
 
   /**
-   * @brief Cancels a timer.
+   * @brief Gets how long the loop may sleep in poll() without a timerfd.
    *
-   * @param timerId The TimerId of the timer to be cancelled.
+   * @param now The current time, as the loop last read it.
+   * @param maxMs The longest sleep.
+   * @return The milliseconds until the next expiration, rounded up, 0 if it
+   * has passed, and `maxMs` if there is none or a timerfd wakes the loop.
    */
-  void cancelInLoop(TimerId timerId);
+  int pollTimeout(MonoTime now, int maxMs) const;
 
-  /// Handles the read event of the timerfd.
-  void handleRead();
+  /// Runs the timers due at `now`, the time poll() returned, if no timerfd
+  /// does it.
+  void expireDue(MonoTime now);
 
   /**
-   * @brief Gets the expired timers.
+   * @brief Creates the backend for a new loop.
    *
-   * @param now The current time.
-   *
-   * @return The vector of expired timers.
+   * WheelTimerQueue if LYNX_TIMER_QUEUE is "wheel", with a resolution of
+   * LYNX_TIMER_RESOLUTION_US microseconds if set; TreeTimerQueue otherwise.
+   * LYNX_TIMERFD=off drives either from the poll timeout instead.
    */
-  std::vector<Entry> getExpired(Timestamp now);
+  static TimerQueue *newDefaultTimerQueue(EventLoop *loop);
 
-  /**
-   * @brief Resets the expired timers.
-   *
-   * @param expired The vector of expired timers.
-   * @param now The current time.
-   */
-  void reset(const std::vector<Entry> &expired, Timestamp now);
+protected:
+  /// Makes the timer addTimer() returns the id of, called in any thread.
+  virtual Timer *newTimer(TimerCallback cb, MonoTime when, double interval) = 0;
+  virtual void addTimerInLoop(Timer *timer) = 0;
+  virtual void cancelInLoop(TimerId timerId) = 0;
+  /// Runs the timers due at `now` and re-arms for the next one.
+  virtual void expire(MonoTime now) = 0;
 
-  /**
-   * @brief Inserts a timer into the timer list.
-   *
-   * @param timer The timer to be inserted.
-   *
-   * @return True if the insertion is successful, false otherwise.
-   */
-  bool insert(Timer *timer);
-
-  EventLoop *loop_;         /// The event loop associated with this timer queue.
-  const int timerfd_;       /// The file descriptor of the timerfd.
-  Channel timerfd_channel_; /// The channel associated with the timerfd.
-  TimerList timers_;        /// The timer list.
-  ActiveTimerSet active_timers_; /// The set of active timers.
-  bool calling_expired_timers_;  /// Indicates whether expired timers are being
-                                 /// called.
-  ActiveTimerSet canceling_timers_; /// The set of cancelling timers.
+  /// Arms the timerfd, or the poll timeout, to fire at `expiration`.
+  void arm(MonoTime expiration);
+
+  static Timer *timerOf(TimerId timerId) { return timerId.timer_; }
+  static int64_t sequenceOf(TimerId timerId) { return timerId.sequence_; }
+
+  EventLoop *loop_; /// The event loop associated with this timer queue.
+
+private:
+  /// Handles the read event of the timerfd.
+  void handleRead();
+
+  const int timerfd_; /// The file descriptor of the timerfd, or -1.
+  std::unique_ptr<Channel> timerfd_channel_;
+  MonoTime next_expiration_; /// What arm() was given last, without timerfd
 };
 
 } // namespace lynx
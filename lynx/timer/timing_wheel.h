@@ -0,0 +1,111 @@
+#ifndef LYNX_TIMER_TIMING_WHEEL_H
+#define LYNX_TIMER_TIMING_WHEEL_H
+
+#include "lynx/base/noncopyable.h"
+#include "lynx/timer/timer_id.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+namespace lynx {
+
+class EventLoop;
+
+/**
+ * @class TimingWheel
+ * @brief A hashed timing wheel for many timeouts that are mostly pushed back,
+ * such as the idle timeouts of connections.
+ *
+ * Entries are linked into one of a ring of buckets by the tick they are due
+ * at. Adding, removing and touching an entry are O(1) and allocate nothing,
+ * touching only records the new deadline: the entry is moved when its bucket
+ * comes up and it turns out not to be due yet. The wheel turns on a single
+ * EventLoop timer, one tick at a time, and expires a whole bucket at once;
+ * the timer only runs while the wheel holds entries.
+ *
+ * Expiry is late by up to one tick, never early. Everything happens in the
+ * loop thread.
+ */
+class TimingWheel : Noncopyable {
+public:
+  using ExpiryCallback = std::function<void()>;
+
+  /**
+   * @class Entry
+   * @brief A timeout on the wheel, to be embedded in its owner.
+   *
+   * Unlinked on expiry and on destruction.
+   */
+  class Entry : Noncopyable {
+  public:
+    Entry() : prev_(this), next_(this) {}
+    explicit Entry(ExpiryCallback cb) : Entry() { callback_ = std::move(cb); }
+    ~Entry() { unlink(); }
+
+    void setCallback(ExpiryCallback cb) { callback_ = std::move(cb); }
+    bool linked() const { return wheel_ != nullptr; }
+
+    /// Pushes the deadline back by the timeout, e.g. on activity.
+    void touch() {
+      if (wheel_ != nullptr) {
+        deadline_ = wheel_->now_ + ticks_;
+      }
+    }
+
+    /// Takes the entry off its wheel, if it is on one.
+    void unlink();
+
+  private:
+    friend class TimingWheel;
+
+    Entry *prev_;
+    Entry *next_;
+    TimingWheel *wheel_ = nullptr;
+    int64_t ticks_ = 0;    /// The timeout, in ticks
+    int64_t deadline_ = 0; /// The tick it expires at
+    ExpiryCallback callback_;
+  };
+
+  /**
+   * @brief Constructs a wheel turned by `loop`.
+   *
+   * @param tick The length of a tick in seconds, the resolution.
+   * @param buckets The number of buckets; timeouts longer than that many
+   * ticks are looked at once per turn until due.
+   */
+  TimingWheel(EventLoop *loop, double tick, size_t buckets);
+  ~TimingWheel();
+
+  /**
+   * @brief Puts `entry` on the wheel, or back on it with a new timeout.
+   *
+   * Its callback runs in the loop once `timeout` seconds have passed
+   * without a touch().
+   */
+  void add(Entry *entry, double timeout);
+
+  double tick() const { return tick_; }
+  /// Returns the number of entries on the wheel.
+  size_t size() const { return size_; }
+
+private:
+  /// Advances by one tick and expires what is due.
+  void onTick();
+  void link(Entry *entry);
+  static void unlinkRaw(Entry *entry);
+
+  EventLoop *loop_;
+  const double tick_;
+  const size_t num_buckets_;
+  std::unique_ptr<Entry[]> buckets_; /// List heads
+  int64_t now_;                      /// Ticks so far
+  size_t size_;
+  bool ticking_;
+  TimerId timer_;
+};
+
+} // namespace lynx
+
+#endif
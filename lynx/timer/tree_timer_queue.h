@@ -0,0 +1,86 @@
+#ifndef LYNX_TIMER_TREE_TIMER_QUEUE_H
+#define LYNX_TIMER_TREE_TIMER_QUEUE_H
+
+#include "lynx/timer/timer_queue.h"
+
+#include <set>
+#include <vector>
+
+namespace lynx {
+
+/**
+ * @class TreeTimerQueue
+ * @brief A timer queue keeping its timers in ordered sets.
+ *
+ * Timers are allocated one by one and kept in a set ordered by expiration,
+ * so adding and cancelling cost O(log n) and the timerfd is armed for the
+ * exact expiration of the earliest.
+ */
+class TreeTimerQueue : public TimerQueue {
+public:
+  explicit TreeTimerQueue(EventLoop *loop, bool useTimerfd = true);
+  ~TreeTimerQueue() override;
+
+  const char *name() const override { return "tree"; }
+
+protected:
+  Timer *newTimer(TimerCallback cb, MonoTime when, double interval) override;
+
+  /**
+   * @brief Adds a timer to the timer queue.
+   *
+   * @param timer The timer to be added.
+   */
+  void addTimerInLoop(Timer *timer) override;
+
+  /**
+   * @brief Cancels a timer.
+   *
+   * @param timerId The TimerId of the timer to be cancelled.
+   */
+  void cancelInLoop(TimerId timerId) override;
+
+  void expire(MonoTime now) override;
+
+private:
+  using Entry = std::pair<MonoTime, Timer *>;
+  using TimerList = std::set<Entry>;
+  using ActiveTimer = std::pair<Timer *, int64_t>;
+  using ActiveTimerSet = std::set<ActiveTimer>;
+
+  /**
+   * @brief Gets the expired timers.
+   *
+   * @param now The current time.
+   *
+   * @return The vector of expired timers.
+   */
+  std::vector<Entry> getExpired(MonoTime now);
+
+  /**
+   * @brief Resets the expired timers.
+   *
+   * @param expired The vector of expired timers.
+   * @param now The current time.
+   */
+  void reset(const std::vector<Entry> &expired, MonoTime now);
+
+  /**
+   * @brief Inserts a timer into the timer list.
+   *
+   * @param timer The timer to be inserted.
+   *
+   * @return True if the insertion is successful, false otherwise.
+   */
+  bool insert(Timer *timer);
+
+  TimerList timers_;             /// The timer list.
+  ActiveTimerSet active_timers_; /// The set of active timers.
+  bool calling_expired_timers_;  /// Indicates whether expired timers are being
+                                 /// called.
+  ActiveTimerSet canceling_timers_; /// The set of cancelling timers.
+};
+
+} // namespace lynx
+
+#endif
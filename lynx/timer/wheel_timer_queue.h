@@ -0,0 +1,104 @@
+#ifndef LYNX_TIMER_WHEEL_TIMER_QUEUE_H
+#define LYNX_TIMER_WHEEL_TIMER_QUEUE_H
+
+#include "lynx/timer/timer_queue.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace lynx {
+
+/**
+ * @class WheelTimerQueue
+ * @brief A timer queue on a hierarchical timing wheel.
+ *
+ * Time is cut into ticks of the resolution. Four levels of 256 slots each
+ * hold the timers due within 2^8, 2^16, 2^24 and 2^32 ticks, and a timer
+ * moves down a level whenever the slot it is in comes up, until it is in
+ * the slot of the tick it is due at. Adding and cancelling a timer are O(1),
+ * and timers come from a pool that only grows, so they cost no allocation
+ * once the pool is warm.
+ *
+ * Timers run up to one resolution late, never early. The timerfd is armed for
+ * the next non-empty slot, found with a bitmap of each level.
+ */
+class WheelTimerQueue : public TimerQueue {
+public:
+  static const int64_t K_DEFAULT_RESOLUTION_US = 1000;
+
+  /**
+   * @brief Constructs a WheelTimerQueue.
+   *
+   * @param loop The event loop associated with this timer queue.
+   * @param resolutionUs The length of a tick in microseconds.
+   * @param useTimerfd Whether a timerfd wakes the loop, or the poll timeout.
+   */
+  explicit WheelTimerQueue(EventLoop *loop,
+                           int64_t resolutionUs = K_DEFAULT_RESOLUTION_US,
+                           bool useTimerfd = true);
+  ~WheelTimerQueue() override;
+
+  const char *name() const override { return "wheel"; }
+
+protected:
+  Timer *newTimer(TimerCallback cb, MonoTime when, double interval) override;
+  void addTimerInLoop(Timer *timer) override;
+  void cancelInLoop(TimerId timerId) override;
+  void expire(MonoTime now) override;
+
+private:
+  static const int K_LEVELS = 4;
+  static const int K_SLOT_BITS = 8;
+  static const int K_SLOTS = 1 << K_SLOT_BITS;
+  static const int K_DUE = K_LEVELS * K_SLOTS; /// The list of timers to run
+  static const int K_NONE = -1;       /// On no list: pooled, running or new
+  static const size_t K_CHUNK = 1024; /// Timers the pool grows by
+
+  /// A doubly linked list of timers, through Timer::prev_ and next_
+  struct List {
+    Timer *head_ = nullptr;
+    Timer *tail_ = nullptr;
+  };
+
+  /// The first tick at or after `when`.
+  int64_t tickOf(MonoTime when) const;
+  /// Puts a timer due at a later tick in its slot.
+  void schedule(Timer *timer);
+  /// Puts a timer in the slot for its tick, as seen from now_tick_.
+  void place(Timer *timer);
+  void append(int slot, Timer *timer);
+  void unlink(Timer *timer);
+  /// Moves the timers of a slot down, returns the slot index.
+  int cascade(int level);
+  /// Advances to `tick`, moving its timers to the due list.
+  void advanceTo(int64_t tick);
+  /// The next tick with something to do, INT64_MAX if the wheel is empty.
+  int64_t nextTick() const;
+  /// Arms for the next tick with something to do.
+  void rearm();
+
+  Timer *acquire();
+  void release(Timer *timer);
+
+  const int64_t resolution_us_;
+  const int64_t origin_us_; /// Tick 0
+  int64_t now_tick_;        /// The last tick advanced to
+  int64_t armed_tick_;      /// The tick armed for, or INT64_MAX
+
+  List slots_[K_DUE + 1]; /// The slots of each level, then the due list
+  uint64_t bitmap_[K_LEVELS][K_SLOTS / 64]; /// The non-empty slots
+
+  Timer *running_;        /// Whose callback is running
+  bool running_canceled_; /// It was cancelled meanwhile
+
+  /// The pool, shared with the threads adding timers
+  std::mutex pool_mutex_;
+  std::vector<std::unique_ptr<Timer[]>> chunks_;
+  Timer *free_list_; /// Through Timer::next_
+};
+
+} // namespace lynx
+
+#endif
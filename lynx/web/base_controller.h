@@ -4,6 +4,8 @@
 #include "lynx/app/application.h"
 #include "lynx/logger/logging.h"
 
+#include <tuple>
+
 namespace lynx {
 
 /**
@@ -151,13 +153,15 @@ private:
    * @brief Processes a request parameter.
    *
    * @tparam ParamType The type of the request parameter.
-   * @param params The map of request parameters.
+   * @param req The HTTP request, its params are read without decoding them all.
    * @param param The request parameter to process.
-   * @return The processed request parameter.
+   * @param ok Set to false if the param is absent or malformed.
+   * @return The processed request parameter, or a default one if not ok.
    */
   template <typename ParamType>
-  ParamType processRequestParam(const HttpRequest::MapType &params,
-                                const RequestParam<ParamType> &param);
+  ParamType processRequestParam(const HttpRequest &req,
+                                const RequestParam<ParamType> &param,
+                                bool *ok);
 
   /**
    * @brief Sets the response to OK with JSON content type.
@@ -170,6 +174,18 @@ private:
     resp->addHeader("Server", "lynx");
   }
 
+  /**
+   * @brief Sets the response to Bad Request, for params the client got wrong.
+   *
+   * @param resp The HTTP response object.
+   */
+  void setRespBadRequest(lynx::HttpResponse *resp) {
+    resp->setStatusCode(lynx::HttpStatus::BAD_REQUEST);
+    resp->setContentType("application/json");
+    resp->addHeader("Server", "lynx");
+    resp->setBody(R"({"error":"bad request params"})");
+  }
+
   /// The map of HTTP routes.
   std::map<std::pair<std::string, std::string>, HttpHandler> route_table_;
 };
@@ -191,11 +207,11 @@ void BaseController::requestMapping(const std::string &method,
                                     PathVariable<PathType> /*unused*/) {
   auto handler = [&, func](const lynx::HttpRequest &req,
                            lynx::HttpResponse *resp) {
-    auto &path = req.path();
+    auto path = req.path();
     PathType arg;
     if constexpr (std::is_same_v<PathType, int64_t> ||
                   std::is_same_v<PathType, uint64_t>) {
-      arg = atoll(path.substr(path.find_last_of('/') + 1).c_str());
+      arg = atoll(std::string(path.substr(path.find_last_of('/') + 1)).c_str());
     }
     setRespOk(resp);
     resp->setBody(func(arg).dump());
@@ -224,11 +240,12 @@ void BaseController::requestMapping(const std::string &method,
                                     RequestBody<BodyType> /*unused*/) {
   auto handler = [&, func](const lynx::HttpRequest &req,
                            lynx::HttpResponse *resp) {
-    auto &path = req.path();
+    auto path = req.path();
     PathType arg1;
     if constexpr (std::is_same_v<PathType, int64_t> ||
                   std::is_same_v<PathType, uint64_t>) {
-      arg1 = atoll(path.substr(path.find_last_of('/') + 1).c_str());
+      arg1 =
+          atoll(std::string(path.substr(path.find_last_of('/') + 1)).c_str());
     }
 
     json j = json::parse(req.body());
@@ -242,16 +259,13 @@ void BaseController::requestMapping(const std::string &method,
 
 template <typename ParamType>
 ParamType
-BaseController::processRequestParam(const HttpRequest::MapType &params,
-                                    const RequestParam<ParamType> &param) {
-  if (params.find(param.name_) == params.end()) {
-    LOG_FATAL << "error in request params";
-  }
-  ParamType arg;
-  std::string value = params.at(param.name_);
-  if constexpr (std::is_same_v<ParamType, int64_t> ||
-                std::is_same_v<ParamType, uint64_t>) {
-    arg = atoll(value.c_str());
+BaseController::processRequestParam(const HttpRequest &req,
+                                    const RequestParam<ParamType> &param,
+                                    bool *ok) {
+  ParamType arg{};
+  if (!req.parseParam(param.name_, &arg)) {
+    LOG_DEBUG << "missing or malformed request param " << param.name_;
+    *ok = false;
   }
   return arg;
 }
@@ -263,9 +277,16 @@ void BaseController::requestMapping(const std::string &method,
   auto handler = [&, func,
                   ... params = std::forward<RequestParam<ParamType>>(params)](
                      const lynx::HttpRequest &req, lynx::HttpResponse *resp) {
+    bool ok = true;
+    /// A braced list evaluates the params in order
+    std::tuple<ParamType...> args{
+        processRequestParam<ParamType>(req, params, &ok)...};
+    if (!ok) {
+      setRespBadRequest(resp);
+      return;
+    }
     setRespOk(resp);
-    resp->setBody(
-        func(processRequestParam<ParamType>(req.params(), params)...).dump());
+    resp->setBody(std::apply(func, std::move(args)).dump());
   };
   route_table_[std::make_pair(method, path)] = handler;
 }
@@ -0,0 +1,103 @@
+#include "lynx/base/cpu_affinity.h"
+#include "lynx/base/thread.h"
+#include "lynx/base/thread_pool.h"
+
+#include <latch>
+#include <mutex>
+#include <sched.h>
+#include <set>
+#include <stdexcept>
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+/// The CPUs the calling thread may run on.
+std::set<int> allowed() {
+  std::set<int> cpus;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  ::sched_getaffinity(0, sizeof(set), &set);
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (CPU_ISSET(cpu, &set)) {
+      cpus.insert(cpu);
+    }
+  }
+  return cpus;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(testParse) {
+  BOOST_CHECK(lynx::CpuAffinity::parse("").empty());
+  BOOST_CHECK(lynx::CpuAffinity::parse("none").empty());
+
+  lynx::CpuAffinity affinity = lynx::CpuAffinity::parse("8, 0-3,2");
+  std::vector<int> expected = {0, 1, 2, 3, 8};
+  BOOST_CHECK(affinity.cpus() == expected);
+  BOOST_CHECK_EQUAL(affinity.toString(), "0,1,2,3,8");
+
+  BOOST_CHECK_THROW(lynx::CpuAffinity::parse("3-1"), std::invalid_argument);
+  BOOST_CHECK_THROW(lynx::CpuAffinity::parse("1,,2"), std::invalid_argument);
+  BOOST_CHECK_THROW(lynx::CpuAffinity::parse("0-"), std::invalid_argument);
+  BOOST_CHECK_THROW(lynx::CpuAffinity::parse("x"), std::invalid_argument);
+  BOOST_CHECK_THROW(lynx::CpuAffinity::parse("99999"), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(testCpuFor) {
+  lynx::CpuAffinity affinity({4, 6});
+  BOOST_CHECK_EQUAL(affinity.cpuFor(0).toString(), "4");
+  BOOST_CHECK_EQUAL(affinity.cpuFor(1).toString(), "6");
+  BOOST_CHECK_EQUAL(affinity.cpuFor(2).toString(), "4");
+  BOOST_CHECK(lynx::CpuAffinity().cpuFor(3).empty());
+}
+
+BOOST_AUTO_TEST_CASE(testPhysicalCores) {
+  std::set<int> cpus = allowed();
+  lynx::CpuAffinity cores = lynx::CpuAffinity::parse("physical_cores");
+  BOOST_REQUIRE(!cores.empty());
+  BOOST_CHECK_LE(cores.cpus().size(), cpus.size());
+  for (int cpu : cores.cpus()) {
+    BOOST_CHECK(cpus.count(cpu) == 1);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testPinnedThread) {
+  int cpu = *allowed().rbegin();
+  int ran_on = -1;
+  std::set<int> ran_with;
+  lynx::Thread thread([&] {
+    ran_on = ::sched_getcpu();
+    ran_with = allowed();
+  });
+  thread.setCpuAffinity(lynx::CpuAffinity({cpu}));
+  thread.start();
+  thread.join();
+  BOOST_CHECK_EQUAL(ran_on, cpu);
+  BOOST_CHECK(ran_with == std::set<int>{cpu});
+}
+
+BOOST_AUTO_TEST_CASE(testPinnedThreadPool) {
+  lynx::CpuAffinity cpus = lynx::CpuAffinity::physicalCores();
+  lynx::ThreadPool pool("pool");
+  pool.setCpuAffinity(cpus);
+  std::mutex mutex;
+  std::set<std::set<int>> pinned;
+  std::latch done(4);
+  pool.setThreadInitCallback([&] {
+    std::lock_guard<std::mutex> lock(mutex);
+    pinned.insert(allowed());
+    done.count_down();
+  });
+  pool.start(4);
+  done.wait();
+  pool.stop();
+
+  /// One CPU each, spread over as many CPUs as there are
+  BOOST_CHECK_EQUAL(pinned.size(), std::min<size_t>(4, cpus.cpus().size()));
+  for (const std::set<int> &set : pinned) {
+    BOOST_CHECK_EQUAL(set.size(), 1U);
+  }
+}
@@ -0,0 +1,42 @@
+#include "lynx/base/mono_time.h"
+
+#include <chrono>
+#include <thread>
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_CASE(testNow) {
+  lynx::MonoTime last = lynx::MonoTime::now();
+  BOOST_CHECK(last.valid());
+  BOOST_CHECK(!lynx::MonoTime::invalid().valid());
+  for (int i = 0; i < 100000; ++i) {
+    lynx::MonoTime now = lynx::MonoTime::now();
+    BOOST_REQUIRE(!(now < last));
+    last = now;
+  }
+
+  lynx::MonoTime start = lynx::MonoTime::now();
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  double slept = timeDiff(lynx::MonoTime::now(), start);
+  BOOST_CHECK_GE(slept, 0.02);
+  BOOST_CHECK_LT(slept, 0.5);
+}
+
+BOOST_AUTO_TEST_CASE(testCoarseNow) {
+  /// Behind the precise clock by less than a scheduler tick
+  lynx::MonoTime coarse = lynx::MonoTime::coarseNow();
+  lynx::MonoTime precise = lynx::MonoTime::now();
+  BOOST_CHECK(!(precise < coarse));
+  BOOST_CHECK_LT(timeDiff(precise, coarse), 0.05);
+}
+
+BOOST_AUTO_TEST_CASE(testArithmetic) {
+  lynx::MonoTime t(5 * 1000 * 1000);
+  lynx::MonoTime later = addTime(t, 1.5);
+  BOOST_CHECK_EQUAL(later.microsecs(), 6500 * 1000);
+  BOOST_CHECK_CLOSE(timeDiff(later, t), 1.5, 1e-9);
+  BOOST_CHECK(t < later);
+  BOOST_CHECK(addTime(later, -1.5) == t);
+}
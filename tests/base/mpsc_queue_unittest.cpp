@@ -0,0 +1,83 @@
+#include "lynx/base/mpsc_queue.h"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_CASE(testMpscQueueSingleThread) {
+  lynx::MpscQueue<std::unique_ptr<int>> queue;
+  BOOST_CHECK(queue.empty());
+  BOOST_CHECK(!queue.pop());
+
+  for (int i = 0; i < 3; ++i) {
+    queue.push(std::make_unique<int>(i));
+  }
+  BOOST_CHECK(!queue.empty());
+  BOOST_CHECK_EQUAL(queue.size(), 3);
+  for (int i = 0; i < 3; ++i) {
+    auto value = queue.pop();
+    BOOST_REQUIRE(value);
+    BOOST_CHECK_EQUAL(**value, i);
+  }
+  BOOST_CHECK(queue.empty());
+  BOOST_CHECK(!queue.pop());
+
+  /// Interleaved, the last node is detached through the stub each time
+  for (int i = 0; i < 100; ++i) {
+    queue.push(std::make_unique<int>(i));
+    auto value = queue.pop();
+    BOOST_REQUIRE(value);
+    BOOST_CHECK_EQUAL(**value, i);
+    BOOST_CHECK(queue.empty());
+  }
+
+  /// Values left in the queue are destroyed with it
+  auto shared = std::make_shared<int>(0);
+  {
+    lynx::MpscQueue<std::shared_ptr<int>> pending;
+    pending.push(shared);
+    pending.push(shared);
+    BOOST_CHECK_EQUAL(shared.use_count(), 3);
+  }
+  BOOST_CHECK_EQUAL(shared.use_count(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(testMpscQueueProducers) {
+  const int k_producers = 4;
+  const int k_per_producer = 200000;
+  lynx::MpscQueue<std::pair<int, int>> queue;
+
+  std::vector<std::thread> producers;
+  for (int p = 0; p < k_producers; ++p) {
+    producers.emplace_back([&queue, p] {
+      for (int i = 0; i < k_per_producer; ++i) {
+        queue.push({p, i});
+      }
+    });
+  }
+
+  /// Each producer's values come out in the order it pushed them
+  std::vector<int> next(k_producers, 0);
+  int popped = 0;
+  bool ordered = true;
+  while (popped < k_producers * k_per_producer) {
+    auto value = queue.pop();
+    if (!value) {
+      continue;
+    }
+    ordered = ordered && value->second == next[value->first];
+    next[value->first] = value->second + 1;
+    ++popped;
+  }
+  for (auto &producer : producers) {
+    producer.join();
+  }
+  BOOST_CHECK(ordered);
+  BOOST_CHECK(queue.empty());
+  BOOST_CHECK(!queue.pop());
+  BOOST_CHECK_EQUAL(queue.size(), 0);
+}
@@ -0,0 +1,118 @@
+#include "lynx/base/task.h"
+#include "lynx/base/thread_pool.h"
+#include "lynx/base/timestamp.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <latch>
+#include <memory>
+#include <new>
+#include <string>
+
+namespace {
+
+std::atomic<int64_t> g_allocations(0);
+
+/// What a callback posted for a connection typically captures
+struct Connection {
+  int64_t bytes_ = 0;
+};
+
+const int K_TASKS = 1000000;
+
+/// Queues `K_TASKS` tasks and runs them the way ThreadPool::take() used to
+/// (copied out of the queue) or does now (moved out).
+template <typename Fn, bool Move, typename Make> void queueAndRun(Make make) {
+  std::deque<Fn> queue;
+  int64_t allocations = g_allocations.load();
+  lynx::Timestamp start(lynx::Timestamp::now());
+  for (int i = 0; i < K_TASKS; ++i) {
+    queue.push_back(make(i));
+    Fn task;
+    if constexpr (Move) {
+      task = std::move(queue.front());
+    } else {
+      task = queue.front();
+    }
+    queue.pop_front();
+    task();
+  }
+  double seconds = lynx::timeDiff(lynx::Timestamp::now(), start);
+  printf("  %-28s %5.2f allocations/task %6.1f ns/task\n",
+         Move ? "lynx::Task, moved" : "std::function, copied",
+         static_cast<double>(g_allocations.load() - allocations) / K_TASKS,
+         seconds * 1e9 / K_TASKS);
+}
+
+template <typename Make> void bench(const char *name, Make make) {
+  printf("%s\n", name);
+  queueAndRun<std::function<void()>, false>(make);
+  queueAndRun<lynx::Task, true>(make);
+}
+
+void benchThreadPool() {
+  lynx::ThreadPool pool("BenchPool");
+  pool.start(1);
+  auto conn = std::make_shared<Connection>();
+  std::latch done(K_TASKS);
+  /// Warm the queue up so its blocks are reused
+  for (int i = 0; i < 1000; ++i) {
+    pool.run([] {});
+  }
+  int64_t allocations = g_allocations.load();
+  lynx::Timestamp start(lynx::Timestamp::now());
+  for (int i = 0; i < K_TASKS; ++i) {
+    pool.run([conn, msg = std::string("HTTP/1.1 200 OK"), &done] {
+      conn->bytes_ += msg.size();
+      done.count_down();
+    });
+  }
+  done.wait();
+  double seconds = lynx::timeDiff(lynx::Timestamp::now(), start);
+  printf("ThreadPool::run, connection + message\n");
+  printf("  %-28s %5.2f allocations/task %6.1f ns/task\n", "lynx::Task",
+         static_cast<double>(g_allocations.load() - allocations) / K_TASKS,
+         seconds * 1e9 / K_TASKS);
+  pool.stop();
+}
+
+} // namespace
+
+void *operator new(size_t size) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void *p = std::malloc(size == 0 ? 1 : size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+
+int main() {
+  printf("lynx::Task is %zu bytes, %zu of them inline storage\n",
+         sizeof(lynx::Task), lynx::Task::K_INLINE_SIZE);
+
+  auto conn = std::make_shared<Connection>();
+  bench("connection", [conn](int) {
+    return [conn] { ++conn->bytes_; };
+  });
+  bench("connection + message", [conn](int) {
+    return [conn, msg = std::string("HTTP/1.1 200 OK")] {
+      conn->bytes_ += msg.size();
+    };
+  });
+  bench("connection + timestamp + 3 ints", [conn](int i) {
+    return [conn, when = lynx::Timestamp::now(), i, j = i + 1, k = i + 2] {
+      conn->bytes_ += i + j + k + when.microsecsSinceEpoch() % 2;
+    };
+  });
+  bench("72 byte capture (heap for both)", [conn](int i) {
+    return [conn, a = std::to_array<int64_t>({i, i, i, i, i, i, i})] {
+      conn->bytes_ += a[0];
+    };
+  });
+  benchThreadPool();
+}
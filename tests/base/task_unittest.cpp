@@ -0,0 +1,77 @@
+#include "lynx/base/task.h"
+
+#include <array>
+#include <memory>
+#include <string>
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using lynx::Task;
+
+namespace {
+
+int g_calls = 0;
+
+void count() { ++g_calls; }
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(testTaskEmpty) {
+  Task task;
+  BOOST_CHECK(!task);
+  void (*fp)() = nullptr;
+  BOOST_CHECK(!Task(fp));
+  BOOST_CHECK(!Task(std::function<void()>()));
+  BOOST_CHECK(!Task(nullptr));
+
+  Task fn(count);
+  BOOST_REQUIRE(fn);
+  fn();
+  BOOST_CHECK_EQUAL(g_calls, 1);
+  fn = nullptr;
+  BOOST_CHECK(!fn);
+}
+
+BOOST_AUTO_TEST_CASE(testTaskMoveOnlyCapture) {
+  auto value = std::make_unique<int>(42);
+  int seen = 0;
+  Task task([&seen, v = std::move(value)] { seen = *v; });
+  BOOST_CHECK(Task::isInline<std::unique_ptr<int>>());
+
+  Task moved(std::move(task));
+  BOOST_CHECK(!task);
+  moved();
+  BOOST_CHECK_EQUAL(seen, 42);
+}
+
+BOOST_AUTO_TEST_CASE(testTaskInlineAndHeap) {
+  /// A connection and a short message fit inline
+  auto conn = std::make_shared<int>(0);
+  auto small = [conn, msg = std::string("hello")] { ++*conn; };
+  BOOST_CHECK(Task::isInline<decltype(small)>());
+
+  std::array<char, Task::K_INLINE_SIZE + 1> payload{};
+  auto large = [conn, payload] { *conn += payload.size(); };
+  BOOST_CHECK(!Task::isInline<decltype(large)>());
+
+  {
+    Task a(small);
+    Task b(large);
+    BOOST_CHECK_EQUAL(conn.use_count(), 5);
+    /// Moving keeps the captures alive, once
+    Task c(std::move(a));
+    Task d(std::move(b));
+    BOOST_CHECK_EQUAL(conn.use_count(), 5);
+    c();
+    d();
+    BOOST_CHECK_EQUAL(*conn, 1 + static_cast<int>(payload.size()));
+
+    /// Assigning destroys the previous callable
+    c = std::move(d);
+    BOOST_CHECK_EQUAL(conn.use_count(), 4);
+    c();
+  }
+  BOOST_CHECK_EQUAL(conn.use_count(), 3);
+}
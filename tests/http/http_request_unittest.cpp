@@ -3,6 +3,8 @@
 #include "lynx/net/buffer.h"
 
 #include <memory>
+#include <string>
+#include <utility>
 
 //#define BOOST_TEST_MODULE BufferTest
 #define BOOST_TEST_MAIN
@@ -50,23 +52,20 @@ BOOST_AUTO_TEST_CASE(testParseRequestInTwoPieces) {
                   "Host: www.lynx.com\r\n"
                   "\r\n");
 
-  std::unique_ptr<lynx::HttpContext> context(new lynx::HttpContext);
   for (size_t sz1 = 0; sz1 < all.size(); ++sz1) {
-    context = std::make_unique<lynx::HttpContext>();
-    context->start();
+    lynx::HttpContext context;
+    context.start();
     lynx::Buffer input;
     input.append(all.c_str(), sz1);
-    BOOST_CHECK(context->parseRequest(all.data(), all.size()));
-    BOOST_CHECK(context->isFinished());
+    BOOST_CHECK(context.parseRequest(&input));
+    BOOST_CHECK(!context.gotAll());
 
     size_t sz2 = all.size() - sz1;
     input.append(all.c_str() + sz1, sz2);
-    std::string msg(input.retrieveAllAsString());
-    context = std::make_unique<lynx::HttpContext>();
-    context->start();
-    BOOST_CHECK(context->parseRequest(msg.data(), msg.size()));
-    BOOST_CHECK(context->isFinished());
-    const lynx::HttpRequest &request = context->request();
+    BOOST_CHECK(context.parseRequest(&input));
+    BOOST_CHECK(context.gotAll());
+    BOOST_CHECK_EQUAL(context.requestLength(), all.size());
+    const lynx::HttpRequest &request = context.request();
     BOOST_CHECK(request.method() == lynx::HttpMethod::GET);
     BOOST_CHECK_EQUAL(request.path(), std::string("/index.html"));
     BOOST_CHECK_EQUAL(request.version(), 0x11);
@@ -75,6 +74,35 @@ BOOST_AUTO_TEST_CASE(testParseRequestInTwoPieces) {
   }
 }
 
+BOOST_AUTO_TEST_CASE(testParseRequestBodyInPieces) {
+  std::string all("POST /student HTTP/1.1\r\n"
+                  "Host: www.lynx.com\r\n"
+                  "Content-Length: 10\r\n"
+                  "\r\n"
+                  "0123456789"
+                  "GET /next HTTP/1.1\r\n");
+
+  lynx::HttpContext context;
+  context.start();
+  lynx::Buffer input;
+  input.append(all.c_str(), all.find("0123"));
+  BOOST_CHECK(context.parseRequest(&input));
+  BOOST_CHECK(context.isFinished());
+  BOOST_CHECK(!context.gotAll());
+
+  input.append(all.c_str() + all.find("0123"), all.size() - all.find("0123"));
+  BOOST_CHECK(context.parseRequest(&input));
+  BOOST_CHECK(context.gotAll());
+  BOOST_CHECK(context.request().body() == "0123456789");
+  input.retrieve(context.requestLength());
+  BOOST_CHECK_EQUAL(input.toString(), std::string("GET /next HTTP/1.1\r\n"));
+
+  context.reset();
+  BOOST_CHECK(context.parseRequest(&input));
+  BOOST_CHECK(!context.gotAll());
+  BOOST_CHECK_EQUAL(input.readableBytes(), 20);
+}
+
 BOOST_AUTO_TEST_CASE(testParseRequestEmptyHeaderValue) {
   lynx::HttpContext context;
   context.start();
@@ -94,3 +122,381 @@ BOOST_AUTO_TEST_CASE(testParseRequestEmptyHeaderValue) {
   BOOST_CHECK_EQUAL(request.getHeader("User-Agent"), std::string(""));
   BOOST_CHECK_EQUAL(request.getHeader("Accept-Encoding"), std::string(""));
 }
+
+BOOST_AUTO_TEST_CASE(testParseRequestBufferMoved) {
+  std::string all("GET /index.html?page=1 HTTP/1.1\r\n"
+                  "Host: www.lynx.com\r\n"
+                  "\r\n");
+
+  lynx::HttpContext context;
+  context.start();
+  std::string first(all.substr(0, all.find("Host")));
+  BOOST_CHECK(context.parseRequest(first.data(), first.size()));
+  BOOST_CHECK(!context.gotAll());
+
+  /// The second read sees the same bytes at another address
+  std::string second(all);
+  BOOST_CHECK(context.parseRequest(second.data(), second.size()));
+  BOOST_CHECK(context.gotAll());
+  first.assign(first.size(), 'x');
+
+  lynx::HttpRequest request = context.request();
+  BOOST_CHECK(request.path() == "/index.html");
+  BOOST_CHECK(request.query() == "page=1");
+  BOOST_CHECK(request.uri() == "/index.html?page=1");
+  BOOST_CHECK_EQUAL(request.getHeader("host"), std::string("www.lynx.com"));
+
+  request.materialize();
+  second.assign(second.size(), 'x');
+  BOOST_CHECK(request.path() == "/index.html");
+  BOOST_CHECK_EQUAL(request.getHeader("Host"), std::string("www.lynx.com"));
+  BOOST_CHECK_EQUAL(request.getParam("page"), std::string("1"));
+}
+
+BOOST_AUTO_TEST_CASE(testHttpHeaders) {
+  lynx::HttpHeaders<std::string, 2> headers;
+  headers.set("Host", "www.lynx.com");
+  headers.set("X-Trace-Id", "42");
+  headers.set("content-length", "10");
+  headers.set("Content-Length", "12");
+  BOOST_CHECK_EQUAL(headers.size(), 3);
+  BOOST_CHECK_EQUAL(*headers.find(lynx::HttpHeader::HOST), "www.lynx.com");
+  BOOST_CHECK_EQUAL(*headers.find("CONTENT-LENGTH"), "12");
+  BOOST_CHECK_EQUAL(*headers.find("x-trace-id"), "42");
+  BOOST_CHECK(headers.find(lynx::HttpHeader::COOKIE) == nullptr);
+
+  BOOST_CHECK(headers.erase("host"));
+  BOOST_CHECK(!headers.erase("host"));
+  BOOST_CHECK_EQUAL(headers.size(), 2);
+  BOOST_CHECK(headers.find(lynx::HttpHeader::HOST) == nullptr);
+  BOOST_CHECK_EQUAL(*headers.find(lynx::HttpHeader::CONTENT_LENGTH), "12");
+
+  std::string names;
+  for (const auto &[key, val] : headers) {
+    names += key + ";";
+  }
+  BOOST_CHECK_EQUAL(names, "X-Trace-Id;content-length;");
+}
+
+BOOST_AUTO_TEST_CASE(testLazyParamsAndCookies) {
+  lynx::HttpContext context;
+  context.start();
+  std::string msg("POST /login?page=2&name=a%20b HTTP/1.1\r\n"
+                  "Cookie: sid=abc; theme = dark\r\n"
+                  "Content-Type: application/x-www-form-urlencoded\r\n"
+                  "Content-Length: 21\r\n"
+                  "\r\n"
+                  "user=lynx&page=3&x=1+");
+
+  BOOST_CHECK(context.parseRequest(msg.data(), msg.size()));
+  BOOST_CHECK(context.gotAll());
+  const lynx::HttpRequest &request = context.request();
+
+  int64_t page = 0;
+  BOOST_CHECK(request.parseParam("page", &page));
+  BOOST_CHECK_EQUAL(page, 2);
+  std::string name;
+  BOOST_CHECK(request.parseParam("name", &name));
+  BOOST_CHECK_EQUAL(name, "a b");
+  BOOST_CHECK(request.parseParam("USER", &name));
+  BOOST_CHECK_EQUAL(name, "lynx");
+  BOOST_CHECK(!request.parseParam("user", &page));
+  BOOST_CHECK(!request.parseParam("missing", &name));
+
+  std::string theme;
+  BOOST_CHECK(request.parseCookie("theme", &theme));
+  BOOST_CHECK_EQUAL(theme, "dark");
+
+  BOOST_CHECK_EQUAL(request.params().size(), 4);
+  BOOST_CHECK_EQUAL(request.getParam("x"), "1 ");
+  BOOST_CHECK_EQUAL(request.getCookie("sid"), "abc");
+
+  lynx::HttpRequest copy = request;
+  copy.delParam("page");
+  BOOST_CHECK(!copy.parseParam("page", &page));
+}
+
+BOOST_AUTO_TEST_CASE(testParseParamMalformed) {
+  lynx::HttpContext context;
+  context.start();
+  std::string msg("GET /item?id=abc&n=12x&on=true&off=0&flag=yes HTTP/1.1\r\n"
+                  "\r\n");
+
+  BOOST_CHECK(context.parseRequest(msg.data(), msg.size()));
+  const lynx::HttpRequest &request = context.request();
+
+  int64_t id = 7;
+  BOOST_CHECK(!request.parseParam("id", &id));
+  BOOST_CHECK(!request.parseParam("n", &id));
+  bool on = false;
+  BOOST_CHECK(request.parseParam("on", &on));
+  BOOST_CHECK(on);
+  BOOST_CHECK(request.parseParam("off", &on));
+  BOOST_CHECK(!on);
+  BOOST_CHECK(!request.parseParam("flag", &on));
+}
+
+BOOST_AUTO_TEST_CASE(testParseChunkedBody) {
+  std::string all("POST /upload HTTP/1.1\r\n"
+                  "Transfer-Encoding: chunked\r\n"
+                  "\r\n"
+                  "5;ext=1\r\nhello\r\n"
+                  "7\r\n, lynx!\r\n"
+                  "0\r\n"
+                  "Trailer: x\r\n"
+                  "\r\n"
+                  "GET /next HTTP/1.1\r\n\r\n");
+
+  /// Feed one byte at a time, the header and decoded bytes leave the buffer
+  lynx::HttpContext context;
+  context.start();
+  lynx::Buffer input;
+  size_t fed = 0;
+  while (!context.gotAll()) {
+    BOOST_REQUIRE(fed < all.size());
+    input.append(all.data() + fed++, 1);
+    BOOST_REQUIRE(context.parseRequest(&input));
+  }
+  const lynx::HttpRequest &request = context.request();
+  BOOST_CHECK(request.body() == "hello, lynx!");
+  BOOST_REQUIRE(request.bodyStream());
+  BOOST_CHECK_EQUAL(request.bodyStream()->size(), 12);
+  BOOST_CHECK(request.getHeader("Transfer-Encoding") == "chunked");
+
+  input.retrieve(context.requestLength());
+  input.append(all.data() + fed, all.size() - fed);
+  context.reset();
+  BOOST_CHECK(context.parseRequest(&input));
+  BOOST_CHECK(context.gotAll());
+  BOOST_CHECK(context.request().path() == "/next");
+}
+
+BOOST_AUTO_TEST_CASE(testParseStreamedBodySpills) {
+  const std::string body(10000, 'b');
+  std::string all("PUT /file HTTP/1.1\r\n"
+                  "Content-Length: 10000\r\n"
+                  "\r\n" +
+                  body);
+
+  lynx::HttpContext context;
+  context.start();
+  context.setSpillThreshold(4096);
+  context.setBodyStreamSelector(
+      [](const lynx::HttpRequest &req, lynx::HttpBodyStream *) {
+        return req.path() == "/file";
+      });
+  lynx::Buffer input;
+  for (size_t off = 0; off < all.size(); off += 1000) {
+    input.append(all.data() + off, std::min<size_t>(1000, all.size() - off));
+    BOOST_REQUIRE(context.parseRequest(&input));
+    /// Never more than one read worth of body in the input buffer
+    BOOST_CHECK(input.readableBytes() <= 1000);
+  }
+  BOOST_REQUIRE(context.gotAll());
+  const lynx::HttpRequest &request = context.request();
+  BOOST_CHECK(request.path() == "/file");
+  BOOST_CHECK(request.body().empty());
+  BOOST_REQUIRE(request.bodyStream());
+  BOOST_CHECK(request.bodyStream()->spilled());
+  std::string read(body.size(), '\0');
+  BOOST_CHECK_EQUAL(request.bodyStream()->read(0, read.data(), read.size()),
+                    static_cast<ssize_t>(body.size()));
+  BOOST_CHECK_EQUAL(read, body);
+}
+
+BOOST_AUTO_TEST_CASE(testParseStreamedBodyChunkCallback) {
+  std::string all("POST /log HTTP/1.1\r\n"
+                  "Content-Length: 6\r\n"
+                  "\r\n"
+                  "abcdef");
+  std::string received;
+  lynx::HttpContext context;
+  context.start();
+  context.setBodyStreamSelector(
+      [&received](const lynx::HttpRequest &, lynx::HttpBodyStream *stream) {
+        stream->setChunkCallback(
+            [&received](std::string_view data) { received.append(data); });
+        return true;
+      });
+  lynx::Buffer input;
+  input.append(all.data(), all.size() - 4);
+  BOOST_CHECK(context.parseRequest(&input));
+  BOOST_CHECK_EQUAL(received, "ab");
+  input.append(all.data() + all.size() - 4, 4);
+  BOOST_CHECK(context.parseRequest(&input));
+  BOOST_CHECK(context.gotAll());
+  BOOST_CHECK_EQUAL(received, "abcdef");
+  BOOST_CHECK(context.request().body().empty());
+}
+
+BOOST_AUTO_TEST_CASE(testParseChunkedBodyInMemory) {
+  const std::string body(10000, 'c');
+  std::string all("POST /upload HTTP/1.1\r\n"
+                  "Transfer-Encoding: chunked\r\n"
+                  "\r\n"
+                  "2710\r\n" +
+                  body + "\r\n0\r\n\r\n");
+
+  /// Not selected, so below the max body size it never spills
+  lynx::HttpContext context;
+  context.start();
+  context.setSpillThreshold(4096);
+  lynx::Buffer input;
+  input.append(all.data(), all.size());
+  BOOST_REQUIRE(context.parseRequest(&input));
+  BOOST_REQUIRE(context.gotAll());
+  const lynx::HttpRequest &request = context.request();
+  BOOST_REQUIRE(request.bodyStream());
+  BOOST_CHECK(!request.bodyStream()->spilled());
+  BOOST_CHECK(request.body() == body);
+}
+
+BOOST_AUTO_TEST_CASE(testParseMaxBodySize) {
+  std::string sized("POST /upload HTTP/1.1\r\n"
+                    "Content-Length: 100\r\n"
+                    "\r\n");
+  lynx::HttpContext context;
+  context.start();
+  context.setMaxBodySize(50);
+  /// Refused from the header, before the body arrives
+  BOOST_CHECK(!context.parseRequest(sized.data(), sized.size()));
+  BOOST_CHECK(context.errorStatus() == lynx::HttpStatus::PAYLOAD_TOO_LARGE);
+
+  std::string chunked("POST /upload HTTP/1.1\r\n"
+                      "Transfer-Encoding: chunked\r\n"
+                      "\r\n"
+                      "40\r\n" +
+                      std::string(64, 'c') + "\r\n");
+  context.reset();
+  lynx::Buffer input;
+  input.append(chunked.data(), chunked.size());
+  BOOST_CHECK(!context.parseRequest(&input));
+  BOOST_CHECK(context.errorStatus() == lynx::HttpStatus::PAYLOAD_TOO_LARGE);
+
+  /// A body consumed as it arrives is not stored, so it is not limited
+  size_t received = 0;
+  context.reset();
+  context.setBodyStreamSelector(
+      [&received](const lynx::HttpRequest &, lynx::HttpBodyStream *stream) {
+        stream->setChunkCallback(
+            [&received](std::string_view data) { received += data.size(); });
+        return true;
+      });
+  std::string streamed = sized + std::string(100, 's');
+  BOOST_CHECK(context.parseRequest(streamed.data(), streamed.size()));
+  BOOST_CHECK(context.gotAll());
+  BOOST_CHECK_EQUAL(received, 100);
+
+  /// A selected body that is stored has its own limit, not the memory one
+  size_t max_size = 200;
+  context.reset();
+  context.setBodyStreamSelector(
+      [&max_size](const lynx::HttpRequest &, lynx::HttpBodyStream *stream) {
+        stream->setMaxSize(max_size);
+        return true;
+      });
+  BOOST_CHECK(context.parseRequest(streamed.data(), streamed.size()));
+  BOOST_CHECK(context.gotAll());
+  BOOST_CHECK_EQUAL(context.request().body(), std::string(100, 's'));
+  max_size = 80;
+  context.reset();
+  BOOST_CHECK(!context.parseRequest(sized.data(), sized.size()));
+  BOOST_CHECK(context.errorStatus() == lynx::HttpStatus::PAYLOAD_TOO_LARGE);
+
+  std::string bad("GET / HTTP/1.1\r\n"
+                  "Transfer-Encoding: chunked\r\n"
+                  "\r\n"
+                  "zz\r\n");
+  context.reset();
+  context.setBodyStreamSelector(nullptr);
+  BOOST_CHECK(!context.parseRequest(bad.data(), bad.size()));
+  BOOST_CHECK(context.errorStatus() == lynx::HttpStatus::BAD_REQUEST);
+}
+
+BOOST_AUTO_TEST_CASE(testParseMaxHeaders) {
+  const size_t max_headers = lynx::HttpContext::K_MAX_HEADERS;
+  std::string request("GET / HTTP/1.1\r\n");
+  for (size_t i = 0; i < max_headers; ++i) {
+    request += "X-Field-" + std::to_string(i) + ": v\r\n";
+  }
+  lynx::HttpContext context;
+  context.start();
+  std::string full = request + "\r\n";
+  BOOST_CHECK(context.parseRequest(full.data(), full.size()));
+  BOOST_CHECK(context.gotAll());
+  BOOST_CHECK_EQUAL(context.request().headers().size(), max_headers);
+
+  /// One field more is refused with 431 rather than 400
+  std::string over = request + "Host: lynx\r\n\r\n";
+  context.reset();
+  BOOST_CHECK(!context.parseRequest(over.data(), over.size()));
+  BOOST_CHECK(context.errorStatus() ==
+              lynx::HttpStatus::REQUEST_HEADER_FIELDS_TOO_LARGE);
+}
+
+BOOST_AUTO_TEST_CASE(testParseMaxHeaderSize) {
+  std::string partial("GET / HTTP/1.1\r\nX-Long: " + std::string(40, 'a'));
+  lynx::HttpContext context;
+  context.start();
+  context.setMaxHeaderSize(64);
+  /// An unfinished header within the limit waits for more bytes
+  BOOST_CHECK(context.parseRequest(partial.data(), partial.size()));
+  BOOST_CHECK(!context.gotAll());
+
+  /// The header never ends, so the buffered bytes are refused at the limit
+  partial += std::string(40, 'a');
+  BOOST_CHECK(!context.parseRequest(partial.data(), partial.size()));
+  BOOST_CHECK(context.errorStatus() ==
+              lynx::HttpStatus::REQUEST_HEADER_FIELDS_TOO_LARGE);
+
+  /// A whole header arriving at once is held to the same limit
+  std::string whole = partial + "\r\n\r\n";
+  context.reset();
+  BOOST_CHECK(!context.parseRequest(whole.data(), whole.size()));
+  BOOST_CHECK(context.errorStatus() ==
+              lynx::HttpStatus::REQUEST_HEADER_FIELDS_TOO_LARGE);
+}
+
+BOOST_AUTO_TEST_CASE(testParseBodyFraming) {
+  const std::pair<std::string, lynx::HttpStatus> cases[] = {
+      {"Content-Length: 12abc\r\n", lynx::HttpStatus::BAD_REQUEST},
+      {"Content-Length: 3, 4\r\n", lynx::HttpStatus::BAD_REQUEST},
+      {"Content-Length: -1\r\n", lynx::HttpStatus::BAD_REQUEST},
+      {"Content-Length: 4\r\nContent-Length: 4\r\n",
+       lynx::HttpStatus::BAD_REQUEST},
+      {"Transfer-Encoding: chunked\r\nContent-Length: 4\r\n",
+       lynx::HttpStatus::BAD_REQUEST},
+      {"Transfer-Encoding: chunked\r\nTransfer-Encoding: chunked\r\n",
+       lynx::HttpStatus::BAD_REQUEST},
+      {"Transfer-Encoding: gzip\r\n", lynx::HttpStatus::NOT_IMPLEMENTED},
+      {"Transfer-Encoding: gzip, chunked\r\n",
+       lynx::HttpStatus::NOT_IMPLEMENTED},
+      /// Legal, but longer than the max body size
+      {"Content-Length: 4294967296\r\n", lynx::HttpStatus::PAYLOAD_TOO_LARGE},
+      {"Content-Length: 99999999999999999999\r\n",
+       lynx::HttpStatus::PAYLOAD_TOO_LARGE},
+  };
+  lynx::HttpContext context;
+  context.start();
+  for (const auto &[headers, status] : cases) {
+    std::string request("POST /upload HTTP/1.1\r\n" + headers + "\r\n");
+    context.reset();
+    BOOST_TEST_CONTEXT(headers) {
+      BOOST_CHECK(!context.parseRequest(request.data(), request.size()));
+      BOOST_CHECK(context.errorStatus() == status);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testChunkedDecoderRejectsMalformed) {
+  auto sink = [](std::string_view) {};
+  lynx::HttpChunkedDecoder decoder;
+  BOOST_CHECK_EQUAL(decoder.decode("zz\r\n", 4, sink), -1);
+  decoder.reset();
+  BOOST_CHECK_EQUAL(decoder.decode("2\r\nabX\r\n", 8, sink), -1);
+  decoder.reset();
+  BOOST_CHECK_EQUAL(decoder.decode("2\r\nab\r\n0\r\n", 10, sink), 10);
+  BOOST_CHECK(!decoder.done());
+  BOOST_CHECK_EQUAL(decoder.decode("\r\n", 2, sink), 2);
+  BOOST_CHECK(decoder.done());
+}
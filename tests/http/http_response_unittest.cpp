@@ -0,0 +1,108 @@
+#include "lynx/http/http_response.h"
+#include "lynx/net/buffer.h"
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_CASE(testStatusLine) {
+  BOOST_CHECK(lynx::statusLine(lynx::HttpStatus::OK) == "HTTP/1.1 200 OK\r\n");
+  BOOST_CHECK(lynx::statusLine(lynx::HttpStatus::NOT_FOUND) ==
+              "HTTP/1.1 404 Not Found\r\n");
+  BOOST_CHECK(lynx::statusLine(static_cast<lynx::HttpStatus>(299)).empty());
+}
+
+BOOST_AUTO_TEST_CASE(testAppendToBuffer) {
+  /// Tue, 14 Nov 2023 22:13:20 GMT
+  lynx::Timestamp now(1700000000LL * lynx::Timestamp::K_MICRO_SECS_PER_SEC);
+  lynx::HttpResponse response(false);
+  response.setStatusCode(lynx::HttpStatus::OK);
+  response.setContentType("text/plain");
+  response.addHeader("Server", "lynx");
+  response.addHeader("X-Bad", "a\r\nSet-Cookie: x=1");
+  response.setBody("hello");
+
+  lynx::Buffer output;
+  response.appendToBuffer(&output, now);
+  BOOST_CHECK_EQUAL(output.retrieveAllAsString(),
+                    "HTTP/1.1 200 OK\r\n"
+                    "Date: Tue, 14 Nov 2023 22:13:20 GMT\r\n"
+                    "Content-Length: 5\r\n"
+                    "Connection: Keep-Alive\r\n"
+                    "Content-Type: text/plain\r\n"
+                    "Server: lynx\r\n"
+                    "\r\n"
+                    "hello");
+
+  lynx::HttpResponse unknown(true);
+  unknown.setStatusCode(static_cast<lynx::HttpStatus>(299));
+  unknown.appendToBuffer(&output, now);
+  BOOST_CHECK_EQUAL(output.retrieveAllAsString(),
+                    "HTTP/1.1 299 unknown\r\n"
+                    "Date: Tue, 14 Nov 2023 22:13:20 GMT\r\n"
+                    "Connection: close\r\n"
+                    "\r\n");
+
+  /// Statuses without a body have no Content-Length
+  lynx::HttpResponse no_content(false);
+  no_content.setStatusCode(lynx::HttpStatus::NO_CONTENT);
+  no_content.appendToBuffer(&output, now);
+  BOOST_CHECK_EQUAL(output.retrieveAllAsString(),
+                    "HTTP/1.1 204 No Content\r\n"
+                    "Date: Tue, 14 Nov 2023 22:13:20 GMT\r\n"
+                    "Connection: Keep-Alive\r\n"
+                    "\r\n");
+}
+
+BOOST_AUTO_TEST_CASE(testStreamingHeader) {
+  lynx::Timestamp now(1700000000LL * lynx::Timestamp::K_MICRO_SECS_PER_SEC);
+  lynx::HttpResponse response(false);
+  response.setStatusCode(lynx::HttpStatus::OK);
+  response.setBody("first");
+  response.setStreamCallback([](const lynx::HttpStreamWriterPtr &) {});
+  BOOST_CHECK(response.isStreaming());
+
+  lynx::Buffer output;
+  response.appendToBuffer(&output, now);
+  lynx::HttpStreamWriter::appendChunk(&output, std::string(26, 'z'));
+  BOOST_CHECK_EQUAL(output.retrieveAllAsString(),
+                    "HTTP/1.1 200 OK\r\n"
+                    "Date: Tue, 14 Nov 2023 22:13:20 GMT\r\n"
+                    "Connection: Keep-Alive\r\n"
+                    "Transfer-Encoding: chunked\r\n"
+                    "\r\n"
+                    "5\r\nfirst\r\n"
+                    "1a\r\n" +
+                        std::string(26, 'z') + "\r\n");
+}
+
+BOOST_AUTO_TEST_CASE(testStreamingFraming) {
+  lynx::Timestamp now(1700000000LL * lynx::Timestamp::K_MICRO_SECS_PER_SEC);
+  lynx::HttpResponse http10(true);
+  http10.setStatusCode(lynx::HttpStatus::OK);
+  http10.setBody("first");
+  http10.setStreamCallback([](const lynx::HttpStreamWriterPtr &) {});
+  http10.setStreamFraming(lynx::HttpStreamWriter::CLOSE_DELIMITED);
+
+  lynx::Buffer output;
+  http10.appendToBuffer(&output, now);
+  BOOST_CHECK_EQUAL(output.retrieveAllAsString(),
+                    "HTTP/1.1 200 OK\r\n"
+                    "Date: Tue, 14 Nov 2023 22:13:20 GMT\r\n"
+                    "Connection: close\r\n"
+                    "\r\n"
+                    "first");
+
+  lynx::HttpResponse head(false);
+  head.setStatusCode(lynx::HttpStatus::OK);
+  head.setBody("first");
+  head.setStreamCallback([](const lynx::HttpStreamWriterPtr &) {});
+  head.setStreamFraming(lynx::HttpStreamWriter::NO_BODY);
+  head.appendToBuffer(&output, now);
+  BOOST_CHECK_EQUAL(output.retrieveAllAsString(),
+                    "HTTP/1.1 200 OK\r\n"
+                    "Date: Tue, 14 Nov 2023 22:13:20 GMT\r\n"
+                    "Connection: Keep-Alive\r\n"
+                    "Transfer-Encoding: chunked\r\n"
+                    "\r\n");
+}
@@ -0,0 +1,299 @@
+#include "lynx/http/http_request.h"
+#include "lynx/http/http_response.h"
+#include "lynx/http/http_server.h"
+#include "lynx/logger/logging.h"
+#include "lynx/net/event_loop.h"
+#include "lynx/net/uring_poller.h"
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
+#include <sys/uio.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * System calls made by the server loop per request of the http_server_test
+ * workload, under each poller backend.
+ *
+ * lynx is linked statically and the calls it makes are routed through the
+ * wrappers below (-Wl,--wrap=, see CMakeLists.txt), which count them in the
+ * server thread only, so the clients of the same process do not count.
+ */
+namespace {
+
+thread_local bool t_counting = false;
+std::atomic<long> g_syscalls(0);
+
+void count() {
+  if (t_counting) {
+    g_syscalls.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+} // namespace
+
+extern "C" {
+
+ssize_t __real_read(int fd, void *buf, size_t count);
+ssize_t __real_readv(int fd, const struct iovec *iov, int iovcnt);
+ssize_t __real_write(int fd, const void *buf, size_t count);
+ssize_t __real_writev(int fd, const struct iovec *iov, int iovcnt);
+ssize_t __real_sendfile(int outFd, int inFd, off_t *offset, size_t count);
+int __real_accept4(int fd, struct sockaddr *addr, socklen_t *len, int flags);
+int __real_close(int fd);
+int __real_shutdown(int fd, int how);
+int __real_setsockopt(int fd, int level, int name, const void *val,
+                      socklen_t len);
+int __real_getsockopt(int fd, int level, int name, void *val, socklen_t *len);
+int __real_getsockname(int fd, struct sockaddr *addr, socklen_t *len);
+int __real_epoll_wait(int epfd, struct epoll_event *events, int maxEvents,
+                      int timeout);
+int __real_epoll_ctl(int epfd, int op, int fd, struct epoll_event *event);
+int __real_timerfd_settime(int fd, int flags, const struct itimerspec *value,
+                           struct itimerspec *old);
+long __real_syscall(long number, ...);
+
+ssize_t __wrap_read(int fd, void *buf, size_t count) {
+  ::count();
+  return __real_read(fd, buf, count);
+}
+ssize_t __wrap_readv(int fd, const struct iovec *iov, int iovcnt) {
+  ::count();
+  return __real_readv(fd, iov, iovcnt);
+}
+ssize_t __wrap_write(int fd, const void *buf, size_t count) {
+  ::count();
+  return __real_write(fd, buf, count);
+}
+ssize_t __wrap_writev(int fd, const struct iovec *iov, int iovcnt) {
+  ::count();
+  return __real_writev(fd, iov, iovcnt);
+}
+ssize_t __wrap_sendfile(int outFd, int inFd, off_t *offset, size_t count) {
+  ::count();
+  return __real_sendfile(outFd, inFd, offset, count);
+}
+int __wrap_accept4(int fd, struct sockaddr *addr, socklen_t *len, int flags) {
+  ::count();
+  return __real_accept4(fd, addr, len, flags);
+}
+int __wrap_close(int fd) {
+  ::count();
+  return __real_close(fd);
+}
+int __wrap_shutdown(int fd, int how) {
+  ::count();
+  return __real_shutdown(fd, how);
+}
+int __wrap_setsockopt(int fd, int level, int name, const void *val,
+                      socklen_t len) {
+  ::count();
+  return __real_setsockopt(fd, level, name, val, len);
+}
+int __wrap_getsockopt(int fd, int level, int name, void *val, socklen_t *len) {
+  ::count();
+  return __real_getsockopt(fd, level, name, val, len);
+}
+int __wrap_getsockname(int fd, struct sockaddr *addr, socklen_t *len) {
+  ::count();
+  return __real_getsockname(fd, addr, len);
+}
+int __wrap_epoll_wait(int epfd, struct epoll_event *events, int maxEvents,
+                      int timeout) {
+  ::count();
+  return __real_epoll_wait(epfd, events, maxEvents, timeout);
+}
+int __wrap_epoll_ctl(int epfd, int op, int fd, struct epoll_event *event) {
+  ::count();
+  return __real_epoll_ctl(epfd, op, fd, event);
+}
+int __wrap_timerfd_settime(int fd, int flags, const struct itimerspec *value,
+                           struct itimerspec *old) {
+  ::count();
+  return __real_timerfd_settime(fd, flags, value, old);
+}
+/// io_uring_enter(2) and friends, UringPoller calls them through syscall(2)
+long __wrap_syscall(long number, ...) {
+  va_list args;
+  va_start(args, number);
+  long a[6];
+  for (long &arg : a) {
+    arg = va_arg(args, long);
+  }
+  va_end(args);
+  ::count();
+  return __real_syscall(number, a[0], a[1], a[2], a[3], a[4], a[5]);
+}
+
+} // extern "C"
+
+namespace {
+
+const uint16_t K_PORT = 19200;
+
+void onRequest(const lynx::HttpRequest &req, lynx::HttpResponse *resp) {
+  if (req.path() == "/") {
+    resp->setStatusCode(lynx::HttpStatus::OK);
+    resp->setContentType("text/html");
+    resp->addHeader("Server", "lynx");
+    resp->setBody("<html><head><title>This is title</title></head>"
+                  "<body><h1>Hello</h1>Now is " +
+                  lynx::Timestamp::now().toFormattedString() +
+                  "</body></html>");
+  } else {
+    resp->setStatusCode(lynx::HttpStatus::NOT_FOUND);
+    resp->setCloseConnection(true);
+  }
+}
+
+int connectTo(uint16_t port) {
+  int sockfd = ::socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (::connect(sockfd, reinterpret_cast<struct sockaddr *>(&addr),
+                sizeof(addr)) != 0) {
+    ::close(sockfd);
+    return -1;
+  }
+  return sockfd;
+}
+
+/// Sends one request and reads its response, false if the server closed.
+bool roundTrip(int sockfd, const std::string &request) {
+  if (::write(sockfd, request.data(), request.size()) !=
+      static_cast<ssize_t>(request.size())) {
+    return false;
+  }
+  std::string response;
+  char buf[4096];
+  size_t header_end = std::string::npos;
+  size_t total = 0;
+  while (header_end == std::string::npos || response.size() < total) {
+    ssize_t n = ::read(sockfd, buf, sizeof(buf));
+    if (n <= 0) {
+      return header_end != std::string::npos;
+    }
+    response.append(buf, n);
+    if (header_end == std::string::npos) {
+      header_end = response.find("\r\n\r\n");
+      if (header_end != std::string::npos) {
+        size_t pos = response.find("Content-Length: ");
+        size_t length = 0;
+        if (pos != std::string::npos) {
+          length = std::stoul(response.substr(pos + 16));
+        }
+        total = header_end + 4 + length;
+      }
+    }
+  }
+  return true;
+}
+
+struct Result {
+  long requests_;
+  long syscalls_;
+  double seconds_;
+};
+
+/// Runs `clients` against a single-loop server, each making `requests`
+/// requests, on one connection each if `keepAlive`, one per request if not.
+Result run(const char *backend, int clients, int requests, bool keepAlive) {
+  ::setenv("LYNX_POLLER", backend, 1);
+  lynx::EventLoop *server_loop = nullptr;
+  std::atomic<bool> ready(false);
+  std::thread server_thread([&] {
+    lynx::EventLoop loop;
+    lynx::HttpServer server(&loop, lynx::InetAddress(K_PORT, true), "bench");
+    server.setHttpCallback(onRequest);
+    server.start();
+    server_loop = &loop;
+    t_counting = true;
+    ready = true;
+    loop.loop();
+    t_counting = false;
+  });
+  while (!ready) {
+    std::this_thread::yield();
+  }
+
+  g_syscalls = 0;
+  std::atomic<long> done(0);
+  lynx::Timestamp start(lynx::Timestamp::now());
+  std::vector<std::thread> threads;
+  for (int c = 0; c < clients; ++c) {
+    threads.emplace_back([&] {
+      const std::string request(
+          std::string("GET / HTTP/1.1\r\nHost: localhost\r\n") +
+          (keepAlive ? "" : "Connection: close\r\n") + "\r\n");
+      int sockfd = keepAlive ? connectTo(K_PORT) : -1;
+      for (int i = 0; i < requests; ++i) {
+        if (!keepAlive) {
+          sockfd = connectTo(K_PORT);
+        }
+        if (sockfd >= 0 && roundTrip(sockfd, request)) {
+          ++done;
+        }
+        if (!keepAlive && sockfd >= 0) {
+          ::close(sockfd);
+        }
+      }
+      if (keepAlive && sockfd >= 0) {
+        ::close(sockfd);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  double seconds = timeDiff(lynx::Timestamp::now(), start);
+  long syscalls = g_syscalls;
+  server_loop->queueInLoop([server_loop] { server_loop->quit(); });
+  server_thread.join();
+  return {done, syscalls, seconds};
+}
+
+} // namespace
+
+int main() {
+  lynx::Logger::setLogLevel(lynx::Logger::WARN);
+  std::vector<const char *> backends = {"epoll"};
+  if (lynx::UringPoller::available()) {
+    backends.push_back("io_uring");
+  } else {
+    printf("io_uring is not available, epoll only\n");
+  }
+
+  struct Workload {
+    const char *name_;
+    int clients_;
+    int requests_;
+    bool keep_alive_;
+  };
+  const Workload workloads[] = {
+      {"keep-alive, 8 clients", 8, 5000, true},
+      {"keep-alive, 64 clients", 64, 1000, true},
+      {"connection per request", 4, 2000, false},
+  };
+  for (const Workload &workload : workloads) {
+    for (const char *backend : backends) {
+      Result result = run(backend, workload.clients_, workload.requests_,
+                          workload.keep_alive_);
+      printf("%-24s %-9s %6.2f syscalls/request %9.0f requests/s (%ld)\n",
+             workload.name_, backend,
+             static_cast<double>(result.syscalls_) / result.requests_,
+             result.requests_ / result.seconds_, result.requests_);
+    }
+  }
+}
@@ -99,13 +99,13 @@ void onRequest(const lynx::HttpRequest &req, lynx::HttpResponse *resp) {
   }
 
   auto method = req.method();
-  auto &path = req.path();
+  auto path = req.path();
 
   bool flag = false;
   for (auto &[pair, handler] : g_route_table) {
     if (method == pair.first) {
       std::regex path_regex(pair.second);
-      bool match = std::regex_match(path, path_regex);
+      bool match = std::regex_match(path.begin(), path.end(), path_regex);
       if (match) {
         flag = true;
         handler(req, resp);
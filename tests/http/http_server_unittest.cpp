@@ -0,0 +1,205 @@
+#include "lynx/http/http_request.h"
+#include "lynx/http/http_response.h"
+#include "lynx/http/http_server.h"
+#include "lynx/net/event_loop.h"
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+/// Sends each of `requests` on one connection, `pause_ms` apart, and reads
+/// until the server closes. `first` receives what the first read returned.
+std::string exchange(uint16_t port, const std::vector<std::string> &requests,
+                     int pause_ms = 0, std::string *first = nullptr) {
+  int sockfd = ::socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  std::string received;
+  if (::connect(sockfd, reinterpret_cast<struct sockaddr *>(&addr),
+                sizeof(addr)) == 0) {
+    for (const std::string &request : requests) {
+      ssize_t n = ::write(sockfd, request.data(), request.size());
+      (void)n;
+      std::this_thread::sleep_for(std::chrono::milliseconds(pause_ms));
+    }
+    char buf[65536];
+    ssize_t n;
+    while ((n = ::read(sockfd, buf, sizeof(buf))) > 0) {
+      if (first != nullptr && received.empty()) {
+        first->assign(buf, n);
+      }
+      received.append(buf, n);
+    }
+  }
+  ::close(sockfd);
+  return received;
+}
+
+/// Runs an HttpServer with `callback` until one client exchanged `requests`,
+/// returns what it received.
+std::string serve(uint16_t port, const lynx::HttpServer::HttpCallback &callback,
+                  const std::vector<std::string> &requests, int pause_ms = 0,
+                  std::string *first = nullptr) {
+  lynx::EventLoop loop;
+  lynx::HttpServer server(&loop, lynx::InetAddress(port, true), "test");
+  server.setHttpCallback(callback);
+  server.start();
+  std::string received;
+  std::thread client([&] {
+    received = exchange(port, requests, pause_ms, first);
+    loop.queueInLoop([&loop] { loop.quit(); });
+  });
+  loop.loop();
+  client.join();
+  return received;
+}
+
+/// Streams "ab" from the loop thread.
+void streamAb(const lynx::HttpRequest &, lynx::HttpResponse *resp) {
+  resp->setStatusCode(lynx::HttpStatus::OK);
+  resp->setStreamCallback([](const lynx::HttpStreamWriterPtr &stream) {
+    stream->write("a");
+    stream->write("b");
+    stream->end();
+  });
+}
+
+std::string bodyOf(const std::string &response) {
+  size_t end = response.find("\r\n\r\n");
+  return end == std::string::npos ? "" : response.substr(end + 4);
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(testStreamToHttp10) {
+  std::string received =
+      serve(19139, streamAb, {"GET /stream HTTP/1.0\r\n\r\n"});
+  BOOST_CHECK(received.starts_with("HTTP/1.1 200 OK\r\n"));
+  BOOST_CHECK(received.find("Connection: close\r\n") != std::string::npos);
+  BOOST_CHECK(received.find("Transfer-Encoding") == std::string::npos);
+  /// Raw bytes, ended by the close
+  BOOST_CHECK_EQUAL(bodyOf(received), "ab");
+}
+
+BOOST_AUTO_TEST_CASE(testStreamToHead) {
+  std::string received = serve(
+      19140, streamAb, {"HEAD /stream HTTP/1.1\r\nConnection: close\r\n\r\n"});
+  BOOST_CHECK(received.find("Transfer-Encoding: chunked\r\n") !=
+              std::string::npos);
+  BOOST_CHECK_EQUAL(bodyOf(received), "");
+}
+
+BOOST_AUTO_TEST_CASE(testStreamHoldsPipelinedRequest) {
+  std::thread producer;
+  auto callback = [&producer](const lynx::HttpRequest &req,
+                              lynx::HttpResponse *resp) {
+    resp->setStatusCode(lynx::HttpStatus::OK);
+    if (req.path() != "/stream") {
+      resp->setBody("next");
+      return;
+    }
+    /// Ends well after the next request arrived
+    resp->setStreamCallback([&producer](const lynx::HttpStreamWriterPtr &s) {
+      if (!producer.joinable()) {
+        producer = std::thread([s] {
+          std::this_thread::sleep_for(std::chrono::milliseconds(200));
+          s->write("streamed");
+          s->end();
+        });
+      }
+    });
+  };
+  std::string received =
+      serve(19141, callback,
+            {"GET /stream HTTP/1.1\r\n\r\n",
+             "GET /next HTTP/1.1\r\nConnection: close\r\n\r\n"},
+            50);
+  producer.join();
+
+  size_t streamed = received.find("8\r\nstreamed\r\n0\r\n\r\n");
+  size_t next = received.find("next");
+  BOOST_CHECK(streamed != std::string::npos);
+  BOOST_CHECK(next != std::string::npos);
+  BOOST_CHECK_GT(next, streamed);
+}
+
+BOOST_AUTO_TEST_CASE(testPipelinedResponsesInOneFlush) {
+  std::vector<std::string> served;
+  auto callback = [&served](const lynx::HttpRequest &req,
+                            lynx::HttpResponse *resp) {
+    served.emplace_back(req.path());
+    /// Responses sent one by one would reach the client before this returns
+    if (req.path() == "/2") {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    resp->setStatusCode(lynx::HttpStatus::OK);
+    resp->setBody("body" + std::string(req.path()));
+  };
+  std::string first;
+  std::string received =
+      serve(19143, callback,
+            {"GET /1 HTTP/1.1\r\n\r\n"
+             "GET /2 HTTP/1.1\r\n\r\n"
+             "GET /3 HTTP/1.1\r\nConnection: close\r\n\r\n"},
+            0, &first);
+
+  BOOST_CHECK(served == std::vector<std::string>({"/1", "/2", "/3"}));
+  size_t one = received.find("body/1");
+  size_t two = received.find("body/2");
+  size_t three = received.find("body/3");
+  BOOST_CHECK(one != std::string::npos);
+  BOOST_CHECK(one < two && two < three && three != std::string::npos);
+  BOOST_CHECK_EQUAL(first, received);
+}
+
+BOOST_AUTO_TEST_CASE(testPipelineStopsAfterClose) {
+  std::vector<std::string> served;
+  auto callback = [&served](const lynx::HttpRequest &req,
+                            lynx::HttpResponse *resp) {
+    served.emplace_back(req.path());
+    resp->setStatusCode(lynx::HttpStatus::OK);
+    resp->setBody("body" + std::string(req.path()));
+  };
+  std::string received =
+      serve(19144, callback,
+            {"GET /1 HTTP/1.1\r\nConnection: close\r\n\r\n"
+             "GET /2 HTTP/1.1\r\n\r\n"});
+
+  BOOST_CHECK(served == std::vector<std::string>({"/1"}));
+  BOOST_CHECK(received.find("body/1") != std::string::npos);
+  BOOST_CHECK(received.find("body/2") == std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(testPipelineBadRequestAfterValid) {
+  std::vector<std::string> served;
+  auto callback = [&served](const lynx::HttpRequest &req,
+                            lynx::HttpResponse *resp) {
+    served.emplace_back(req.path());
+    resp->setStatusCode(lynx::HttpStatus::OK);
+    resp->setBody("body" + std::string(req.path()));
+  };
+  std::string received = serve(19145, callback,
+                               {"GET /1 HTTP/1.1\r\n\r\n"
+                                "GET /2 HTTP/1.1\r\n\r\n"
+                                "BROKEN\r\n\r\n"});
+
+  BOOST_CHECK(served == std::vector<std::string>({"/1", "/2"}));
+  size_t one = received.find("body/1");
+  size_t two = received.find("body/2");
+  size_t bad = received.find("HTTP/1.1 400 Bad Request\r\n");
+  BOOST_CHECK(one != std::string::npos);
+  BOOST_CHECK(one < two && two < bad && bad != std::string::npos);
+  /// Nothing follows the 400, the connection is closed
+  BOOST_CHECK(received.ends_with("HTTP/1.1 400 Bad Request\r\n\r\n"));
+}
@@ -0,0 +1,189 @@
+#include "lynx/http/http_stream_writer.h"
+#include "lynx/net/event_loop.h"
+#include "lynx/net/tcp_connection.h"
+#include "lynx/net/tcp_server.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+/// Connects to `port` on loopback and reads until the server closes.
+std::string readAll(uint16_t port) {
+  int sockfd = ::socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  std::string received;
+  if (::connect(sockfd, reinterpret_cast<struct sockaddr *>(&addr),
+                sizeof(addr)) == 0) {
+    char buf[65536];
+    ssize_t n;
+    while ((n = ::read(sockfd, buf, sizeof(buf))) > 0) {
+      received.append(buf, n);
+    }
+  }
+  ::close(sockfd);
+  return received;
+}
+
+/// Undoes the chunked framing, empty if it is broken or has no last chunk.
+std::string unchunk(const std::string &body) {
+  std::string data;
+  size_t pos = 0;
+  while (true) {
+    size_t eol = body.find("\r\n", pos);
+    if (eol == std::string::npos) {
+      return "";
+    }
+    size_t len = std::stoul(body.substr(pos, eol - pos), nullptr, 16);
+    if (len == 0) {
+      return body.compare(eol, 4, "\r\n\r\n") == 0 ? data : "";
+    }
+    if (body.compare(eol + 2 + len, 2, "\r\n") != 0) {
+      return "";
+    }
+    data.append(body, eol + 2, len);
+    pos = eol + 2 + len + 2;
+  }
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(testStreamFollowsMigration) {
+  const int k_chunks = 2000;
+
+  /// Outlives the server, whose IO threads use it
+  std::mutex mutex;
+  std::vector<lynx::EventLoop *> loops;
+  std::thread producer;
+  lynx::EventLoop loop;
+  lynx::TcpServer server(&loop, lynx::InetAddress(19135, true), "test");
+  server.setThreadNum(2);
+  server.setThreadInitCallback([&](lynx::EventLoop *ioLoop) {
+    std::lock_guard<std::mutex> lock(mutex);
+    loops.push_back(ioLoop);
+  });
+  server.setConnectionCallback([&](const lynx::TcpConnectionPtr &conn) {
+    if (!conn->connected()) {
+      return;
+    }
+    auto stream = std::make_shared<lynx::HttpStreamWriter>(
+        conn, [](const lynx::HttpStreamWriterPtr &) {});
+    stream->setEndCallback([conn] { conn->shutdown(); });
+    /// Written from another thread while the connection moves back and
+    /// forth between the IO loops
+    producer = std::thread([&, conn, stream] {
+      for (int i = 0; i < k_chunks; ++i) {
+        stream->write(std::to_string(i) + ",");
+        if (i % 50 == 0) {
+          conn->migrateTo(conn->getLoop() == loops[0] ? loops[1] : loops[0]);
+        }
+      }
+      stream->end();
+    });
+  });
+  server.start();
+
+  std::string received;
+  std::thread client([&] {
+    received = readAll(19135);
+    loop.queueInLoop([&loop] { loop.quit(); });
+  });
+  loop.loop();
+  client.join();
+  producer.join();
+
+  std::string expected;
+  for (int i = 0; i < k_chunks; ++i) {
+    expected += std::to_string(i) + ",";
+  }
+  BOOST_CHECK(unchunk(received) == expected);
+}
+
+BOOST_AUTO_TEST_CASE(testCrossThreadBackpressure) {
+  const size_t k_high_water = 64 * 1024;
+  const size_t k_total = 8 * 1024 * 1024;
+  const std::string chunk(4096, 'x');
+
+  std::thread producer;
+  std::atomic<size_t> most_pending{0};
+  lynx::EventLoop loop;
+  lynx::TcpServer server(&loop, lynx::InetAddress(19142, true), "test");
+  server.setConnectionCallback([&](const lynx::TcpConnectionPtr &conn) {
+    if (!conn->connected()) {
+      return;
+    }
+    auto stream = std::make_shared<lynx::HttpStreamWriter>(
+        conn, [](const lynx::HttpStreamWriterPtr &) {});
+    /// As HttpServer does: pause at the high water mark, resume once drained
+    conn->setHighWaterMarkCallback(
+        [stream](const lynx::TcpConnectionPtr &, size_t) { stream->pause(); },
+        k_high_water);
+    conn->setWriteCompleteCallback(
+        [stream](const lynx::TcpConnectionPtr &) { stream->resume(); });
+    lynx::TimerId sampler = loop.runEvery(0.001, [&, conn] {
+      most_pending = std::max(most_pending.load(), conn->pendingBytes());
+    });
+    stream->setEndCallback([&, conn, sampler] {
+      loop.cancel(sampler);
+      conn->shutdown();
+    });
+    /// Writes only while writable, to a client that does not read at first
+    producer = std::thread([&, stream] {
+      for (size_t sent = 0; sent < k_total;) {
+        if (stream->writable()) {
+          stream->write(chunk);
+          sent += chunk.size();
+        } else {
+          std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+      }
+      stream->end();
+    });
+  });
+  server.start();
+
+  std::string received;
+  std::thread client([&] {
+    int sockfd = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(19142);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    /// A small window, so the output buffer fills up instead of the socket
+    int rcvbuf = 16 * 1024;
+    ::setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    if (::connect(sockfd, reinterpret_cast<struct sockaddr *>(&addr),
+                  sizeof(addr)) == 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(300));
+      char buf[65536];
+      ssize_t n;
+      while ((n = ::read(sockfd, buf, sizeof(buf))) > 0) {
+        received.append(buf, n);
+      }
+    }
+    ::close(sockfd);
+    loop.queueInLoop([&loop] { loop.quit(); });
+  });
+  loop.loop();
+  client.join();
+  producer.join();
+
+  BOOST_CHECK_EQUAL(unchunk(received).size(), k_total);
+  /// Bounded by the mark plus what was queued before the pause was seen
+  BOOST_CHECK_GT(most_pending.load(), 0U);
+  BOOST_CHECK_LT(most_pending.load(), 4 * k_high_water);
+}
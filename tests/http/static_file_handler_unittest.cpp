@@ -0,0 +1,189 @@
+#include "lynx/http/http_request.h"
+#include "lynx/http/http_response.h"
+#include "lynx/http/static_file_handler.h"
+#include "lynx/net/buffer.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <filesystem>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+/// A temporary directory holding "app.js" and "sub/index.html"
+struct StaticRoot {
+  StaticRoot() {
+    char tmpl[] = "/tmp/lynx_static_XXXXXX";
+    dir_ = mkdtemp(tmpl);
+    writeFile("/app.js", "console.log(1);\n");
+    mkdir((dir_ + "/sub").c_str(), 0755);
+    writeFile("/sub/index.html", "<html></html>");
+  }
+  ~StaticRoot() { std::filesystem::remove_all(dir_); }
+
+  void writeFile(const std::string &name, const std::string &content) {
+    FILE *fp = fopen((dir_ + name).c_str(), "w");
+    fwrite(content.data(), 1, content.size(), fp);
+    fclose(fp);
+  }
+
+  std::string dir_;
+};
+
+lynx::HttpRequest makeRequest(lynx::HttpMethod method, std::string_view path) {
+  lynx::HttpRequest req;
+  req.setMethod(method);
+  req.setPath(path);
+  return req;
+}
+
+std::string readBody(const lynx::HttpResponse &resp) {
+  const lynx::HttpResponse::FileBody &body = resp.fileBody();
+  std::string content(body.length_, '\0');
+  ssize_t n = pread(body.fd_, content.data(), content.size(), body.offset_);
+  content.resize(n < 0 ? 0 : n);
+  return content;
+}
+
+std::string headerOf(const lynx::HttpResponse &resp, std::string_view key) {
+  return std::string(resp.getHeader(key));
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(testServeFile) {
+  StaticRoot root;
+  lynx::StaticFileHandler handler(root.dir_, "/static");
+
+  auto req = makeRequest(lynx::HttpMethod::GET, "/static/app.js");
+  lynx::HttpResponse resp(false);
+  handler(req, &resp);
+  BOOST_CHECK(resp.statusCode() == lynx::HttpStatus::OK);
+  BOOST_CHECK(resp.hasFileBody());
+  BOOST_CHECK_EQUAL(readBody(resp), "console.log(1);\n");
+  BOOST_CHECK_EQUAL(headerOf(resp, "Content-Type"),
+                    "text/javascript; charset=utf-8");
+  BOOST_CHECK_EQUAL(headerOf(resp, "Accept-Ranges"), "bytes");
+  BOOST_CHECK(!headerOf(resp, "ETag").empty());
+  BOOST_CHECK(!headerOf(resp, "Last-Modified").empty());
+
+  /// A cached file is the same open file
+  lynx::HttpResponse again(false);
+  handler(req, &again);
+  BOOST_CHECK_EQUAL(again.fileBody().fd_, resp.fileBody().fd_);
+
+  /// Directories serve their index.html, with or without the slash
+  for (std::string_view path : {"/static/sub/", "/static/sub"}) {
+    auto index_req = makeRequest(lynx::HttpMethod::GET, path);
+    lynx::HttpResponse index(false);
+    handler(index_req, &index);
+    BOOST_CHECK(index.statusCode() == lynx::HttpStatus::OK);
+    BOOST_CHECK_EQUAL(readBody(index), "<html></html>");
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testRejectedRequests) {
+  StaticRoot root;
+  lynx::StaticFileHandler handler(root.dir_, "/static");
+
+  auto missing = makeRequest(lynx::HttpMethod::GET, "/static/missing.js");
+  lynx::HttpResponse not_found(false);
+  handler(missing, &not_found);
+  BOOST_CHECK(not_found.statusCode() == lynx::HttpStatus::NOT_FOUND);
+
+  for (std::string_view path :
+       {"/static/../etc/passwd", "/static/sub/%2e%2e/%2e%2e/etc/passwd",
+        "/static/app.js%00.png", "/staticapp.js"}) {
+    auto escape = makeRequest(lynx::HttpMethod::GET, path);
+    lynx::HttpResponse forbidden(false);
+    handler(escape, &forbidden);
+    BOOST_CHECK(forbidden.statusCode() == lynx::HttpStatus::FORBIDDEN);
+    BOOST_CHECK(!forbidden.hasFileBody());
+  }
+
+  auto post = makeRequest(lynx::HttpMethod::POST, "/static/app.js");
+  lynx::HttpResponse not_allowed(false);
+  handler(post, &not_allowed);
+  BOOST_CHECK(not_allowed.statusCode() == lynx::HttpStatus::METHOD_NOT_ALLOWED);
+  BOOST_CHECK_EQUAL(headerOf(not_allowed, "Allow"), "GET, HEAD");
+}
+
+BOOST_AUTO_TEST_CASE(testConditionalGet) {
+  StaticRoot root;
+  lynx::StaticFileHandler handler(root.dir_, "/static");
+
+  auto req = makeRequest(lynx::HttpMethod::GET, "/static/app.js");
+  lynx::HttpResponse first(false);
+  handler(req, &first);
+  std::string etag = headerOf(first, "ETag");
+  std::string last_modified = headerOf(first, "Last-Modified");
+
+  auto by_etag = makeRequest(lynx::HttpMethod::GET, "/static/app.js");
+  by_etag.setHeader("If-None-Match", etag);
+  lynx::HttpResponse etag_hit(false);
+  handler(by_etag, &etag_hit);
+  BOOST_CHECK(etag_hit.statusCode() == lynx::HttpStatus::NOT_MODIFIED);
+  BOOST_CHECK(!etag_hit.hasFileBody());
+  /// No Content-Length of an empty body, which is not the file's
+  lynx::Buffer output;
+  etag_hit.appendToBuffer(&output, lynx::Timestamp::now());
+  BOOST_CHECK(output.retrieveAllAsString().find("Content-Length") ==
+              std::string::npos);
+
+  auto stale = makeRequest(lynx::HttpMethod::GET, "/static/app.js");
+  stale.setHeader("If-None-Match", "\"other\"");
+  lynx::HttpResponse etag_miss(false);
+  handler(stale, &etag_miss);
+  BOOST_CHECK(etag_miss.statusCode() == lynx::HttpStatus::OK);
+
+  auto by_date = makeRequest(lynx::HttpMethod::GET, "/static/app.js");
+  by_date.setHeader("If-Modified-Since", last_modified);
+  lynx::HttpResponse date_hit(false);
+  handler(by_date, &date_hit);
+  BOOST_CHECK(date_hit.statusCode() == lynx::HttpStatus::NOT_MODIFIED);
+
+  auto old = makeRequest(lynx::HttpMethod::GET, "/static/app.js");
+  old.setHeader("If-Modified-Since", "Sun, 06 Nov 1994 08:49:37 GMT");
+  lynx::HttpResponse date_miss(false);
+  handler(old, &date_miss);
+  BOOST_CHECK(date_miss.statusCode() == lynx::HttpStatus::OK);
+}
+
+BOOST_AUTO_TEST_CASE(testRange) {
+  StaticRoot root;
+  lynx::StaticFileHandler handler(root.dir_, "/static");
+  /// "console.log(1);\n" is 16 bytes
+  struct {
+    const char *range;
+    lynx::HttpStatus status;
+    const char *content_range;
+    const char *body;
+  } cases[] = {
+      {"bytes=0-6", lynx::HttpStatus::PARTIAL_CONTENT, "bytes 0-6/16",
+       "console"},
+      {"bytes=8-", lynx::HttpStatus::PARTIAL_CONTENT, "bytes 8-15/16",
+       "log(1);\n"},
+      {"bytes=-4", lynx::HttpStatus::PARTIAL_CONTENT, "bytes 12-15/16",
+       "1);\n"},
+      {"bytes=8-100", lynx::HttpStatus::PARTIAL_CONTENT, "bytes 8-15/16",
+       "log(1);\n"},
+      {"bytes=16-", lynx::HttpStatus::RANGE_NOT_SATISFIABLE, "bytes */16", ""},
+      {"bytes=0-1,4-5", lynx::HttpStatus::OK, "", "console.log(1);\n"},
+      {"lines=1-2", lynx::HttpStatus::OK, "", "console.log(1);\n"},
+  };
+  for (const auto &c : cases) {
+    auto req = makeRequest(lynx::HttpMethod::GET, "/static/app.js");
+    req.setHeader("Range", c.range);
+    lynx::HttpResponse resp(false);
+    handler(req, &resp);
+    BOOST_CHECK_MESSAGE(resp.statusCode() == c.status, c.range);
+    BOOST_CHECK_EQUAL(headerOf(resp, "Content-Range"), c.content_range);
+    BOOST_CHECK_EQUAL(resp.hasFileBody() ? readBody(resp) : "", c.body);
+  }
+}
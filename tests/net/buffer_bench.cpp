@@ -0,0 +1,130 @@
+#include "lynx/base/timestamp.h"
+#include "lynx/net/buffer.h"
+#include "lynx/net/byte_scan.h"
+#include "lynx/net/chain_buffer.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+
+/// Keeps the compiler from dropping the scans whose result is unused.
+static const char *volatile sink;
+
+/**
+ * A producer outrunning the socket: 16 KB appended and 12 KB sent per round
+ * until 4 MB are pending, as when a large response meets a slow peer.
+ */
+template <typename Output> void fillOutput(Output *output, const char *piece) {
+  for (int i = 0; i < 1024; ++i) {
+    output->append(piece, 16 * 1024);
+    output->retrieve(12 * 1024);
+  }
+  output->retrieveAll();
+}
+
+/// A 4 KB request header block of realistic, mostly short lines.
+std::string makeHeaderBlock() {
+  std::string block("GET /api/v1/items?page=1&size=20 HTTP/1.1\r\n"
+                    "Host: www.lynx.com\r\n");
+  for (int i = 0; block.size() < 4096 - 64; ++i) {
+    block += "X-Header-" + std::to_string(i) + ": ";
+    block.append(static_cast<size_t>(8 + i * 7 % 57), 'v');
+    block += "\r\n";
+  }
+  block.append(4096 - 4 - block.size(), 'x');
+  block += "\r\n\r\n";
+  return block;
+}
+
+template <typename Func>
+double bench(const char *name, int iters, Func f,
+             const char *unit = "4 KB block") {
+  lynx::Timestamp start(lynx::Timestamp::now());
+  for (int i = 0; i < iters; ++i) {
+    f();
+  }
+  double ns = timeDiff(lynx::Timestamp::now(), start) * 1e9 / iters;
+  printf("%-28s %10.1f ns per %s\n", name, ns, unit);
+  return ns;
+}
+
+int main() {
+  const int k_iters = 100000;
+  const std::string block = makeHeaderBlock();
+  const char *begin = block.data();
+  const char *end = block.data() + block.size();
+  lynx::Buffer buf;
+  buf.append(block);
+
+  static const char k_crlf[] = "\r\n";
+  double before = bench("std::search CRLF lines", k_iters, [&] {
+    for (const char *p = begin; p != end; p += 2) {
+      p = std::search(p, end, k_crlf, k_crlf + 2);
+      sink = p;
+    }
+  });
+  double after = bench("Buffer::findCRLF lines", k_iters, [&] {
+    for (const char *p = buf.findCRLF(); p; p = buf.findCRLF(p + 2)) {
+      sink = p;
+    }
+  });
+  printf("speedup %.2fx\n\n", before / after);
+
+  static const char k_crlfcrlf[] = "\r\n\r\n";
+  before = bench("std::search CRLFCRLF", k_iters, [&] {
+    sink = std::search(begin, end, k_crlfcrlf, k_crlfcrlf + 4);
+  });
+  after = bench("Buffer::findCRLFCRLF", k_iters,
+                [&] { sink = buf.findCRLFCRLF(buf.peek()); });
+  printf("speedup %.2fx\n\n", before / after);
+
+  /// The url decoding scan, over a block with no escape
+  const std::string query(4096, 'q');
+  const char *qbegin = query.data();
+  const char *qend = query.data() + query.size();
+  before = bench("byte loop '%' or '+'", k_iters, [&] {
+    sink = std::find_if(qbegin, qend,
+                        [](char c) { return c == '%' || c == '+'; });
+  });
+  after = bench("lynx::findEither '%' '+'", k_iters,
+                [&] { sink = lynx::findEither(qbegin, qend, '%', '+'); });
+  printf("speedup %.2fx\n\n", before / after);
+
+  /// Header token validation, over a block of token characters
+  constexpr lynx::ByteSet k_alnum([](char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+           (c >= 'A' && c <= 'Z') || c == '-';
+  });
+  std::string token;
+  while (token.size() < 4096) {
+    token += "Content-Type-X-Forwarded-For-";
+  }
+  token.resize(4096);
+  const char *tbegin = token.data();
+  const char *tend = token.data() + token.size();
+  before = bench("byte loop token check", k_iters, [&] {
+    sink = std::find_if(tbegin, tend,
+                        [&](char c) { return !k_alnum.contains(c); });
+  });
+  after = bench("lynx::findNotIn token check", k_iters,
+                [&] { sink = lynx::findNotIn(tbegin, tend, k_alnum); });
+  printf("speedup %.2fx\n\n", before / after);
+
+  /// Output buffering, a fresh buffer per response
+  const std::string piece(16 * 1024, 'p');
+  before = bench(
+      "Buffer 4 MB backlog", 200,
+      [&] {
+        lynx::Buffer output;
+        fillOutput(&output, piece.data());
+      },
+      "response");
+  after = bench(
+      "ChainBuffer 4 MB backlog", 200,
+      [&] {
+        lynx::ChainBuffer output;
+        fillOutput(&output, piece.data());
+      },
+      "response");
+  printf("speedup %.2fx\n", before / after);
+}
@@ -124,6 +124,36 @@ BOOST_AUTO_TEST_CASE(testBufferFindEOL) {
   BOOST_CHECK_EQUAL(buf.findEOL(buf.peek() + 90000), null);
 }
 
+BOOST_AUTO_TEST_CASE(testBufferFindCRLF) {
+  lynx::Buffer buf;
+  /// Put the matches on both sides of the 16 and 32 byte vector blocks
+  std::string str(100, 'x');
+  str.replace(31, 2, "\r\n");
+  str.replace(62, 4, "\r\n\r\n");
+  str[97] = '\r';
+  buf.append(str);
+  const char *null = nullptr;
+  BOOST_CHECK_EQUAL(buf.findCRLF(), buf.peek() + 31);
+  BOOST_CHECK_EQUAL(buf.findCRLF(buf.peek() + 32), buf.peek() + 62);
+  BOOST_CHECK_EQUAL(buf.findCRLF(buf.peek() + 65), null);
+  BOOST_CHECK_EQUAL(buf.findCRLFCRLF(buf.peek()), buf.peek() + 62);
+  BOOST_CHECK_EQUAL(buf.findCRLFCRLF(buf.peek() + 63), null);
+}
+
+BOOST_AUTO_TEST_CASE(testByteScan) {
+  constexpr lynx::ByteSet digits([](char c) { return c >= '0' && c <= '9'; });
+  std::string str(70, '7');
+  const char *end = str.data() + str.size();
+  BOOST_CHECK_EQUAL(lynx::findNotIn(str.data(), end, digits), end);
+  BOOST_CHECK_EQUAL(lynx::findEither(str.data(), end, '%', '+'), end);
+  str[40] = '+';
+  str[66] = static_cast<char>(0x87);
+  BOOST_CHECK_EQUAL(lynx::findNotIn(str.data(), end, digits), &str[40]);
+  BOOST_CHECK_EQUAL(lynx::findEither(str.data(), end, '%', '+'), &str[40]);
+  BOOST_CHECK_EQUAL(lynx::findNotIn(&str[41], end, digits), &str[66]);
+  BOOST_CHECK(!digits.contains(static_cast<char>(0x87)));
+}
+
 void output(lynx::Buffer &&buf, const void *inner) {
   lynx::Buffer newbuf(std::move(buf));
   // printf("New Buffer at %p, inner %p\n", &newbuf, newbuf.peek());
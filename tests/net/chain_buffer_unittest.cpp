@@ -0,0 +1,123 @@
+#include "lynx/net/chain_buffer.h"
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using lynx::ChainBuffer;
+
+BOOST_AUTO_TEST_CASE(testChainBufferAppendRetrieve) {
+  ChainBuffer buf;
+  BOOST_CHECK_EQUAL(buf.readableBytes(), 0);
+  BOOST_CHECK_EQUAL(buf.writableBytes(), 0);
+
+  const std::string str(200, 'x');
+  buf.append(str);
+  BOOST_CHECK_EQUAL(buf.readableBytes(), str.size());
+  BOOST_CHECK_EQUAL(buf.segmentCount(), 1);
+  BOOST_CHECK_EQUAL(buf.writableBytes(), ChainBuffer::K_SLAB_SIZE - 200);
+
+  /// Appending past the slab starts a new one, nothing is moved
+  const std::string big(ChainBuffer::K_SLAB_SIZE * 2, 'y');
+  buf.append(big);
+  BOOST_CHECK_EQUAL(buf.readableBytes(), str.size() + big.size());
+  BOOST_CHECK_EQUAL(buf.segmentCount(), 3);
+  BOOST_CHECK_EQUAL(buf.toString(), str + big);
+
+  /// Retrieving drops only the drained slabs
+  buf.retrieve(ChainBuffer::K_SLAB_SIZE + 10);
+  BOOST_CHECK_EQUAL(buf.segmentCount(), 2);
+  BOOST_CHECK_EQUAL(buf.readableBytes(),
+                    str.size() + big.size() - ChainBuffer::K_SLAB_SIZE - 10);
+
+  const std::string rest = buf.retrieveAllAsString();
+  BOOST_CHECK_EQUAL(rest, big.substr(ChainBuffer::K_SLAB_SIZE + 10 - 200));
+  BOOST_CHECK_EQUAL(buf.readableBytes(), 0);
+  BOOST_CHECK_EQUAL(buf.segmentCount(), 1);
+  BOOST_CHECK_EQUAL(buf.writableBytes(), ChainBuffer::K_SLAB_SIZE);
+}
+
+BOOST_AUTO_TEST_CASE(testChainBufferWriteInPlace) {
+  ChainBuffer buf;
+  buf.append(std::string(ChainBuffer::K_SLAB_SIZE - 4, 'a'));
+  /// Not enough room left, a new slab holds the reservation contiguously
+  buf.ensureWritableBytes(8);
+  BOOST_CHECK_GE(buf.writableBytes(), 8);
+  memcpy(buf.beginWrite(), "12345678", 8);
+  buf.hasWritten(8);
+  BOOST_CHECK_EQUAL(buf.segmentCount(), 2);
+  BOOST_CHECK_EQUAL(buf.toString(),
+                    std::string(ChainBuffer::K_SLAB_SIZE - 4, 'a') +
+                        "12345678");
+
+  /// A reservation larger than a slab gets a slab of its own size
+  buf.ensureWritableBytes(ChainBuffer::K_SLAB_SIZE * 3);
+  BOOST_CHECK_GE(buf.writableBytes(), ChainBuffer::K_SLAB_SIZE * 3);
+}
+
+BOOST_AUTO_TEST_CASE(testChainBufferSlices) {
+  auto owner = std::make_shared<std::string>(4096, 's');
+  ChainBuffer buf;
+  buf.append("head|", 5);
+  buf.appendSlice(owner->data(), owner->size(), owner);
+  buf.append("|tail", 5);
+  BOOST_CHECK_EQUAL(buf.segmentCount(), 3);
+  BOOST_CHECK_EQUAL(owner.use_count(), 2);
+  BOOST_CHECK_EQUAL(buf.toString(), "head|" + *owner + "|tail");
+
+  /// A small slice is copied instead of getting its own iovec
+  std::string small("tiny");
+  buf.appendSlice(small.data(), small.size(), nullptr);
+  BOOST_CHECK_EQUAL(buf.segmentCount(), 3);
+
+  /// The owner is released once its slice is retrieved
+  buf.retrieve(5 + owner->size());
+  BOOST_CHECK_EQUAL(owner.use_count(), 1);
+  BOOST_CHECK_EQUAL(buf.retrieveAllAsString(), "|tailtiny");
+}
+
+BOOST_AUTO_TEST_CASE(testChainBufferWriteFd) {
+  int fds[2];
+  BOOST_REQUIRE_EQUAL(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  fcntl(fds[0], F_SETFL, O_NONBLOCK);
+
+  auto owner = std::make_shared<std::string>(1000, 'o');
+  ChainBuffer buf;
+  std::string expected;
+  for (int i = 0; i < 100; ++i) {
+    std::string part(777, static_cast<char>('a' + i % 26));
+    buf.append(part);
+    buf.appendSlice(owner->data(), owner->size(), owner);
+    expected += part + *owner;
+  }
+  BOOST_CHECK_GT(buf.segmentCount(), ChainBuffer::K_MAX_IOVECS);
+
+  /// A limit stops the gather in the middle of a segment
+  int saved_errno = 0;
+  BOOST_CHECK_EQUAL(buf.writeFd(fds[0], 1234, &saved_errno), 1234);
+
+  std::string received;
+  char chunk[65536];
+  while (buf.readableBytes() > 0) {
+    ssize_t n = buf.writeFd(fds[0], buf.readableBytes(), &saved_errno);
+    if (n < 0) {
+      BOOST_REQUIRE_EQUAL(saved_errno, EAGAIN);
+    }
+    ssize_t r;
+    while ((r = ::recv(fds[1], chunk, sizeof(chunk), MSG_DONTWAIT)) > 0) {
+      received.append(chunk, r);
+    }
+  }
+  ssize_t r;
+  while ((r = ::recv(fds[1], chunk, sizeof(chunk), MSG_DONTWAIT)) > 0) {
+    received.append(chunk, r);
+  }
+  BOOST_CHECK(received == expected);
+  BOOST_CHECK_EQUAL(owner.use_count(), 1);
+  ::close(fds[0]);
+  ::close(fds[1]);
+}
@@ -1,3 +1,4 @@
+#include "lynx/base/mono_time.h"
 #include "lynx/logger/logging.h"
 #include "lynx/net/channel.h"
 #include "lynx/net/event_loop.h"
@@ -16,16 +17,16 @@ void print(const char *msg) {
 
 namespace lynx::detail {
 int createTimerfd();
-void readTimerfd(int timerfd, Timestamp now);
+void readTimerfd(int timerfd, MonoTime now);
 } // namespace lynx::detail
 
 // Use relative time, immunized to wall clock changes.
 class PeriodicTimer {
 public:
-  PeriodicTimer(lynx::EventLoop *loop, double interval,
-                const lynx::TimerCallback &cb)
+  PeriodicTimer(lynx::EventLoop *loop, double interval, lynx::TimerCallback cb)
       : loop_(loop), timerfd_(lynx::detail::createTimerfd()),
-        timerfd_channel_(loop, timerfd_), interval_(interval), cb_(cb) {
+        timerfd_channel_(loop, timerfd_), interval_(interval),
+        cb_(std::move(cb)) {
     timerfd_channel_.setReadCallback([this](auto && /*PH1*/) { handleRead(); });
     timerfd_channel_.enableReading();
   }
@@ -51,7 +52,7 @@ public:
 private:
   void handleRead() {
     loop_->assertInLoopThread();
-    lynx::detail::readTimerfd(timerfd_, lynx::Timestamp::now());
+    lynx::detail::readTimerfd(timerfd_, lynx::MonoTime::now());
     if (cb_) {
       cb_();
     }
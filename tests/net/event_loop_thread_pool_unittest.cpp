@@ -0,0 +1,128 @@
+#include "lynx/net/event_loop.h"
+#include "lynx/net/event_loop_thread_pool.h"
+#include "lynx/net/inet_address.h"
+
+#include <atomic>
+#include <map>
+#include <sched.h>
+#include <string>
+#include <thread>
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_CASE(testRoundRobinByDefault) {
+  lynx::EventLoop loop;
+  lynx::EventLoopThreadPool pool(&loop, "pool");
+  pool.setThreadNum(3);
+  pool.start();
+
+  std::vector<lynx::EventLoop *> loops = pool.getAllLoops();
+  lynx::InetAddress peer("10.0.0.1", 1234);
+  for (int i = 0; i < 6; ++i) {
+    BOOST_CHECK_EQUAL(pool.getLoopForPeer(peer), loops[i % 3]);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testNoThreads) {
+  lynx::EventLoop loop;
+  lynx::EventLoopThreadPool pool(&loop, "pool");
+  pool.setPlacementPolicy(lynx::EventLoopThreadPool::leastConnections());
+  pool.start();
+  BOOST_CHECK_EQUAL(pool.getLoopForPeer(lynx::InetAddress()), &loop);
+}
+
+BOOST_AUTO_TEST_CASE(testLeastConnections) {
+  lynx::EventLoop loop;
+  lynx::EventLoopThreadPool pool(&loop, "pool");
+  pool.setThreadNum(3);
+  pool.setPlacementPolicy(lynx::EventLoopThreadPool::leastConnections());
+  pool.start();
+
+  std::vector<lynx::EventLoop *> loops = pool.getAllLoops();
+  loops[0]->addConnectionCount(5);
+  loops[2]->addConnectionCount(1);
+  lynx::InetAddress peer("10.0.0.1", 1234);
+  BOOST_CHECK_EQUAL(pool.getLoopForPeer(peer), loops[1]);
+
+  /// Evened out as connections are counted in, ties taken in turn
+  std::map<lynx::EventLoop *, int> placed;
+  for (int i = 0; i < 12; ++i) {
+    lynx::EventLoop *chosen = pool.getLoopForPeer(peer);
+    chosen->addConnectionCount(1);
+    ++placed[chosen];
+  }
+  BOOST_CHECK_EQUAL(placed[loops[0]], 1);
+  BOOST_CHECK_EQUAL(placed[loops[1]], 6);
+  BOOST_CHECK_EQUAL(placed[loops[2]], 5);
+  for (lynx::EventLoop *l : loops) {
+    BOOST_CHECK_EQUAL(l->connectionCount(), 6);
+  }
+  loops[0]->addConnectionCount(-6);
+  loops[1]->addConnectionCount(-6);
+  loops[2]->addConnectionCount(-6);
+}
+
+BOOST_AUTO_TEST_CASE(testLeastQueued) {
+  lynx::EventLoop loop;
+  lynx::EventLoopThreadPool pool(&loop, "pool");
+  pool.setThreadNum(2);
+  pool.setPlacementPolicy(lynx::EventLoopThreadPool::leastQueued());
+  pool.start();
+
+  std::vector<lynx::EventLoop *> loops = pool.getAllLoops();
+  /// The first loop is stuck in a functor with more queued behind it
+  std::atomic<bool> release(false);
+  loops[0]->runInLoop([&release] {
+    while (!release) {
+      std::this_thread::yield();
+    }
+  });
+  loops[0]->queueInLoop([] {});
+  loops[0]->queueInLoop([] {});
+  lynx::InetAddress peer("10.0.0.1", 1234);
+  for (int i = 0; i < 4; ++i) {
+    BOOST_CHECK_EQUAL(pool.getLoopForPeer(peer), loops[1]);
+  }
+  release = true;
+}
+
+BOOST_AUTO_TEST_CASE(testPeerHash) {
+  lynx::EventLoop loop;
+  lynx::EventLoopThreadPool pool(&loop, "pool");
+  pool.setThreadNum(4);
+  pool.setPlacementPolicy(lynx::EventLoopThreadPool::peerHash());
+  pool.start();
+
+  std::map<lynx::EventLoop *, int> placed;
+  for (int i = 0; i < 64; ++i) {
+    std::string ip = "10.0.0." + std::to_string(i);
+    lynx::EventLoop *chosen = pool.getLoopForPeer(lynx::InetAddress(ip, 1000));
+    /// The port does not matter, the address alone picks the loop
+    BOOST_CHECK_EQUAL(pool.getLoopForPeer(lynx::InetAddress(ip, 2000)),
+                      chosen);
+    ++placed[chosen];
+  }
+  BOOST_CHECK_EQUAL(placed.size(), 4U);
+}
+
+BOOST_AUTO_TEST_CASE(testCpuAffinity) {
+  lynx::EventLoop loop;
+  lynx::EventLoopThreadPool pool(&loop, "pool");
+  pool.setThreadNum(3);
+  lynx::CpuAffinity cpus = lynx::CpuAffinity::physicalCores();
+  pool.setCpuAffinity(cpus);
+  pool.start();
+
+  /// Each loop runs on the CPU it was given, taken in turn
+  std::vector<lynx::EventLoop *> loops = pool.getAllLoops();
+  for (size_t i = 0; i < loops.size(); ++i) {
+    std::atomic<int> cpu(-1);
+    loops[i]->runInLoop([&cpu] { cpu = ::sched_getcpu(); });
+    while (cpu < 0) {
+      std::this_thread::yield();
+    }
+    BOOST_CHECK_EQUAL(std::to_string(cpu), cpus.cpuFor(i).toString());
+  }
+}
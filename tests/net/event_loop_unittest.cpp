@@ -0,0 +1,101 @@
+#include "lynx/net/event_loop.h"
+#include "lynx/net/event_loop_thread.h"
+
+#include <thread>
+#include <vector>
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_CASE(testQueueInLoopFromManyThreads) {
+  const int k_producers = 4;
+  const int k_per_producer = 100000;
+
+  lynx::EventLoopThread thread;
+  lynx::EventLoop *loop = thread.startLoop();
+
+  /// Only touched in the loop thread
+  std::vector<int> next(k_producers, 0);
+  bool ordered = true;
+  std::atomic<int> done(0);
+
+  std::vector<std::thread> producers;
+  for (int p = 0; p < k_producers; ++p) {
+    producers.emplace_back([&, p] {
+      for (int i = 0; i < k_per_producer; ++i) {
+        loop->queueInLoop([&, p, i] {
+          ordered = ordered && next[p] == i;
+          next[p] = i + 1;
+          if (i + 1 == k_per_producer) {
+            ++done;
+          }
+        });
+        /// Let the loop go back to sleep now and then
+        if (i % 10000 == 0) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+      }
+    });
+  }
+  for (auto &producer : producers) {
+    producer.join();
+  }
+  /// Every callback runs although nothing else wakes the loop
+  while (done.load() < k_producers) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  BOOST_CHECK(ordered);
+  BOOST_CHECK_EQUAL(loop->queueSize(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(testQueueInLoopFromLoopThread) {
+  lynx::EventLoopThread thread;
+  lynx::EventLoop *loop = thread.startLoop();
+
+  /// Callbacks queued by a callback run in a later iteration, without a
+  /// wakeup from another thread
+  std::atomic<int> runs(0);
+  std::function<void()> requeue = [&] {
+    if (++runs < 1000) {
+      loop->queueInLoop(requeue);
+    }
+  };
+  loop->queueInLoop(requeue);
+  for (int i = 0; i < 1000 && runs.load() < 1000; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  BOOST_CHECK_EQUAL(runs.load(), 1000);
+}
+
+BOOST_AUTO_TEST_CASE(testLoopNow) {
+  lynx::EventLoop loop;
+  lynx::MonoTime start = lynx::MonoTime::now();
+  lynx::MonoTime seen_first;
+  lynx::MonoTime seen_second;
+  bool on_time = false;
+  bool wall_on_time = false;
+  double wall_lag = -1;
+  /// A deadline on the monotonic clock, and one given on the wall clock
+  loop.runAt(addTime(start, 0.02), [&] {
+    seen_first = loop.loopNow();
+    on_time = !(lynx::MonoTime::now() < addTime(start, 0.02));
+  });
+  loop.runAt(addTime(lynx::Timestamp::now(), 0.04), [&] {
+    seen_second = loop.loopNow();
+    wall_on_time = timeDiff(lynx::MonoTime::now(), start) >= 0.04;
+    wall_lag = timeDiff(lynx::Timestamp::now(), loop.pollReturnTime());
+    loop.quit();
+  });
+  loop.loop();
+
+  BOOST_CHECK(on_time);
+  BOOST_CHECK(wall_on_time);
+  /// Read once per wakeup, before the timers of that wakeup run
+  BOOST_CHECK(!(seen_first < start));
+  BOOST_CHECK_GE(timeDiff(seen_second, seen_first), 0.015);
+  BOOST_CHECK(!(lynx::MonoTime::now() < seen_second));
+  /// The wall clock time of the same wakeup, derived rather than read
+  BOOST_CHECK_GE(wall_lag, 0.0);
+  BOOST_CHECK_LT(wall_lag, 0.01);
+}
@@ -0,0 +1,640 @@
+#include "lynx/net/event_loop.h"
+#include "lynx/net/event_loop_thread.h"
+#include "lynx/net/tcp_connection.h"
+#include "lynx/net/tcp_server.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+/// Connects to `port` on loopback and reads until the server closes.
+std::string readAll(uint16_t port) {
+  int sockfd = ::socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  std::string received;
+  if (::connect(sockfd, reinterpret_cast<struct sockaddr *>(&addr),
+                sizeof(addr)) == 0) {
+    char buf[65536];
+    ssize_t n;
+    while ((n = ::read(sockfd, buf, sizeof(buf))) > 0) {
+      received.append(buf, n);
+    }
+  }
+  ::close(sockfd);
+  return received;
+}
+
+/// Runs a server whose connection callback is `onConnected`, returns what
+/// one client received.
+std::string serve(uint16_t port,
+                  const std::function<void(const lynx::TcpConnectionPtr &)>
+                      &onConnected,
+                  const lynx::WriteCompleteCallback &onWriteComplete = {}) {
+  lynx::EventLoop loop;
+  lynx::TcpServer server(&loop, lynx::InetAddress(port, true), "test");
+  server.setConnectionCallback([&](const lynx::TcpConnectionPtr &conn) {
+    if (conn->connected()) {
+      onConnected(conn);
+    }
+  });
+  if (onWriteComplete) {
+    server.setWriteCompleteCallback(onWriteComplete);
+  }
+  server.start();
+  std::string received;
+  std::thread client([&] {
+    received = readAll(port);
+    loop.queueInLoop([&loop] { loop.quit(); });
+  });
+  loop.loop();
+  client.join();
+  return received;
+}
+
+std::string makeContent(size_t len) {
+  std::string content(len, '\0');
+  for (size_t i = 0; i < len; ++i) {
+    content[i] = static_cast<char>('a' + i % 26);
+  }
+  return content;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(testSendFileRegions) {
+  const std::string content = makeContent(3 * 1024 * 1024);
+  char path[] = "/tmp/lynx_sendfile_XXXXXX";
+  int fd = mkstemp(path);
+  BOOST_REQUIRE(fd >= 0);
+  ::unlink(path);
+  BOOST_REQUIRE_EQUAL(::write(fd, content.data(), content.size()),
+                      static_cast<ssize_t>(content.size()));
+
+  int write_complete = 0;
+  std::string received = serve(
+      19120,
+      [&](const lynx::TcpConnectionPtr &conn) {
+        conn->outputBuffer()->append("head|", 5);
+        conn->sendFile(fd, 10, 2 * 1024 * 1024);
+        conn->send(std::string("|mid|"));
+        conn->sendFile(fd, 0, 5);
+        conn->sendFile(fd, content.size() - 7, lynx::TcpConnection::K_TO_EOF);
+        conn->send(std::string("|tail"));
+        conn->shutdown();
+      },
+      [&](const lynx::TcpConnectionPtr &) { ++write_complete; });
+
+  BOOST_CHECK(received == "head|" + content.substr(10, 2 * 1024 * 1024) +
+                              "|mid|" + content.substr(0, 5) +
+                              content.substr(content.size() - 7) + "|tail");
+  BOOST_CHECK_GE(write_complete, 1);
+  ::close(fd);
+}
+
+BOOST_AUTO_TEST_CASE(testSendFileHighWaterMark) {
+  const std::string content = makeContent(4 * 1024 * 1024);
+  char path[] = "/tmp/lynx_sendfile_XXXXXX";
+  int fd = mkstemp(path);
+  BOOST_REQUIRE(fd >= 0);
+  ::unlink(path);
+  BOOST_REQUIRE_EQUAL(::write(fd, content.data(), content.size()),
+                      static_cast<ssize_t>(content.size()));
+
+  size_t high_water = 0;
+  std::string received =
+      serve(19121, [&](const lynx::TcpConnectionPtr &conn) {
+        conn->setHighWaterMarkCallback(
+            [&](const lynx::TcpConnectionPtr &, size_t len) {
+              high_water = std::max(high_water, len);
+            },
+            64 * 1024);
+        conn->sendFile(fd, 0, content.size());
+        conn->shutdown();
+      });
+
+  BOOST_CHECK(received == content);
+  /// Only file bytes were pending, they count toward the mark
+  BOOST_CHECK_GT(high_water, 64 * 1024);
+  ::close(fd);
+}
+
+BOOST_AUTO_TEST_CASE(testSendFilePipe) {
+  int pipefd[2];
+  BOOST_REQUIRE_EQUAL(::pipe2(pipefd, O_NONBLOCK | O_CLOEXEC), 0);
+
+  /// The writer is slower than the socket, the pipe is often found empty
+  const std::string content = makeContent(512 * 1024);
+  std::thread writer([&] {
+    int flags = ::fcntl(pipefd[1], F_GETFL);
+    ::fcntl(pipefd[1], F_SETFL, flags & ~O_NONBLOCK);
+    for (size_t off = 0; off < content.size(); off += 32 * 1024) {
+      ::write(pipefd[1], content.data() + off, 32 * 1024);
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    ::close(pipefd[1]);
+  });
+
+  std::string received =
+      serve(19122, [&](const lynx::TcpConnectionPtr &conn) {
+        conn->send(std::string("<"));
+        conn->sendFile(pipefd[0], 0, lynx::TcpConnection::K_TO_EOF);
+        conn->send(std::string(">"));
+        conn->shutdown();
+      });
+  writer.join();
+
+  BOOST_CHECK_EQUAL(received.size(), content.size() + 2);
+  BOOST_CHECK(received == "<" + content + ">");
+  ::close(pipefd[0]);
+}
+
+BOOST_AUTO_TEST_CASE(testSendSliceFanOut) {
+  const int k_clients = 8;
+  /// Larger than the socket buffers, so most of it is queued as a slice
+  lynx::ByteSlice payload(makeContent(8 * 1024 * 1024));
+  std::weak_ptr<const void> owner = payload.owner();
+
+  lynx::EventLoop loop;
+  lynx::TcpServer server(&loop, lynx::InetAddress(19123, true), "test");
+  std::vector<lynx::TcpConnectionPtr> conns;
+  std::mutex mutex;
+  std::condition_variable all_connected;
+  server.setConnectionCallback([&](const lynx::TcpConnectionPtr &conn) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (conn->connected()) {
+      conns.push_back(conn);
+      all_connected.notify_one();
+    }
+  });
+  server.start();
+
+  std::vector<std::string> received(k_clients);
+  std::vector<std::thread> clients;
+  for (int i = 0; i < k_clients; ++i) {
+    clients.emplace_back([&, i] { received[i] = readAll(19123); });
+  }
+  /// Broadcast from a thread that is not the loop
+  std::thread broadcaster([&] {
+    std::unique_lock<std::mutex> lock(mutex);
+    all_connected.wait(lock, [&] { return conns.size() == k_clients; });
+    for (const auto &conn : conns) {
+      conn->send(payload);
+      conn->shutdown();
+    }
+    conns.clear();
+  });
+  std::thread quitter([&] {
+    for (auto &client : clients) {
+      client.join();
+    }
+    loop.queueInLoop([&loop] { loop.quit(); });
+  });
+  loop.loop();
+  broadcaster.join();
+  quitter.join();
+
+  for (const auto &r : received) {
+    BOOST_CHECK(r == payload.view());
+  }
+  payload = lynx::ByteSlice();
+  BOOST_CHECK(owner.expired());
+}
+
+BOOST_AUTO_TEST_CASE(testSendMovedAcrossThreads) {
+  const std::string content = makeContent(2 * 1024 * 1024);
+  std::string received =
+      serve(19124, [&](const lynx::TcpConnectionPtr &conn) {
+        std::thread sender([conn, &content] {
+          conn->send(std::string("<"));
+          lynx::Buffer buf;
+          buf.append(content);
+          conn->send(std::move(buf));
+          std::string message(">");
+          conn->send(std::move(message));
+          conn->shutdown();
+        });
+        sender.detach();
+      });
+  BOOST_CHECK(received == "<" + content + ">");
+}
+
+BOOST_AUTO_TEST_CASE(testEdgeTriggered) {
+  const int k_clients = 16;
+  const size_t k_bytes = 1024 * 1024;
+
+  lynx::EventLoop loop;
+  lynx::TcpServer server(&loop, lynx::InetAddress(19125, true), "test");
+  /// A small budget, firehose clients keep being re-armed
+  server.setEdgeTriggered(true, 16 * 1024);
+  size_t received = 0;
+  int closed = 0;
+  server.setMessageCallback(
+      [&](const lynx::TcpConnectionPtr &, lynx::Buffer *buf, lynx::Timestamp) {
+        received += buf->readableBytes();
+        buf->retrieveAll();
+      });
+  server.setConnectionCallback([&](const lynx::TcpConnectionPtr &conn) {
+    if (conn->connected()) {
+      conn->send(std::string("ready"));
+    } else {
+      ++closed;
+    }
+  });
+  server.start();
+
+  /// Clients connect at once, the listener drains its backlog per edge
+  std::vector<std::thread> clients;
+  std::vector<std::string> replies(k_clients);
+  const std::string payload = makeContent(k_bytes);
+  for (int i = 0; i < k_clients; ++i) {
+    clients.emplace_back([&, i] {
+      int sockfd = ::socket(AF_INET, SOCK_STREAM, 0);
+      struct sockaddr_in addr = {};
+      addr.sin_family = AF_INET;
+      addr.sin_port = htons(19125);
+      addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      if (::connect(sockfd, reinterpret_cast<struct sockaddr *>(&addr),
+                    sizeof(addr)) == 0) {
+        char buf[5];
+        if (::read(sockfd, buf, sizeof(buf)) == sizeof(buf)) {
+          replies[i].assign(buf, sizeof(buf));
+        }
+        for (size_t off = 0; off < payload.size();) {
+          ssize_t n =
+              ::write(sockfd, payload.data() + off, payload.size() - off);
+          if (n <= 0) {
+            break;
+          }
+          off += n;
+        }
+      }
+      ::close(sockfd);
+    });
+  }
+  std::thread quitter([&] {
+    for (auto &client : clients) {
+      client.join();
+    }
+    /// Until the server has read everything and seen every close
+    loop.runEvery(0.01, [&] {
+      if (closed == k_clients) {
+        loop.quit();
+      }
+    });
+  });
+  loop.loop();
+  quitter.join();
+
+  for (const auto &reply : replies) {
+    BOOST_CHECK_EQUAL(reply, "ready");
+  }
+  BOOST_CHECK_EQUAL(received, k_clients * k_bytes);
+}
+
+BOOST_AUTO_TEST_CASE(testEdgeTriggeredReset) {
+  const int k_clients = 2;
+
+  lynx::EventLoop loop;
+  lynx::TcpServer server(&loop, lynx::InetAddress(19137, true), "test");
+  server.setEdgeTriggered(true);
+  int connected = 0;
+  int closed = 0;
+  std::atomic<bool> write{false};
+  std::atomic<int> written{0};
+  std::atomic<bool> reset{false};
+  std::atomic<int> resets{0};
+  auto waitFor = [](const std::atomic<int> &count, int n) {
+    while (count.load() < n) {
+      ::usleep(1000);
+    }
+  };
+  /// Held until both peers wrote, so one poll reports both readable
+  server.setConnectionCallback([&](const lynx::TcpConnectionPtr &conn) {
+    if (!conn->connected()) {
+      ++closed;
+    } else if (++connected == k_clients) {
+      write = true;
+      waitFor(written, k_clients);
+    }
+  });
+  /// The first read has both peers reset, the other channel of the poll
+  /// finds the reset when it reads and must close then, not on a later edge
+  int closed_in_poll = -1;
+  server.setMessageCallback(
+      [&](const lynx::TcpConnectionPtr &, lynx::Buffer *buf, lynx::Timestamp) {
+        buf->retrieveAll();
+        if (!reset.exchange(true)) {
+          waitFor(resets, k_clients);
+          loop.queueInLoop([&] { closed_in_poll = closed; });
+        }
+      });
+  server.start();
+
+  std::vector<std::thread> clients;
+  for (int i = 0; i < k_clients; ++i) {
+    clients.emplace_back([&] {
+      int sockfd = ::socket(AF_INET, SOCK_STREAM, 0);
+      struct sockaddr_in addr = {};
+      addr.sin_family = AF_INET;
+      addr.sin_port = htons(19137);
+      addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      if (::connect(sockfd, reinterpret_cast<struct sockaddr *>(&addr),
+                    sizeof(addr)) == 0) {
+        while (!write) {
+          ::usleep(1000);
+        }
+        ssize_t n = ::write(sockfd, "data", 4);
+        (void)n;
+      }
+      ++written;
+      while (!reset) {
+        ::usleep(1000);
+      }
+      struct linger linger = {1, 0};
+      ::setsockopt(sockfd, SOL_SOCKET, SO_LINGER, &linger, sizeof(linger));
+      ::close(sockfd);
+      ++resets;
+    });
+  }
+  std::thread quitter([&] {
+    for (auto &client : clients) {
+      client.join();
+    }
+    loop.runEvery(0.01, [&] {
+      if (closed == k_clients) {
+        loop.quit();
+      }
+    });
+    /// A reset connection that was never closed would keep the loop running
+    loop.runAfter(5.0, [&] { loop.quit(); });
+  });
+  loop.loop();
+  quitter.join();
+
+  /// The io_uring poller receives for the channel, it never reads
+  const char *poller = ::getenv("LYNX_POLLER");
+  if (poller == nullptr || std::string(poller) != "io_uring") {
+    BOOST_CHECK_EQUAL(closed_in_poll, 1);
+  }
+  BOOST_CHECK_EQUAL(closed, k_clients);
+}
+
+BOOST_AUTO_TEST_CASE(testMigrateWhileStreaming) {
+  const std::string payload = makeContent(4 * 1024 * 1024);
+
+  /// Outlives the server, whose IO threads use it
+  std::mutex mutex;
+  std::vector<lynx::EventLoop *> loops;
+  std::set<lynx::EventLoop *> served_by;
+  bool in_own_loop = true;
+  lynx::EventLoop loop;
+  lynx::TcpServer server(&loop, lynx::InetAddress(19131, true), "test");
+  server.setThreadNum(2);
+  server.setThreadInitCallback([&](lynx::EventLoop *ioLoop) {
+    std::lock_guard<std::mutex> lock(mutex);
+    loops.push_back(ioLoop);
+  });
+  server.setMessageCallback([&](const lynx::TcpConnectionPtr &conn,
+                                lynx::Buffer *buf, lynx::Timestamp) {
+    in_own_loop = in_own_loop && conn->getLoop()->isInLoopThread();
+    served_by.insert(conn->getLoop());
+    conn->send(buf->retrieveAllAsString());
+    /// Back and forth while the client keeps writing
+    conn->migrateTo(conn->getLoop() == loops[0] ? loops[1] : loops[0]);
+  });
+  server.setConnectionCallback([&](const lynx::TcpConnectionPtr &conn) {
+    if (!conn->connected()) {
+      loop.queueInLoop([&loop] { loop.quit(); });
+    }
+  });
+  server.start();
+
+  std::string echoed;
+  std::thread client([&] {
+    int sockfd = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(19131);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(sockfd, reinterpret_cast<struct sockaddr *>(&addr),
+                  sizeof(addr)) != 0) {
+      ::close(sockfd);
+      loop.queueInLoop([&loop] { loop.quit(); });
+      return;
+    }
+    std::thread writer([&] {
+      for (size_t off = 0; off < payload.size();) {
+        size_t len = std::min<size_t>(4096, payload.size() - off);
+        ssize_t n = ::write(sockfd, payload.data() + off, len);
+        if (n <= 0) {
+          break;
+        }
+        off += n;
+      }
+    });
+    char buf[65536];
+    while (echoed.size() < payload.size()) {
+      ssize_t n = ::read(sockfd, buf, sizeof(buf));
+      if (n <= 0) {
+        break;
+      }
+      echoed.append(buf, n);
+    }
+    writer.join();
+    ::close(sockfd);
+  });
+  loop.loop();
+  client.join();
+
+  BOOST_CHECK(in_own_loop);
+  BOOST_CHECK_EQUAL(served_by.size(), 2U);
+  BOOST_CHECK_EQUAL(echoed.size(), payload.size());
+  BOOST_CHECK(echoed == payload);
+}
+
+BOOST_AUTO_TEST_CASE(testMigrateWhileNotReading) {
+  std::string received;
+  lynx::EventLoop *delivered_in = nullptr;
+  lynx::EventLoop loop;
+  lynx::EventLoopThread thread;
+  lynx::EventLoop *target = thread.startLoop();
+  lynx::TcpServer server(&loop, lynx::InetAddress(19132, true), "test");
+  server.setMessageCallback([&](const lynx::TcpConnectionPtr &conn,
+                                lynx::Buffer *buf, lynx::Timestamp) {
+    received += buf->retrieveAllAsString();
+    delivered_in = conn->getLoop();
+    if (received == "hello") {
+      /// The rest arrives while reading is off and the connection moves
+      conn->stopRead();
+      conn->migrateTo(target);
+      target->runAfter(0.1, [conn] { conn->startRead(); });
+    } else if (received == "hello world") {
+      conn->send(std::string("done"));
+    }
+  });
+  server.setConnectionCallback([&](const lynx::TcpConnectionPtr &conn) {
+    if (!conn->connected()) {
+      loop.queueInLoop([&loop] { loop.quit(); });
+    }
+  });
+  server.start();
+
+  std::string reply;
+  std::thread client([&] {
+    int sockfd = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(19132);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(sockfd, reinterpret_cast<struct sockaddr *>(&addr),
+                  sizeof(addr)) == 0) {
+      ::write(sockfd, "hello", 5);
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      ::write(sockfd, " world", 6);
+      char buf[4];
+      if (::read(sockfd, buf, sizeof(buf)) == sizeof(buf)) {
+        reply.assign(buf, sizeof(buf));
+      }
+    } else {
+      loop.queueInLoop([&loop] { loop.quit(); });
+    }
+    ::close(sockfd);
+  });
+  loop.loop();
+  client.join();
+
+  BOOST_CHECK_EQUAL(received, "hello world");
+  BOOST_CHECK_EQUAL(delivered_in, target);
+  BOOST_CHECK_EQUAL(reply, "done");
+}
+
+BOOST_AUTO_TEST_CASE(testRebalance) {
+  const int k_clients = 2;
+
+  std::mutex mutex;
+  std::map<std::string, lynx::EventLoop *> served_by;
+  std::atomic<bool> spread(false);
+  lynx::EventLoop loop;
+  lynx::TcpServer server(&loop, lynx::InetAddress(19133, true), "test");
+  server.setThreadNum(2);
+  /// Both hot connections start on the same loop
+  server.setPlacementPolicy(
+      [](const std::vector<lynx::EventLoop *> &loops,
+         const lynx::InetAddress &) { return loops[0]; });
+  server.setRebalancing(0.5);
+  server.setMessageCallback([&](const lynx::TcpConnectionPtr &conn,
+                                lynx::Buffer *buf, lynx::Timestamp) {
+    /// Some work per message keeps the loop busy
+    lynx::Timestamp start(lynx::Timestamp::now());
+    while (timeDiff(lynx::Timestamp::now(), start) < 0.0002) {
+    }
+    conn->send(buf->retrieveAllAsString());
+    std::lock_guard<std::mutex> lock(mutex);
+    served_by[conn->name()] = conn->getLoop();
+    if (served_by.size() == k_clients &&
+        served_by.begin()->second != served_by.rbegin()->second) {
+      spread = true;
+    }
+  });
+  server.start();
+
+  std::vector<std::thread> clients;
+  for (int i = 0; i < k_clients; ++i) {
+    clients.emplace_back([&] {
+      int sockfd = ::socket(AF_INET, SOCK_STREAM, 0);
+      struct sockaddr_in addr = {};
+      addr.sin_family = AF_INET;
+      addr.sin_port = htons(19133);
+      addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      if (::connect(sockfd, reinterpret_cast<struct sockaddr *>(&addr),
+                    sizeof(addr)) == 0) {
+        lynx::Timestamp start(lynx::Timestamp::now());
+        char buf[64] = {};
+        while (!spread && timeDiff(lynx::Timestamp::now(), start) < 10.0) {
+          if (::write(sockfd, buf, sizeof(buf)) != sizeof(buf) ||
+              ::read(sockfd, buf, sizeof(buf)) <= 0) {
+            break;
+          }
+        }
+      }
+      ::close(sockfd);
+    });
+  }
+  std::thread quitter([&] {
+    for (auto &client : clients) {
+      client.join();
+    }
+    loop.queueInLoop([&loop] { loop.quit(); });
+  });
+  loop.loop();
+  quitter.join();
+
+  BOOST_CHECK(spread);
+}
+
+BOOST_AUTO_TEST_CASE(testMigrateKeepsSendOrder) {
+  const int k_messages = 2000;
+
+  /// Outlives the server, whose IO threads use it
+  std::mutex mutex;
+  std::vector<lynx::EventLoop *> loops;
+  std::thread producer;
+  lynx::EventLoop loop;
+  lynx::TcpServer server(&loop, lynx::InetAddress(19136, true), "test");
+  server.setThreadNum(2);
+  server.setThreadInitCallback([&](lynx::EventLoop *ioLoop) {
+    std::lock_guard<std::mutex> lock(mutex);
+    loops.push_back(ioLoop);
+  });
+  server.setConnectionCallback([&](const lynx::TcpConnectionPtr &conn) {
+    if (!conn->connected()) {
+      return;
+    }
+    /// Sent from another thread while the connection moves back and forth
+    /// between the IO loops
+    producer = std::thread([&, conn] {
+      for (int i = 0; i < k_messages; ++i) {
+        conn->send(std::to_string(i) + ",");
+        if (i % 50 == 0) {
+          conn->migrateTo(conn->getLoop() == loops[0] ? loops[1] : loops[0]);
+        }
+      }
+      conn->shutdown();
+    });
+  });
+  server.start();
+
+  std::string received;
+  std::thread client([&] {
+    received = readAll(19136);
+    loop.queueInLoop([&loop] { loop.quit(); });
+  });
+  loop.loop();
+  client.join();
+  producer.join();
+
+  std::string expected;
+  for (int i = 0; i < k_messages; ++i) {
+    expected += std::to_string(i) + ",";
+  }
+  BOOST_CHECK(received == expected);
+}
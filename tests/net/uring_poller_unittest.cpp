@@ -0,0 +1,176 @@
+#include "lynx/net/channel.h"
+#include "lynx/net/event_loop.h"
+#include "lynx/net/tcp_connection.h"
+#include "lynx/net/tcp_server.h"
+#include "lynx/net/uring_poller.h"
+
+#include <arpa/inet.h>
+#include <cstdlib>
+#include <fcntl.h>
+#include <thread>
+#include <unistd.h>
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+/// Every loop of this test runs on an io_uring
+struct UseUring {
+  UseUring() { ::setenv("LYNX_POLLER", "io_uring", 1); }
+};
+
+int connectTo(uint16_t port) {
+  int sockfd = ::socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (::connect(sockfd, reinterpret_cast<struct sockaddr *>(&addr),
+                sizeof(addr)) != 0) {
+    ::close(sockfd);
+    return -1;
+  }
+  return sockfd;
+}
+
+} // namespace
+
+BOOST_GLOBAL_FIXTURE(UseUring);
+
+BOOST_AUTO_TEST_CASE(testLevelTriggeredChannel) {
+  if (!lynx::UringPoller::available()) {
+    BOOST_TEST_MESSAGE("io_uring is not available, skipped");
+    return;
+  }
+  lynx::EventLoop loop;
+  int pipefd[2];
+  BOOST_REQUIRE_EQUAL(::pipe2(pipefd, O_NONBLOCK | O_CLOEXEC), 0);
+  BOOST_REQUIRE_EQUAL(::write(pipefd[1], "ab", 2), 2);
+
+  /// One byte per event, the channel is reported until the pipe is empty
+  std::string read;
+  lynx::Channel channel(&loop, pipefd[0]);
+  channel.setReadCallback([&](lynx::Timestamp) {
+    char c;
+    if (::read(pipefd[0], &c, 1) == 1) {
+      read += c;
+    }
+    if (read.size() == 2) {
+      loop.quit();
+    }
+  });
+  channel.enableReading();
+  loop.loop();
+  channel.disableAll();
+  channel.remove();
+  ::close(pipefd[0]);
+  ::close(pipefd[1]);
+  BOOST_CHECK_EQUAL(read, "ab");
+}
+
+BOOST_AUTO_TEST_CASE(testEcho) {
+  if (!lynx::UringPoller::available()) {
+    BOOST_TEST_MESSAGE("io_uring is not available, skipped");
+    return;
+  }
+  /// More than the whole buffer ring, buffers must be handed back
+  std::string payload(4 * 1024 * 1024, '\0');
+  for (size_t i = 0; i < payload.size(); ++i) {
+    payload[i] = static_cast<char>('a' + i % 26);
+  }
+
+  lynx::EventLoop loop;
+  lynx::TcpServer server(&loop, lynx::InetAddress(19126, true), "test");
+  server.setMessageCallback([](const lynx::TcpConnectionPtr &conn,
+                               lynx::Buffer *buf, lynx::Timestamp) {
+    conn->send(buf->retrieveAllAsString());
+  });
+  bool closed = false;
+  server.setConnectionCallback([&](const lynx::TcpConnectionPtr &conn) {
+    if (!conn->connected()) {
+      closed = true;
+      loop.quit();
+    }
+  });
+  server.start();
+
+  std::string echoed;
+  std::thread client([&] {
+    int sockfd = connectTo(19126);
+    if (sockfd < 0) {
+      loop.queueInLoop([&loop] { loop.quit(); });
+      return;
+    }
+    std::thread writer([&] {
+      for (size_t off = 0; off < payload.size();) {
+        ssize_t n = ::write(sockfd, payload.data() + off, payload.size() - off);
+        if (n <= 0) {
+          break;
+        }
+        off += n;
+      }
+    });
+    char buf[65536];
+    while (echoed.size() < payload.size()) {
+      ssize_t n = ::read(sockfd, buf, sizeof(buf));
+      if (n <= 0) {
+        break;
+      }
+      echoed.append(buf, n);
+    }
+    writer.join();
+    ::close(sockfd);
+  });
+  loop.loop();
+  client.join();
+
+  BOOST_CHECK(closed);
+  BOOST_CHECK_EQUAL(echoed.size(), payload.size());
+  BOOST_CHECK(echoed == payload);
+}
+
+BOOST_AUTO_TEST_CASE(testStopReadKeepsReceivedBytes) {
+  if (!lynx::UringPoller::available()) {
+    BOOST_TEST_MESSAGE("io_uring is not available, skipped");
+    return;
+  }
+  lynx::EventLoop loop;
+  lynx::TcpServer server(&loop, lynx::InetAddress(19127, true), "test");
+  std::string received;
+  bool closed_after_data = false;
+  server.setMessageCallback([&](const lynx::TcpConnectionPtr &conn,
+                               lynx::Buffer *buf, lynx::Timestamp) {
+    received += buf->retrieveAllAsString();
+    if (received == "hello") {
+      /// The rest and the end of the stream arrive while reading is off
+      conn->stopRead();
+      loop.runAfter(0.1, [conn] { conn->startRead(); });
+    }
+  });
+  server.setConnectionCallback([&](const lynx::TcpConnectionPtr &conn) {
+    if (!conn->connected()) {
+      closed_after_data = received == "hello world";
+      loop.quit();
+    }
+  });
+  server.start();
+
+  std::thread client([&] {
+    int sockfd = connectTo(19127);
+    if (sockfd >= 0) {
+      ::write(sockfd, "hello", 5);
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      ::write(sockfd, " world", 6);
+      ::close(sockfd);
+    } else {
+      loop.queueInLoop([&loop] { loop.quit(); });
+    }
+  });
+  loop.loop();
+  client.join();
+
+  BOOST_CHECK_EQUAL(received, "hello world");
+  BOOST_CHECK(closed_after_data);
+}
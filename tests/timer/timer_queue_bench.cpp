@@ -2,6 +2,12 @@
 #include "lynx/net/event_loop.h"
 #include "lynx/net/event_loop_thread.h"
 
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
 int cnt = 0;
 lynx::EventLoop *g_loop;
 
@@ -22,7 +28,8 @@ void cancel(lynx::TimerId timer) {
   printf("cancelled at %s\n", lynx::Timestamp::now().toString().c_str());
 }
 
-int main() {
+/// Walks through runAfter(), runEvery() and cancel() with printed times.
+void demo() {
   printTid();
   sleep(1);
 
@@ -56,3 +63,102 @@ int main() {
     print("thread loop exits");
   }
 }
+
+namespace {
+
+const int K_TIMERS = 1000 * 1000;
+
+double nsPerTimer(lynx::Timestamp start) {
+  return timeDiff(lynx::Timestamp::now(), start) * 1e9 / K_TIMERS;
+}
+
+/// Adds timers due in 1 to 60 seconds, then cancels them all.
+void addCancel(const char *backend) {
+  lynx::EventLoop loop;
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<double> delay(1.0, 60.0);
+  std::vector<lynx::TimerId> ids;
+  ids.reserve(K_TIMERS);
+  lynx::Timestamp start(lynx::Timestamp::now());
+  for (int i = 0; i < K_TIMERS; ++i) {
+    ids.push_back(loop.runAfter(delay(rng), [] {}));
+  }
+  double add = nsPerTimer(start);
+  start = lynx::Timestamp::now();
+  for (lynx::TimerId id : ids) {
+    loop.cancel(id);
+  }
+  printf("%-28s %-12s %7.1f ns/add %7.1f ns/cancel\n", "add, cancel",
+         backend, add, nsPerTimer(start));
+}
+
+/// Adds timers due within 100 ms and runs the loop until all fired.
+void addFire(const char *backend) {
+  lynx::EventLoop loop;
+  std::mt19937 rng(2);
+  std::uniform_real_distribution<double> delay(0.0, 0.1);
+  int fired = 0;
+  lynx::Timestamp start(lynx::Timestamp::now());
+  for (int i = 0; i < K_TIMERS; ++i) {
+    loop.runAfter(delay(rng), [&] {
+      if (++fired == K_TIMERS) {
+        loop.quit();
+      }
+    });
+  }
+  double add = nsPerTimer(start);
+  loop.loop();
+  printf("%-28s %-12s %7.1f ns/add %7.1f ns/timer to the last fire\n",
+         "add, fire (over 100 ms)", backend, add, nsPerTimer(start));
+}
+
+/// Request deadlines: among 100k pending timers, each request adds one and
+/// cancels it when done.
+void deadlines(const char *backend) {
+  lynx::EventLoop loop;
+  for (int i = 0; i < K_TIMERS / 10; ++i) {
+    loop.runAfter(30.0 + 0.00001 * i, [] {});
+  }
+  lynx::Timestamp start(lynx::Timestamp::now());
+  for (int i = 0; i < K_TIMERS; ++i) {
+    loop.cancel(loop.runAfter(30.0, [] {}));
+  }
+  printf("%-28s %-12s %7.1f ns/request\n", "deadline add + cancel", backend,
+         nsPerTimer(start));
+}
+
+/// Request deadlines on an otherwise idle loop: each is the earliest timer,
+/// so adding it re-arms the loop.
+void earliestDeadlines(const char *backend) {
+  lynx::EventLoop loop;
+  lynx::Timestamp start(lynx::Timestamp::now());
+  for (int i = 0; i < K_TIMERS; ++i) {
+    loop.cancel(loop.runAfter(5.0, [] {}));
+  }
+  printf("%-28s %-12s %7.1f ns/request\n", "earliest deadline add+cancel",
+         backend, nsPerTimer(start));
+}
+
+} // namespace
+
+/// Compares the timer queue backends on 1M timers, with and without timerfd,
+/// or runs the walkthrough with "demo".
+int main(int argc, char *argv[]) {
+  if (argc > 1 && ::strcmp(argv[1], "demo") == 0) {
+    demo();
+    return 0;
+  }
+  for (auto *scenario : {addCancel, addFire, deadlines, earliestDeadlines}) {
+    for (const char *backend : {"tree", "wheel"}) {
+      for (const char *timerfd : {"on", "off"}) {
+        ::setenv("LYNX_TIMER_QUEUE", backend, 1);
+        ::setenv("LYNX_TIMERFD", timerfd, 1);
+        std::string name(backend);
+        if (::strcmp(timerfd, "off") == 0) {
+          name += " no tfd";
+        }
+        scenario(name.c_str());
+      }
+    }
+  }
+}
@@ -0,0 +1,234 @@
+#include "lynx/net/event_loop.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+struct Backend {
+  const char *name;
+  const char *queue;
+  const char *timerfd;
+};
+
+/// Every test runs on both backends, woken by a timerfd or the poll timeout,
+/// in a loop made after this is set
+const Backend K_BACKENDS[] = {{"tree", "tree", "on"},
+                              {"wheel", "wheel", "on"},
+                              {"tree without timerfd", "tree", "off"},
+                              {"wheel without timerfd", "wheel", "off"}};
+
+void useBackend(const Backend &backend, const char *resolutionUs = "1000") {
+  ::setenv("LYNX_TIMER_QUEUE", backend.queue, 1);
+  ::setenv("LYNX_TIMER_RESOLUTION_US", resolutionUs, 1);
+  ::setenv("LYNX_TIMERFD", backend.timerfd, 1);
+}
+
+/// The timerfds of this process.
+int countTimerfds() {
+  int count = 0;
+  for (const auto &entry :
+       std::filesystem::directory_iterator("/proc/self/fd")) {
+    std::error_code ec;
+    auto target = std::filesystem::read_symlink(entry.path(), ec);
+    if (!ec && target.string() == "anon_inode:[timerfd]") {
+      ++count;
+    }
+  }
+  return count;
+}
+
+double since(lynx::Timestamp start) {
+  return timeDiff(lynx::Timestamp::now(), start);
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(testOrder) {
+  for (const Backend &backend : K_BACKENDS) {
+    BOOST_TEST_CONTEXT(backend.name) {
+      useBackend(backend);
+      lynx::EventLoop loop;
+      lynx::Timestamp start(lynx::Timestamp::now());
+      std::vector<double> delays = {0.05, 0.01, 0.03, 0.0, 0.02};
+      std::vector<double> fired;
+      bool early = false;
+      for (double delay : delays) {
+        loop.runAfter(delay, [&, delay] {
+          early = early || since(start) < delay;
+          fired.push_back(delay);
+          if (fired.size() == delays.size()) {
+            loop.quit();
+          }
+        });
+      }
+      loop.loop();
+
+      std::vector<double> expected = {0.0, 0.01, 0.02, 0.03, 0.05};
+      BOOST_CHECK(fired == expected);
+      BOOST_CHECK(!early);
+      BOOST_CHECK_LT(since(start), 0.05 + 0.02);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testNotEarlyFromCallback) {
+  for (const Backend &backend : K_BACKENDS) {
+    BOOST_TEST_CONTEXT(backend.name) {
+      useBackend(backend);
+      lynx::EventLoop loop;
+      lynx::Timestamp start;
+      bool early = true;
+      loop.runAfter(0.0, [&] {
+        /// Well past the time the loop woke up at
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        start = lynx::Timestamp::now();
+        loop.runAfter(0.02, [&] {
+          early = since(start) < 0.02;
+          loop.quit();
+        });
+      });
+      loop.loop();
+
+      BOOST_CHECK(!early);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testCancel) {
+  for (const Backend &backend : K_BACKENDS) {
+    BOOST_TEST_CONTEXT(backend.name) {
+      useBackend(backend);
+      lynx::EventLoop loop;
+      bool cancelled_fired = false;
+      int reused_fired = 0;
+      lynx::TimerId cancelled =
+          loop.runAfter(0.02, [&] { cancelled_fired = true; });
+      loop.cancel(cancelled);
+      lynx::TimerId done = loop.runAfter(0.01, [] {});
+      loop.runAfter(0.03, [&] {
+        /// Ids of timers that are gone cancel nothing, even if a new timer
+        /// took the place of theirs
+        for (int i = 0; i < 4; ++i) {
+          loop.runAfter(0.01, [&] { ++reused_fired; });
+        }
+        loop.cancel(done);
+        loop.cancel(cancelled);
+      });
+      loop.runAfter(0.06, [&loop] { loop.quit(); });
+      loop.loop();
+
+      BOOST_CHECK(!cancelled_fired);
+      BOOST_CHECK_EQUAL(reused_fired, 4);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testRepeat) {
+  for (const Backend &backend : K_BACKENDS) {
+    BOOST_TEST_CONTEXT(backend.name) {
+      useBackend(backend);
+      lynx::EventLoop loop;
+      int count = 0;
+      int other = 0;
+      lynx::TimerId self;
+      /// Cancelled from its own callback
+      self = loop.runEvery(0.01, [&] {
+        if (++count == 5) {
+          loop.cancel(self);
+        }
+      });
+      lynx::TimerId every = loop.runEvery(0.01, [&] { ++other; });
+      loop.runAfter(0.035, [&] { loop.cancel(every); });
+      loop.runAfter(0.12, [&loop] { loop.quit(); });
+      loop.loop();
+
+      BOOST_CHECK_EQUAL(count, 5);
+      BOOST_CHECK_EQUAL(other, 3);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testFarTimers) {
+  /// 10us ticks, the timers start two and three levels up the wheel
+  useBackend({"wheel", "wheel", "on"}, "10");
+  lynx::EventLoop loop;
+  lynx::Timestamp start(lynx::Timestamp::now());
+  std::vector<double> delays = {0.6, 0.9, 0.002};
+  std::vector<double> late;
+  for (double delay : delays) {
+    loop.runAfter(delay, [&, delay] {
+      late.push_back(since(start) - delay);
+      if (late.size() == delays.size()) {
+        loop.quit();
+      }
+    });
+  }
+  loop.loop();
+
+  BOOST_REQUIRE_EQUAL(late.size(), 3U);
+  for (double l : late) {
+    BOOST_CHECK_GE(l, 0.0);
+    BOOST_CHECK_LT(l, 0.01);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testOtherThread) {
+  for (const Backend &backend : K_BACKENDS) {
+    BOOST_TEST_CONTEXT(backend.name) {
+      useBackend(backend);
+      lynx::EventLoop loop;
+      std::atomic<int> fired(0);
+      std::thread adder([&] {
+        std::vector<lynx::TimerId> ids;
+        for (int i = 0; i < 1000; ++i) {
+          ids.push_back(loop.runAfter(0.02 + 0.00002 * i, [&] { ++fired; }));
+        }
+        for (size_t i = 0; i < ids.size(); i += 2) {
+          loop.cancel(ids[i]);
+        }
+        loop.runAfter(0.1, [&loop] { loop.quit(); });
+      });
+      loop.loop();
+      adder.join();
+
+      BOOST_CHECK_EQUAL(fired, 500);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testWithoutTimerfd) {
+  for (const Backend &backend : K_BACKENDS) {
+    BOOST_TEST_CONTEXT(backend.name) {
+      useBackend(backend);
+      int before = countTimerfds();
+      lynx::EventLoop loop;
+      bool with_timerfd = std::string(backend.timerfd) == "on";
+      BOOST_CHECK_EQUAL(countTimerfds() - before, with_timerfd ? 1 : 0);
+
+      /// The earliest deadline goes, the loop wakes for nothing and then
+      /// sleeps on until the next one
+      lynx::Timestamp start(lynx::Timestamp::now());
+      double fired_after = 0.0;
+      lynx::TimerId first = loop.runAfter(0.01, [] {});
+      loop.runAfter(0.03, [&] {
+        fired_after = since(start);
+        loop.quit();
+      });
+      loop.cancel(first);
+      loop.loop();
+
+      BOOST_CHECK_GE(fired_after, 0.03);
+      BOOST_CHECK_LT(fired_after, 0.03 + 0.02);
+    }
+  }
+}
@@ -0,0 +1,116 @@
+#include "lynx/net/event_loop.h"
+#include "lynx/timer/timing_wheel.h"
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+const double K_TICK = 0.02;
+
+double since(lynx::Timestamp start) {
+  return timeDiff(lynx::Timestamp::now(), start);
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(testExpiry) {
+  lynx::EventLoop loop;
+  lynx::TimingWheel wheel(&loop, K_TICK, 8);
+  lynx::Timestamp start(lynx::Timestamp::now());
+  double short_expired = 0.0;
+  double long_expired = 0.0;
+  lynx::TimingWheel::Entry short_entry([&] { short_expired = since(start); });
+  /// More ticks than buckets, it comes round a few times first
+  lynx::TimingWheel::Entry long_entry([&] {
+    long_expired = since(start);
+    loop.quit();
+  });
+  wheel.add(&short_entry, 0.1);
+  wheel.add(&long_entry, 0.5);
+  BOOST_CHECK_EQUAL(wheel.size(), 2U);
+  loop.loop();
+
+  BOOST_CHECK(!short_entry.linked());
+  BOOST_CHECK(!long_entry.linked());
+  BOOST_CHECK_EQUAL(wheel.size(), 0U);
+  BOOST_CHECK_GE(short_expired, 0.1);
+  BOOST_CHECK_LT(short_expired, 0.1 + 3 * K_TICK);
+  BOOST_CHECK_GE(long_expired, 0.5);
+  BOOST_CHECK_LT(long_expired, 0.5 + 3 * K_TICK);
+}
+
+BOOST_AUTO_TEST_CASE(testTouch) {
+  lynx::EventLoop loop;
+  lynx::TimingWheel wheel(&loop, K_TICK, 8);
+  lynx::Timestamp start(lynx::Timestamp::now());
+  double expired = 0.0;
+  lynx::TimingWheel::Entry entry([&] {
+    expired = since(start);
+    loop.quit();
+  });
+  wheel.add(&entry, 0.1);
+
+  /// Kept alive while touched, expires a timeout after the last touch
+  double last_touch = 0.0;
+  lynx::TimerId toucher = loop.runEvery(0.03, [&] {
+    if (since(start) < 0.3) {
+      entry.touch();
+      last_touch = since(start);
+    }
+  });
+  loop.loop();
+  loop.cancel(toucher);
+
+  BOOST_CHECK_GE(last_touch, 0.2);
+  BOOST_CHECK_GE(expired, last_touch + 0.1);
+  BOOST_CHECK_LT(expired, last_touch + 0.1 + 3 * K_TICK);
+}
+
+BOOST_AUTO_TEST_CASE(testUnlinkDuringExpiry) {
+  lynx::EventLoop loop;
+  lynx::TimingWheel wheel(&loop, K_TICK, 8);
+  int fired = 0;
+  /// All due on the same tick, the first to expire takes the others off
+  lynx::TimingWheel::Entry entries[3];
+  for (lynx::TimingWheel::Entry &entry : entries) {
+    entry.setCallback([&] {
+      ++fired;
+      for (lynx::TimingWheel::Entry &other : entries) {
+        other.unlink();
+      }
+    });
+    wheel.add(&entry, 0.05);
+  }
+  loop.runAfter(0.2, [&loop] { loop.quit(); });
+  loop.loop();
+
+  BOOST_CHECK_EQUAL(fired, 1);
+  BOOST_CHECK_EQUAL(wheel.size(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(testReAddAndUnlink) {
+  lynx::EventLoop loop;
+  lynx::TimingWheel wheel(&loop, K_TICK, 8);
+  bool unlinked_fired = false;
+  double expired = 0.0;
+  lynx::Timestamp start(lynx::Timestamp::now());
+  lynx::TimingWheel::Entry unlinked([&] { unlinked_fired = true; });
+  lynx::TimingWheel::Entry readded([&] {
+    expired = since(start);
+    loop.quit();
+  });
+  wheel.add(&unlinked, 0.05);
+  wheel.add(&readded, 0.5);
+  /// Added again with a shorter timeout, it is on the wheel once
+  wheel.add(&readded, 0.1);
+  BOOST_CHECK_EQUAL(wheel.size(), 2U);
+  unlinked.unlink();
+  BOOST_CHECK_EQUAL(wheel.size(), 1U);
+  loop.loop();
+
+  BOOST_CHECK(!unlinked_fired);
+  BOOST_CHECK_GE(expired, 0.1);
+  BOOST_CHECK_LT(expired, 0.1 + 3 * K_TICK);
+}